@@ -0,0 +1,170 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Aerodynamic kernel benchmark. Verifies that forces calculated by the kernel match forces
+// applied by surfaces and engines themselves, and measures aerodynamic pass of 1000 planes
+// with per-object calculation and with the kernel.
+// Box2D can't hold 1000 planes, so each plane created stands for several planes in the pass.
+
+#include <stdio.h>
+#include <math.h>
+
+#include <QApplication>
+
+#include "Box2D.h"
+
+#include "world.h"
+#include "planebumblebee.h"
+#include "aerokernel.h"
+#include "surface.h"
+#include "engine.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int PLANES = 1000;				///< Planes in aerodynamic pass
+static const double WORLD_LENGTH = 30000;	///< World length [m]
+static const double ALTITUDE = 1500;		///< Altitude of planes [m]
+static const double SPEED = 60;				///< Initial speed of planes [m/s]
+static const int PROXY_MARGIN = 32;			///< Proxies left free for shrapnel
+static const int PASSES = 100;				///< Measured aerodynamic passes
+static const int STEPS = 300;				///< Simulated steps during accuracy check
+
+// Creates world without ground, with as many autopilot planes as Box2D can hold
+static World* createWorld( QList<PlaneBumblebee*>* pPlanes )
+{
+	qsrand( 1 );
+	World* pWorld = new World( QRectF( -WORLD_LENGTH / 2, -500, WORLD_LENGTH, 3000 ) );
+	
+	// Box2D has fixed number of proxies - stop before running out of them
+	int planes = 0;
+	while( planes < PLANES && pWorld->b2world()->GetProxyCount() < b2_maxProxies - PROXY_MARGIN )
+	{
+		double x = -WORLD_LENGTH / 2 + 500 + 1000 * planes;
+		PlaneBumblebee* pPlane = new PlaneBumblebee( pWorld, QPointF( x, ALTITUDE + 20 * ( planes % 10 ) ), 0.3 * ( planes % 3 ) );
+		pPlane->mainBody()->b2body()->SetLinearVelocity( b2Vec2( SPEED, 5 * ( planes % 5 ) ) );
+		pPlane->setAutopilot( true );
+		pWorld->addObject( pPlane, World::ObjectSide1 | World::ObjectSimulated | World::ObjectPlane );
+		pPlanes->append( pPlane );
+		planes++;
+	}
+	
+	return pWorld;
+}
+
+// Returns max difference of body positions and velocities between planes of two worlds
+static void compare( const QList<PlaneBumblebee*>& a, const QList<PlaneBumblebee*>& b, double* pPosDiff, double* pVelDiff )
+{
+	*pPosDiff = 0;
+	*pVelDiff = 0;
+	for( int i = 0; i < a.size(); i++ )
+	{
+		const QList<Body*>& bodiesA = a[i]->bodies();
+		const QList<Body*>& bodiesB = b[i]->bodies();
+		for( int j = 0; j < bodiesA.size(); j++ )
+		{
+			b2Body* pA = bodiesA[j]->b2body();
+			b2Body* pB = bodiesB[j]->b2body();
+			if ( pA && pB )
+			{
+				*pPosDiff = qMax( *pPosDiff, double( ( pA->GetPosition() - pB->GetPosition() ).Length() ) );
+				*pVelDiff = qMax( *pVelDiff, double( ( pA->GetLinearVelocity() - pB->GetLinearVelocity() ).Length() ) );
+			}
+		}
+	}
+}
+
+// Simulates the same planes with per-object forces and with the kernel, and compares the results
+static void verify()
+{
+	QList<PlaneBumblebee*> planesA;
+	QList<PlaneBumblebee*> planesB;
+	World* pWorldA = createWorld( &planesA );
+	World* pWorldB = createWorld( &planesB );
+	pWorldA->aeroKernel()->setEnabled( false );
+	pWorldB->aeroKernel()->setEnabled( true );
+	
+	double posDiff, velDiff;
+	for( int i = 0; i < STEPS; i++ )
+	{
+		qsrand( i );
+		pWorldA->simulate( pWorldA->timestep() );
+		qsrand( i );
+		pWorldB->simulate( pWorldB->timestep() );
+		
+		if ( i == 0 )
+		{
+			compare( planesA, planesB, &posDiff, &velDiff );
+			printf("After 1 step: max position difference: %g m, max velocity difference: %g m/s\n", posDiff, velDiff );
+		}
+	}
+	
+	compare( planesA, planesB, &posDiff, &velDiff );
+	printf("After %d steps: max position difference: %g m, max velocity difference: %g m/s\n", STEPS, posDiff, velDiff );
+	
+	delete pWorldA;
+	delete pWorldB;
+}
+
+// Measures aerodynamic pass of 1000 planes, with or without kernel
+static void measure( bool kernel )
+{
+	QList<PlaneBumblebee*> planes;
+	World* pWorld = createWorld( &planes );
+	pWorld->aeroKernel()->setEnabled( kernel );
+	
+	// collect surfaces and engines
+	QList<System*> systems;
+	for( int i = 0; i < PLANES; i++ )
+	{
+		foreach( System* pSystem, planes[ i % planes.size() ]->systems() )
+		{
+			if ( dynamic_cast<Surface*>( pSystem ) || dynamic_cast<Engine*>( pSystem ) )
+			{
+				systems.append( pSystem );
+			}
+		}
+	}
+	
+	double dt = pWorld->timestep();
+	benchmarkStart( QString("%1 planes, %2 surfaces and engines, kernel %3").arg( PLANES ).arg( systems.size() ).arg( kernel ? "on" : "off" ) );
+	for( int i = 0; i < PASSES; i++ )
+	{
+		foreach( System* pSystem, systems )
+		{
+			pSystem->simulate( dt );
+		}
+		pWorld->aeroKernel()->apply( pWorld->environment() );
+	}
+	benchmarkStop( PASSES );
+	
+	delete pWorld;
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	verify();
+	measure( false );
+	measure( true );
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,16 @@
+TEMPLATE = subdirs
+
+SUBDIRS += tiledrender \
+  clippedsprite \
+  particles \
+  bodycache \
+  snapshot \
+  replay \
+  streaming \
+  groundheight \
+  explosions \
+  threats \
+  simulationlod \
+  aerokernel \
+  environment \
+  fracture
@@ -0,0 +1,69 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Body prototype cache benchmark. Measures loading bodies for a town of 500 houses,
+// with and without prototype cache.
+// Bodies are only loaded, not added to physics world - 500 houses would exceed
+// Box2D proxy limit.
+
+#include <stdio.h>
+
+#include <QApplication>
+
+#include "body.h"
+#include "bodyprovider.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int HOUSES = 500;		///< Houses in town
+
+// Loads house bodies, the way Building does
+static void loadTown()
+{
+	qsrand( 1 );
+	for( int i = 0; i < HOUSES; i++ )
+	{
+		int housenum = ( qrand() % 4 ) + 1;
+		Body* pBody = BodyProvider::loadBody( QString("house_small_%1.body").arg( housenum ) );
+		delete pBody;
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	BodyProvider::setCaching( false );
+	benchmarkStart( QString("Loading %1 houses, no cache").arg( HOUSES ) );
+	loadTown();
+	benchmarkStop();
+	
+	BodyProvider::clearCache();
+	BodyProvider::setCaching( true );
+	benchmarkStart( QString("Loading %1 houses, prototype cache").arg( HOUSES ) );
+	loadTown();
+	benchmarkStop();
+	
+	BodyProvider::Statistics stats = BodyProvider::statistics();
+	printf("Prototype hits: %d, misses: %d, parsing: %.2f ms, saved: %.2f ms\n"
+		, stats.hits, stats.misses, stats.parseTime, stats.savedTime );
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,169 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Shape-limited texture benchmark. Compares filling shrapnel shapes with texture brush
+// each frame against drawing sprites baked once.
+
+#include <stdio.h>
+#include <math.h>
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+#include "common.h"
+#include "texture.h"
+#include "textureprovider.h"
+#include "renderingoptions.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int FRAMES = 20;					///< Frames rendered per measurement
+static const int FRAGMENTS_PER_HOUSE = 8;		///< How many shrapnels each house is split into
+static const double METERS_VISIBLE = 250;		///< Meters in viewport (standard zoom)
+static const QSize VIEWPORT( 1920, 1080 );		///< Viewport size [px]
+
+/// Single shrapnel: shape and placement
+struct Fragment
+{
+	QPolygonF	shape;
+	QTransform	transform;
+	TextureClip	clip;
+};
+
+// Splits polygon until it has required number of fragments
+static QList<QPolygonF> splitPolygon( const QPolygonF& polygon, int fragments )
+{
+	QList<QPolygonF> result;
+	result.append( polygon );
+	
+	int attempts = 0;
+	while( result.size() < fragments && attempts++ < fragments * 4 )
+	{
+		QPolygonF biggest = result.takeFirst();
+		QList<QPolygonF> parts = splitPolygonRandomly( biggest );
+		if ( parts.size() < 2 )
+		{
+			result.append( biggest );
+		}
+		else
+		{
+			result += parts;
+		}
+	}
+	
+	return result;
+}
+
+// Renders fragments, either with brush or with baked clip
+static void renderFrame( QImage& image, Texture& texture, const QPointF& texturePos,
+	const QTransform& view, QList<Fragment>& fragments, bool baked )
+{
+	RenderingOptions options;
+	
+	QPainter painter( & image );
+	painter.setRenderHint( QPainter::Antialiasing, true );
+	painter.fillRect( image.rect(), Qt::white );
+	
+	for( int i = 0; i < fragments.size(); i++ )
+	{
+		painter.setTransform( fragments[i].transform * view );
+		if ( baked )
+		{
+			fragments[i].clip.render( painter, options );
+		}
+		else
+		{
+			texture.fill( painter, texturePos, fragments[i].shape, options );
+		}
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	qsrand( 1 );
+	
+	Texture texture = TextureProvider::loadTexture( "house_small_1.png" );
+	TextureProvider::waitForLoaded();
+	
+	// texture covers the house shape, top-left corner at (0, height)
+	QPointF texturePos( 0, texture.height() );
+	QPolygonF house( QRectF( 0, 0, texture.width(), texture.height() ) );
+	
+	double zoom = VIEWPORT.width() / METERS_VISIBLE;
+	QTransform view;
+	view.scale( zoom, -zoom );
+	view.translate( 0, - METERS_VISIBLE * VIEWPORT.height() / VIEWPORT.width() );
+	
+	QImage image( VIEWPORT, QImage::Format_ARGB32_Premultiplied );
+	
+	QList<int> counts;
+	counts << 50 << 200 << 500;
+	
+	printf("Shape-limited texture, %dx%d, averaged over %d frames\n", VIEWPORT.width(), VIEWPORT.height(), FRAMES );
+	foreach( int houses, counts )
+	{
+		// scatter fragments of exploded houses
+		QList<Fragment> fragments;
+		for( int h = 0; h < houses; h++ )
+		{
+			QList<QPolygonF> parts = splitPolygon( house, FRAGMENTS_PER_HOUSE );
+			foreach( const QPolygonF& part, parts )
+			{
+				Fragment f;
+				f.shape = part;
+				f.transform.translate( qrand() % int( METERS_VISIBLE ), qrand() % int( METERS_VISIBLE * 0.5 ) );
+				f.transform.rotate( qrand() % 360 );
+				fragments.append( f );
+			}
+		}
+		
+		benchmarkStart( QString("Baking %1 clips, cold cache").arg( fragments.size() ) );
+		for( int i = 0; i < fragments.size(); i++ )
+		{
+			fragments[i].clip = texture.clip( texturePos, fragments[i].shape );
+		}
+		benchmarkStop();
+		
+		benchmarkStart( QString("Looking up %1 clips, warm cache").arg( fragments.size() ) );
+		for( int i = 0; i < fragments.size(); i++ )
+		{
+			fragments[i].clip = texture.clip( texturePos, fragments[i].shape );
+		}
+		benchmarkStop();
+		
+		benchmarkStart( QString("Brush fill, %1 shrapnels").arg( fragments.size() ) );
+		for( int i = 0; i < FRAMES; i++ )
+		{
+			renderFrame( image, texture, texturePos, view, fragments, false );
+		}
+		benchmarkStop( FRAMES );
+		
+		benchmarkStart( QString("Baked sprites, %1 shrapnels").arg( fragments.size() ) );
+		for( int i = 0; i < FRAMES; i++ )
+		{
+			renderFrame( image, texture, texturePos, view, fragments, true );
+		}
+		benchmarkStop( FRAMES );
+	}
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,178 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <stdio.h>
+#include <math.h>
+
+#include "world.h"
+#include "ground.h"
+#include "building.h"
+#include "airfield.h"
+#include "landinglight.h"
+#include "planebumblebee.h"
+#include "antiairbattery.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+namespace Flyer
+{
+
+static QString	currentName;	///< Name of current measurement
+static double	startTime;		///< Start of current measurement
+
+// ============================================================================
+/// Returns standard game's ground seed
+QList<Ground::Section> benchmarkGroundSeed()
+{
+	QList<Ground::Section> seed;
+	Ground::Section section;
+	
+	// mountains from -15 to -5 km
+	section.x = -15000;
+	section.y = 2500;
+	section.maxSlope = 1.5;
+	section.canBeDividedRight = true;
+	section.minSectionSize = 50;
+	section.maxSectionSize = 200;
+	section.maxHeight = 2400;
+	section.minHeight = 400;
+	seed.append( section );
+	
+	// flat land
+	section.x = -5000;
+	section.y = 500;
+	section.maxSlope = 0.1;
+	section.canBeDividedRight = true;
+	section.minSectionSize = 100;
+	section.maxSectionSize = 400;
+	section.maxHeight = 700;
+	section.minHeight = 250;
+	seed.append( section );
+	
+	// airfield
+	section.x = -100;
+	section.y = 300;
+	section.canBeDividedRight = false;
+	seed.append( section );
+	
+	// flats
+	section.x = 300;
+	section.y = 300;
+	section.maxSlope = 0.1;
+	section.canBeDividedRight = true;
+	section.minSectionSize = 100;
+	section.maxSectionSize = 400;
+	section.maxHeight = 850;
+	section.minHeight = 250;
+	seed.append( section );
+	
+	// next airfield
+	section.x = 5000;
+	section.y = 300;
+	section.canBeDividedRight = false;
+	seed.append( section );
+	
+	// between airport and mountains
+	section.x = 5350;
+	section.y = 300;
+	section.maxSlope = 0.2;
+	section.canBeDividedRight = true;
+	section.minSectionSize = 170;
+	section.maxSectionSize = 500;
+	section.maxHeight = 800;
+	section.minHeight = 300;
+	seed.append( section );
+	
+	// mountains to the end
+	section.x = 10000;
+	section.y = 700;
+	section.maxSlope = 1.5;
+	section.canBeDividedRight = true;
+	section.minSectionSize = 70;
+	section.maxSectionSize = 200;
+	section.maxHeight = 2400;
+	section.minHeight = 700;
+	seed.append( section );
+	
+	// very last section
+	section.x = 15000;
+	section.y = 2500;
+	section.canBeDividedRight = false;
+	seed.append( section );
+	
+	return seed;
+}
+
+// ============================================================================
+/// Creates world similar to the standard game
+World* createBenchmarkWorld( uint seed )
+{
+	qsrand( seed );
+	
+	World* pWorld = new World( QRectF( -15000, -500, 30000, 3000 ) );
+	pWorld->initRandomGround( benchmarkGroundSeed() );
+	const Ground* pGround = pWorld->ground();
+	
+	// planes
+	Plane* pPlane = new PlaneBumblebee( pWorld, QPointF( 0, pGround->height(0) + 2.5 ), 0.2 );
+	pWorld->addObject( pPlane,  World::ObjectSide1 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
+	pWorld->setPlayer( pPlane->pilot() );
+	
+	PlaneBumblebee* pEnemy = new PlaneBumblebee( pWorld, QPointF( -200, 400 ), 0.0 );
+	pEnemy->mainBody()->b2body()->SetLinearVelocity( b2Vec2( 30, 0 ) );
+	pEnemy->setAutopilot( true );
+	pWorld->addObject( pEnemy, World::ObjectSide2 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
+	
+	// airfield
+	pWorld->addObject( new Airfield( pWorld, -50, 250 ), World::ObjectAirfield | World::ObjectSide1 | World::ObjectRenderedMap  );
+	pWorld->addObject( new LandingLight( pWorld, -50, M_PI-0.25 ),  World::ObjectSimulated );
+	pWorld->addObject( new LandingLight( pWorld, 250, 0.25 ), World::ObjectSimulated  );
+	
+	// AA
+	pWorld->addObject( new AntiAirBattery( pWorld, 4750, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
+	pWorld->addObject( new AntiAirBattery( pWorld, -1500, 1.2 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
+	
+	// towns
+	Building::createTown( pWorld, 400, 800 );
+	Building::createTown( pWorld, 2300, 2600 );
+	
+	return pWorld;
+}
+
+// ============================================================================
+/// Starts measurement
+void benchmarkStart( const QString& name )
+{
+	currentName = name;
+	startTime = getms();
+}
+
+// ============================================================================
+/// Stops measurement, prints result
+double benchmarkStop( int repeats )
+{
+	double time = ( getms() - startTime ) / qMax( 1, repeats );
+	printf("%-80s:%.02f ms\n", qPrintable( currentName ), time );
+	fflush( stdout );
+	
+	return time;
+}
+
+}
+
+// EOF
+
@@ -0,0 +1,50 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+///\file benchmarkworld.h Utilities shared by flyer benchmarks.
+
+#ifndef FLYERBENCHMARKWORLD_H
+#define FLYERBENCHMARKWORLD_H
+
+#include <QString>
+#include <QList>
+
+#include "ground.h"
+
+namespace Flyer
+{
+
+class World;
+
+/// Returns ground seed used by the standard game (30km, mountains at both ends)
+QList<Ground::Section> benchmarkGroundSeed();
+
+/// Creates world similar to standard game: ground, towns, planes and installations.
+/// Random generator is seeded with \b seed, so each call creates the same world.
+World* createBenchmarkWorld( uint seed = 1 );
+
+/// Starts named measurement
+void benchmarkStart( const QString& name );
+
+/// Stops measurement, prints result. \b repeats divides the time. Returns measured time [ms]
+double benchmarkStop( int repeats = 1 );
+
+}
+
+#endif // FLYERBENCHMARKWORLD_H
+
+// EOF
+
@@ -0,0 +1,26 @@
+TEMPLATE = app
+TARGET = environmentbenchmark
+
+CONFIG += release
+CONFIG -= debug
+
+QT += opengl
+
+INCLUDEPATH += ../common \
+  ../../common \
+  ../../common/objects \
+  ../../include/
+
+DESTDIR = ../../bin/
+
+SOURCES += main.cpp \
+  ../common/benchmarkworld.cpp
+
+HEADERS += ../common/benchmarkworld.h
+
+LIBS += ../../lib/libflyercommon.a \
+  -L../../lib/ \
+  -lbox2d \
+  -lgpc
+
+TARGETDEPS += ../../lib/libflyercommon.a
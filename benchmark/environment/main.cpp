@@ -0,0 +1,130 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Environment benchmark. Samples air density and temperature at random points, as wings,
+// engines and bodies do each simulation step. Compares former linear formulas with grid
+// lookups, calm and with weather cells, one point at a time and in batches.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QVector>
+
+#include "environment.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const double WORLD_LENGTH = 30000;	///< World length [m]
+static const int POINTS = 10000;			///< Points sampled per repeat
+static const int REPEATS = 100;				///< Repeats per measurement
+static const int CELLS = 20;				///< Weather cells in stormy environment
+
+static volatile double sink;				///< Keeps results alive
+
+// Former density formula
+static double linearDensity( double y )
+{
+	return 1.0 - 0.08 * ( y / 1000.0 );
+}
+
+// Former temperature formula
+static double linearTemperature( double y )
+{
+	return 300 - 10 * ( y / 1000.0 );
+}
+
+// Measures sampling from environment
+static void measure( const Environment& environment, const QVector<double>& x, const QVector<double>& y, const QString& name )
+{
+	QVector<double> density( POINTS );
+	
+	benchmarkStart( QString("%1, one point at a time").arg( name ) );
+	for( int r = 0; r < REPEATS; r++ )
+	{
+		double sum = 0;
+		for( int i = 0; i < POINTS; i++ )
+		{
+			QPointF p( x[i], y[i] );
+			sum += environment.relativeDensity( p ) + environment.temperature( p );
+		}
+		sink = sum;
+	}
+	benchmarkStop( REPEATS );
+	
+	benchmarkStart( QString("%1, density in batch").arg( name ) );
+	for( int r = 0; r < REPEATS; r++ )
+	{
+		environment.sampleDensity( POINTS, x.constData(), y.constData(), density.data() );
+		sink = density[ r ];
+	}
+	benchmarkStop( REPEATS );
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	qsrand( 1 );
+	QVector<double> x( POINTS );
+	QVector<double> y( POINTS );
+	for( int i = 0; i < POINTS; i++ )
+	{
+		x[i] = WORLD_LENGTH * ( ( qrand() % 10000 ) / 10000.0 - 0.5 );
+		y[i] = 3000.0 * ( qrand() % 1000 ) / 1000.0 - 500;
+	}
+	
+	// former formulas
+	benchmarkStart( "Linear formulas" );
+	for( int r = 0; r < REPEATS; r++ )
+	{
+		double sum = 0;
+		for( int i = 0; i < POINTS; i++ )
+		{
+			sum += linearDensity( y[i] ) + linearTemperature( y[i] );
+		}
+		sink = sum;
+	}
+	benchmarkStop( REPEATS );
+	
+	QRectF boundary( -WORLD_LENGTH / 2, -500, WORLD_LENGTH, 3000 );
+	
+	Environment calm;
+	calm.setBoundary( boundary );
+	measure( calm, x, y, "Calm grid" );
+	
+	Environment stormy;
+	stormy.setBoundary( boundary );
+	stormy.setWind( 10 );
+	for( int i = 0; i < CELLS; i++ )
+	{
+		stormy.addCell( QPointF( x[i], 500 + y[i] / 2 ), 500 + ( qrand() % 1000 ), 3.0, 3.0 );
+	}
+	measure( stormy, x, y, QString("Grid with %1 weather cells").arg( CELLS ) );
+	
+	// incremental update
+	benchmarkStart( QString("Weather update, %1 cells, 1 s").arg( CELLS ) );
+	for( int r = 0; r < REPEATS; r++ )
+	{
+		stormy.simulate( 1.0 );
+	}
+	benchmarkStop( REPEATS );
+	
+	return 0;
+}
+
+// EOF
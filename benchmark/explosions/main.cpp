@@ -0,0 +1,74 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Explosion benchmark. Carpet-bombs a town of 200 houses with a stick of bombs
+// and measures simulation step time while shockwaves propagate through the town.
+
+#include <stdio.h>
+
+#include <QApplication>
+
+#include "world.h"
+#include "ground.h"
+#include "building.h"
+#include "explosion.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int HOUSES = 200;			///< Houses in the town
+static const double TOWN_START = 400;	///< Town location, flats after first airfield [m]
+static const int BOMBS = 50;			///< Bombs in the stick
+static const int BOMB_INTERVAL = 6;		///< Steps between explosions
+static const double BOMB_ENERGY = 40E6;	///< Energy of single bomb, same as GPB-125
+static const int STEPS = 600;			///< Simulated steps
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	qsrand( 1 );
+	World* pWorld = new World( QRectF( -15000, -500, 30000, 3000 ) );
+	pWorld->initRandomGround( benchmarkGroundSeed() );
+	
+	// two rows of houses, average spacing is 4 widths
+	double townLength = HOUSES * 2.0 * Building::smallBuildingWidth();
+	int houses = Building::createTown( pWorld, TOWN_START, TOWN_START + townLength );
+	
+	double dt = pWorld->timestep();
+	int bombs = 0;
+	
+	benchmarkStart( QString("Bombing town of %1 houses with %2 bombs, %3 steps").arg( houses ).arg( BOMBS ).arg( STEPS ) );
+	for( int step = 0; step < STEPS; step++ )
+	{
+		if ( bombs < BOMBS && step % BOMB_INTERVAL == 0 )
+		{
+			double x = TOWN_START + townLength * bombs / BOMBS;
+			Explosion::explode( pWorld, b2Vec2( x, pWorld->ground()->height( x ) + 1.0 ), BOMB_ENERGY );
+			bombs++;
+		}
+		
+		pWorld->simulate( dt );
+	}
+	benchmarkStop( STEPS );
+	
+	delete pWorld;
+	
+	return 0;
+}
+
+// EOF
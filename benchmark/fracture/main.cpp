@@ -0,0 +1,93 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Fracture benchmark. Breaks houses into shrapnels and measures time of single break:
+// with body split at the moment of the break, and with fragments copied from fracture
+// patterns precomputed when body prototype is loaded.
+
+#include <stdio.h>
+
+#include <QApplication>
+
+#include "world.h"
+#include "ground.h"
+#include "building.h"
+#include "bodyprovider.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int HOUSES = 20;			///< Houses broken in each round
+static const int ROUNDS = 10;			///< Rounds, each in new world
+static const double TOWN_START = 400;	///< Town location, flats after first airfield [m]
+
+// Measures breaking houses, with or without precomputed patterns
+static void measure( bool patterns )
+{
+	// patterns are built with prototypes, so prototype cache is needed
+	BodyProvider::clearCache();
+	BodyProvider::setCaching( patterns );
+	
+	double breakTime = 0;
+	int breaks = 0;
+	for( int round = 0; round < ROUNDS; round++ )
+	{
+		qsrand( round );
+		World* pWorld = new World( QRectF( -15000, -500, 30000, 3000 ) );
+		pWorld->initRandomGround( benchmarkGroundSeed() );
+		
+		QList<Building*> houses;
+		for( int i = 0; i < HOUSES; i++ )
+		{
+			double x = TOWN_START + 3 * i * Building::smallBuildingWidth();
+			houses.append( Building::createSmallBuilding( pWorld, x, false ) );
+		}
+		
+		double start = getms();
+		foreach( Building* pHouse, houses )
+		{
+			pHouse->breakBody( pHouse->mainBody(), PhysicalObject::FragmentationEffect );
+			pHouse->simulate( 0.0 ); // breaks are performed here
+			breaks++;
+		}
+		breakTime += getms() - start;
+		
+		delete pWorld;
+	}
+	
+	printf("%s: %d breaks, %g ms per break\n"
+		, patterns ? "Precomputed fracture patterns" : "Split at break"
+		, breaks, breakTime / breaks );
+	
+	if ( patterns )
+	{
+		printf("Fracture patterns precomputed in %g ms\n", BodyProvider::statistics().fractureTime );
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	measure( false );
+	measure( true );
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,108 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// Ground height lookup benchmark. Compares linear scan of heightmap with grid lookup
+// and batch lookup, on the dense mountain section of the standard terrain.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QVector>
+
+#include "world.h"
+#include "ground.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int SAMPLES = 100000;		///< Queried x-coordinates
+static const double MOUNTAINS_START = -15000;	///< Dense mountain section [m]
+static const double MOUNTAINS_END = -5000;
+
+// Height by linear scan, as Ground::height() used to do
+static double linearHeight( const QPolygonF& heightmap, double x )
+{
+	for( int i = 0; i < heightmap.size() - 1; i++ )
+	{
+		if ( heightmap[i].x() <= x && heightmap[i+1].x() >= x )
+		{
+			double x1 = heightmap[i].x();
+			double y1 = heightmap[i].y();
+			double x2 = heightmap[i+1].x();
+			double y2 = heightmap[i+1].y();
+			
+			return y1 + ( y2 - y1 ) * ( x - x1) / ( x2 - x1 );
+		}
+	}
+	return 0;
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	qsrand( 1 );
+	World* pWorld = new World( QRectF( -15000, -500, 30000, 3000 ) );
+	Ground* pGround = new Ground( pWorld );
+	pGround->setHeightmap( pGround->generate( benchmarkGroundSeed() ) );
+	const QPolygonF& heightmap = pGround->heightmap();
+	printf("Heightmap: %d points\n", heightmap.size() );
+	
+	QVector<double> x( SAMPLES );
+	for( int i = 0; i < SAMPLES; i++ )
+	{
+		x[i] = MOUNTAINS_START + ( MOUNTAINS_END - MOUNTAINS_START ) * ( qrand() % 100000 ) / 100000.0;
+	}
+	
+	QVector<double> reference( SAMPLES );
+	QVector<double> single( SAMPLES );
+	QVector<double> batch( SAMPLES );
+	
+	benchmarkStart( QString("Linear scan, %1 lookups").arg( SAMPLES ) );
+	for( int i = 0; i < SAMPLES; i++ )
+	{
+		reference[i] = linearHeight( heightmap, x[i] );
+	}
+	benchmarkStop();
+	
+	benchmarkStart( QString("Ground::height(), %1 lookups").arg( SAMPLES ) );
+	for( int i = 0; i < SAMPLES; i++ )
+	{
+		single[i] = pGround->height( x[i] );
+	}
+	benchmarkStop();
+	
+	benchmarkStart( QString("Ground::heights(), %1 lookups").arg( SAMPLES ) );
+	pGround->heights( x.constData(), batch.data(), SAMPLES );
+	benchmarkStop();
+	
+	// verify
+	double maxError = 0;
+	for( int i = 0; i < SAMPLES; i++ )
+	{
+		maxError = qMax( maxError, qAbs( single[i] - reference[i] ) );
+		maxError = qMax( maxError, qAbs( batch[i] - reference[i] ) );
+	}
+	printf("Max difference from linear scan: %g m\n", maxError );
+	
+	delete pWorld;
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,132 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Particle system benchmark. Measures simulation and rendering of smoke particles.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+#include "world.h"
+#include "ground.h"
+#include "particlesystem.h"
+#include "renderingoptions.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int STEPS = 100;					///< Simulation steps per measurement
+static const int FRAMES = 10;					///< Frames rendered per measurement
+static const int PARTICLES_PER_EMITTER = 1000;	///< Particles in each emitter
+static const double TIMESTEP = 1.0 / 60;		///< Simulation step [s]
+static const double METERS_VISIBLE = 250;		///< Meters in viewport (standard zoom)
+static const double CAMERA_X = 600;				///< Camera position - over the town
+static const QSize VIEWPORT( 1920, 1080 );		///< Viewport size [px]
+
+// Creates emitters with given total number of particles, in the visible area
+static QList<ParticleSystem*> createEmitters( World* pWorld, int particles )
+{
+	QList<ParticleSystem*> emitters;
+	
+	double groundY = pWorld->ground()->height( CAMERA_X );
+	int count = particles / PARTICLES_PER_EMITTER;
+	for( int e = 0; e < count; e++ )
+	{
+		ParticleSystem* pEmitter = ParticleSystem::createSmoke( pWorld );
+		b2Vec2 source( CAMERA_X - METERS_VISIBLE * 0.4 + ( qrand() % int( METERS_VISIBLE * 0.8 ) ), groundY + 5 + qrand() % 40 );
+		for( int i = 0; i < PARTICLES_PER_EMITTER; i++ )
+		{
+			// long-lived, to keep count constant during measurement
+			double vx = (qrand() % 400)/100.0 - 2;
+			double vy = (qrand() % 600)/100.0 - 1;
+			double radius = ( qrand() % 100 ) / 100.0 + 0.5;
+			pEmitter->addParticle( source, b2Vec2( vx, vy ), radius, 1000.0 );
+		}
+		emitters.append( pEmitter );
+	}
+	
+	return emitters;
+}
+
+// Measures simulation and rendering of given number of particles
+static void measure( World* pWorld, int particles )
+{
+	QList<ParticleSystem*> emitters = createEmitters( pWorld, particles );
+	
+	benchmarkStart( QString("Simulating %1 particles, %2 emitters, per step").arg( particles ).arg( emitters.size() ) );
+	for( int s = 0; s < STEPS; s++ )
+	{
+		foreach( ParticleSystem* pEmitter, emitters )
+		{
+			pEmitter->simulate( TIMESTEP );
+		}
+	}
+	benchmarkStop( STEPS );
+	
+	// render
+	QImage image( VIEWPORT, QImage::Format_ARGB32_Premultiplied );
+	double zoom = VIEWPORT.width() / METERS_VISIBLE;
+	double cameraY = pWorld->ground()->height( CAMERA_X ) + 40;
+	
+	QTransform t;
+	t.scale( zoom, -zoom );
+	t.translate( -CAMERA_X + VIEWPORT.width() * 0.5 / zoom, -cameraY - VIEWPORT.height() * 0.5 / zoom );
+	QRectF rect = t.inverted().mapRect( QRectF( QPointF( 0, 0 ), VIEWPORT ) );
+	
+	RenderingOptions options;
+	
+	benchmarkStart( QString("Rendering %1 particles, %2x%3, per frame").arg( particles ).arg( VIEWPORT.width() ).arg( VIEWPORT.height() ) );
+	for( int f = 0; f < FRAMES; f++ )
+	{
+		QPainter painter( & image );
+		painter.fillRect( image.rect(), Qt::white );
+		painter.setTransform( t );
+		foreach( ParticleSystem* pEmitter, emitters )
+		{
+			pEmitter->render( painter, rect, options );
+		}
+	}
+	benchmarkStop( FRAMES );
+	
+	foreach( ParticleSystem* pEmitter, emitters )
+	{
+		pWorld->removeObject( pEmitter );
+	}
+	pWorld->simulate( TIMESTEP ); // destroys removed emitters
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	World* pWorld = createBenchmarkWorld();
+	
+	QList<int> counts;
+	counts << 10000 << 100000;
+	
+	foreach( int particles, counts )
+	{
+		measure( pWorld, particles );
+	}
+	
+	delete pWorld;
+	return 0;
+}
+
+// EOF
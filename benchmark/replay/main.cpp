@@ -0,0 +1,196 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// Headless input log replay. Replays recorded flight (see FLYER_RECORD_INPUT) as fast
+// as possible and reports speed relative to real time.
+// Usage: replaybenchmark [log] [profile.csv]
+// Without log, records scripted flight in benchmark world first, and verifies that
+// replay ends in the same state. Optional CSV receives time of each simulation step.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include "world.h"
+#include "plane.h"
+#include "worldsnapshot.h"
+#include "inputlog.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const double TIMESTEP = 0.1;		///< Timestep of scripted flight, same as game's [s]
+static const int SCRIPT_STEPS = 1200;	///< Length of scripted flight [steps]
+
+// Scripted input: take off, climb, shoot, engage autopilot, drop bomb
+static void scriptedInput( InputLog& log, Plane* pPlane, int step )
+{
+	InputLog::Command command;
+	double value = 0.0;
+	
+	switch( step )
+	{
+		case 0:		command = InputLog::Throttle;		value = 1.0; break;
+		case 150:	command = InputLog::Elevator;		value = 0.4; break;
+		case 250:	command = InputLog::Elevator;		value = 0.1; break;
+		case 300:	command = InputLog::Flaps;			value = 0.0; break;
+		case 400:	command = InputLog::Firing;			value = 1.0; break;
+		case 430:	command = InputLog::Firing;			value = 0.0; break;
+		case 500:	command = InputLog::Autopilot;		value = 1.0; break;
+		case 700:	command = InputLog::ReleaseWeapon;	break;
+		case 900:	command = InputLog::Autopilot;		value = 0.0; break;
+		case 950:	command = InputLog::Elevator;		value = -0.2; break;
+		default:
+			return;
+	}
+	
+	log.record( command, value );
+	InputLog::apply( pPlane, command, value );
+}
+
+// Records scripted flight. Returns final player position
+static QPointF record( InputLog& log )
+{
+	// fly in restored world, as game does when recording
+	World* pGenerated = createBenchmarkWorld();
+	World* pWorld = WorldSnapshot::restore( WorldSnapshot::save( pGenerated ) );
+	delete pGenerated;
+	
+	log.startRecording( pWorld, TIMESTEP );
+	for( int i = 0; i < SCRIPT_STEPS; i++ )
+	{
+		scriptedInput( log, pWorld->playerPlane(), i );
+		pWorld->simulate( TIMESTEP );
+		log.stepFinished();
+	}
+	
+	Plane* pPlane = pWorld->playerPlane();
+	QPointF position = pPlane ? pPlane->position() : QPointF();
+	delete pWorld;
+	
+	return position;
+}
+
+// Replays log. Stores step times in \b pStepTimes. Returns final player position
+static QPointF replay( const InputLog& log, QVector<double>* pStepTimes )
+{
+	World* pWorld = log.createWorld();
+	if ( ! pWorld )
+	{
+		fprintf( stderr, "Input log contains no valid world snapshot\n" );
+		return QPointF();
+	}
+	
+	pStepTimes->resize( log.steps() );
+	
+	int next = 0;
+	for( int i = 0; i < log.steps(); i++ )
+	{
+		double start = getms();
+		log.applyStep( pWorld->playerPlane(), i, & next );
+		pWorld->simulate( log.timestep() );
+		(*pStepTimes)[i] = getms() - start;
+	}
+	
+	Plane* pPlane = pWorld->playerPlane();
+	QPointF position = pPlane ? pPlane->position() : QPointF();
+	delete pWorld;
+	
+	return position;
+}
+
+// Writes step times as CSV
+static void exportProfile( const QString& path, const InputLog& log, const QVector<double>& stepTimes )
+{
+	QFile file( path );
+	if ( ! file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+	{
+		fprintf( stderr, "Can't write %s\n", qPrintable( path ) );
+		return;
+	}
+	
+	// count events per step
+	QVector<int> events( stepTimes.size(), 0 );
+	foreach( const InputLog::Event& event, log.events() )
+	{
+		if ( event.step < events.size() ) events[ event.step ]++;
+	}
+	
+	QTextStream out( & file );
+	out << "step,time_s,step_ms,events\n";
+	for( int i = 0; i < stepTimes.size(); i++ )
+	{
+		out << i << "," << i * log.timestep() << "," << stepTimes[i] << "," << events[i] << "\n";
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	InputLog log;
+	QPointF recordedPosition;
+	bool scripted = argc < 2;
+	
+	if ( scripted )
+	{
+		recordedPosition = record( log );
+	}
+	else if ( ! log.load( argv[1] ) )
+	{
+		return 1;
+	}
+	
+	printf("Replaying %d steps (%.1f s), %d events\n", log.steps(), log.steps() * log.timestep(), log.events().size() );
+	
+	QVector<double> stepTimes;
+	double start = getms();
+	QPointF position = replay( log, & stepTimes );
+	double total = getms() - start;
+	
+	double worst = 0;
+	foreach( double t, stepTimes )
+	{
+		worst = qMax( worst, t );
+	}
+	
+	printf("Replay took %.1f ms, %.1fx real time. Average step: %.3f ms, worst: %.3f ms\n"
+		, total, log.steps() * log.timestep() * 1000.0 / qMax( total, 0.001 )
+		, total / qMax( 1, log.steps() ), worst );
+	
+	if ( scripted )
+	{
+		QPointF error = position - recordedPosition;
+		printf("Final position: recorded %.3f,%.3f, replayed %.3f,%.3f - %s\n"
+			, recordedPosition.x(), recordedPosition.y(), position.x(), position.y()
+			, ( error.manhattanLength() < 1e-3 ) ? "deterministic" : "DIVERGED" );
+	}
+	
+	if ( argc > 2 )
+	{
+		exportProfile( argv[2], log, stepTimes );
+	}
+	
+	return 0;
+}
+
+// EOF
@@ -0,0 +1,195 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// Simulation LOD benchmark. 100 autopilot planes are spread along the world, player's plane
+// flies in the middle. Measures simulation step time with every object simulated each step,
+// and with simulation level of detail. Trajectories of planes simulated with reduced level of
+// detail are compared with fully simulated ones; benchmark fails if they diverge.
+
+#include <stdio.h>
+#include <math.h>
+
+#include <QApplication>
+#include <QVector>
+
+#include "Box2D.h"
+
+#include "world.h"
+#include "planebumblebee.h"
+#include "simulationscheduler.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int PLANES = 100;				///< Autopilot planes
+static const double WORLD_LENGTH = 30000;	///< World length [m]
+static const double ALTITUDE = 1500;		///< Altitude of planes [m]
+static const double SPEED = 60;				///< Initial speed of planes [m/s]
+static const int PROXY_MARGIN = 32;			///< Proxies left free for shrapnel
+static const int STEPS = 600;				///< Simulated steps per measurement
+static const int SAMPLE_INTERVAL = 60;		///< Steps between trajectory samples
+static const double TOLERANCE = 0.05;		///< Allowed trajectory error, fraction of distance flown
+
+/// Positions of autopilot planes, sampled during simulation
+typedef QVector< QVector<QPointF> > Trajectories;
+
+// Creates world without ground, with player's plane and autopilot planes. Fills list of autopilot planes created.
+static World* createWorld( QList<PlaneBumblebee*>* pPlanes )
+{
+	World* pWorld = new World( QRectF( -WORLD_LENGTH / 2, -500, WORLD_LENGTH, 3000 ) );
+	
+	PlaneBumblebee* pPlayer = new PlaneBumblebee( pWorld, QPointF( 0, ALTITUDE ), 0.0 );
+	pPlayer->mainBody()->b2body()->SetLinearVelocity( b2Vec2( SPEED, 0 ) );
+	pPlayer->setAutopilot( true );
+	pWorld->addObject( pPlayer, World::ObjectSide1 | World::ObjectSimulated | World::ObjectPlane );
+	pWorld->setPlayer( pPlayer->pilot() );
+	
+	// Box2D has fixed number of proxies - stop before running out of them
+	int planes = 0;
+	while( planes < PLANES && pWorld->b2world()->GetProxyCount() < b2_maxProxies - PROXY_MARGIN )
+	{
+		double x = -WORLD_LENGTH / 2 + 500 + ( WORLD_LENGTH - 1000 ) * planes / PLANES;
+		PlaneBumblebee* pPlane = new PlaneBumblebee( pWorld, QPointF( x, ALTITUDE + 20 * ( planes % 10 ) ), 0.0 );
+		pPlane->mainBody()->b2body()->SetLinearVelocity( b2Vec2( SPEED, 0 ) );
+		pPlane->setAutopilot( true );
+		pWorld->addObject( pPlane, World::ObjectSide2 | World::ObjectSimulated | World::ObjectPlane );
+		pPlanes->append( pPlane );
+		planes++;
+	}
+	
+	return pWorld;
+}
+
+// Samples positions of planes. Planes removed from the world get null position.
+static void sample( World* pWorld, const QList<PlaneBumblebee*>& planes, Trajectories* pTrajectories )
+{
+	pTrajectories->resize( planes.size() );
+	for( int i = 0; i < planes.size(); i++ )
+	{
+		bool simulated = pWorld->scheduler()->objectLod( planes[i] ) != SimulationScheduler::LodCount;
+		(*pTrajectories)[i].append( simulated ? planes[i]->position() : QPointF() );
+	}
+}
+
+// Measures simulation with LOD enabled or disabled. Fills sampled trajectories of autopilot planes,
+// and for LOD run, flags of planes which were in far bucket when simulation ended.
+static void measure( bool lod, Trajectories* pTrajectories, QVector<bool>* pFar )
+{
+	qsrand( 1 );
+	QList<PlaneBumblebee*> planes;
+	World* pWorld = createWorld( &planes );
+	pWorld->scheduler()->setEnabled( lod );
+	
+	benchmarkStart( QString("%1 planes, %2 steps, LOD %3").arg( planes.size() ).arg( STEPS ).arg( lod ? "on" : "off" ) );
+	for( int i = 0; i < STEPS; i++ )
+	{
+		pWorld->simulate( pWorld->timestep() );
+	}
+	benchmarkStop( STEPS );
+	
+	// same simulation again, with trajectories sampled outside of measurement
+	delete pWorld;
+	qsrand( 1 );
+	planes.clear();
+	pWorld = createWorld( &planes );
+	pWorld->scheduler()->setEnabled( lod );
+	
+	sample( pWorld, planes, pTrajectories );
+	for( int i = 0; i < STEPS; i++ )
+	{
+		pWorld->simulate( pWorld->timestep() );
+		if ( ( i + 1 ) % SAMPLE_INTERVAL == 0 )
+		{
+			sample( pWorld, planes, pTrajectories );
+		}
+	}
+	
+	if ( lod )
+	{
+		printf("Objects near: %d, mid: %d, far: %d\n"
+			, pWorld->scheduler()->objects( SimulationScheduler::LodNear )
+			, pWorld->scheduler()->objects( SimulationScheduler::LodMid )
+			, pWorld->scheduler()->objects( SimulationScheduler::LodFar ) );
+		
+		pFar->resize( planes.size() );
+		for( int i = 0; i < planes.size(); i++ )
+		{
+			(*pFar)[i] = pWorld->scheduler()->objectLod( planes[i] ) == SimulationScheduler::LodFar;
+		}
+	}
+	
+	delete pWorld;
+}
+
+// Compares trajectories of far planes. Returns false if any of them diverged.
+static bool compare( const Trajectories& full, const Trajectories& reduced, const QVector<bool>& far )
+{
+	double worst = 0;
+	int compared = 0;
+	int lost = 0;
+	for( int i = 0; i < far.size(); i++ )
+	{
+		if ( ! far[i] )
+		{
+			continue;
+		}
+		compared++;
+		
+		double distance = 0;
+		for( int s = 0; s < full[i].size(); s++ )
+		{
+			// plane removed in one simulation only?
+			if ( full[i][s].isNull() != reduced[i][s].isNull() )
+			{
+				lost++;
+				break;
+			}
+			if ( s > 0 )
+			{
+				QPointF step = full[i][s] - full[i][s-1];
+				distance += sqrt( step.x()*step.x() + step.y()*step.y() );
+			}
+			QPointF diff = reduced[i][s] - full[i][s];
+			double error = sqrt( diff.x()*diff.x() + diff.y()*diff.y() ) / qMax( distance, SPEED );
+			worst = qMax( worst, error );
+		}
+	}
+	
+	bool ok = compared > 0 && lost == 0 && worst < TOLERANCE;
+	printf("Far planes: %d, lost: %d, worst trajectory error: %.1f%% of distance flown - %s\n"
+		, compared, lost, worst * 100.0, ok ? "ok" : "DIVERGED" );
+	
+	return ok;
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	Trajectories full;
+	Trajectories reduced;
+	QVector<bool> far;
+	
+	measure( false, & full, & far );
+	measure( true, & reduced, & far );
+	
+	return compare( full, reduced, far ) ? 0 : 1;
+}
+
+// EOF
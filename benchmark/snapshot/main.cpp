@@ -0,0 +1,159 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// World snapshot benchmark. Measures snapshot and restore time versus number of objects.
+// Objects are added as extra towns in flat area between the second airfield and mountains.
+// Measures part of restore time spent on ground, and checks that explosions, shrapnels,
+// smoke and gun rounds are restored.
+
+#include <stdio.h>
+
+#include <QApplication>
+
+#include "world.h"
+#include "ground.h"
+#include "building.h"
+#include "explosion.h"
+#include "projectilesystem.h"
+#include "worldsnapshot.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int SAVES = 100;			///< Snapshots per measurement
+static const int RESTORES = 5;			///< Restores per measurement
+static const double TOWN_START = 5400;	///< Start of extra town [m]
+static const double BOMB_ENERGY = 40E6;	///< Energy of bomb exploding in town, same as GPB-125
+static const int ROUNDS = 20;			///< Rounds in flight
+static const int STEPS = 10;			///< Steps simulated after explosion, shockwave is still spreading
+
+// Measures world with extra town of given length
+static void measure( double townLength )
+{
+	World* pWorld = createBenchmarkWorld();
+	int buildings = 0;
+	if ( townLength > 0 )
+	{
+		buildings = Building::createTown( pWorld, TOWN_START, TOWN_START + townLength );
+	}
+	
+	QByteArray snapshot;
+	benchmarkStart( QString("Snapshot, %1 extra buildings").arg( buildings ) );
+	for( int i = 0; i < SAVES; i++ )
+	{
+		snapshot = WorldSnapshot::save( pWorld );
+	}
+	benchmarkStop( SAVES );
+	
+	benchmarkStart( QString("Restore, %1 extra buildings, %2 kB").arg( buildings ).arg( snapshot.size() / 1024 ) );
+	for( int i = 0; i < RESTORES; i++ )
+	{
+		World* pRestored = WorldSnapshot::restore( snapshot );
+		delete pRestored;
+	}
+	benchmarkStop( RESTORES );
+	
+	delete pWorld;
+}
+
+// Measures restore of ground alone: heightmap, textures, bodies and decorations
+static void measureGround()
+{
+	World* pWorld = createBenchmarkWorld();
+	QList<WorldObject*> ground;
+	ground.append( const_cast<Ground*>( pWorld->ground() ) );
+	QByteArray data = WorldSnapshot::saveObjects( pWorld, ground );
+	
+	benchmarkStart( "Creating empty world" );
+	for( int i = 0; i < RESTORES; i++ )
+	{
+		delete new World( pWorld->boundary() );
+	}
+	benchmarkStop( RESTORES );
+	
+	benchmarkStart( QString("Restore ground into empty world, %1 kB").arg( data.size() / 1024 ) );
+	for( int i = 0; i < RESTORES; i++ )
+	{
+		World* pRestored = new World( pWorld->boundary() );
+		WorldSnapshot::restoreObjects( pRestored, data );
+		delete pRestored;
+	}
+	benchmarkStop( RESTORES );
+	
+	delete pWorld;
+}
+
+// Explodes bomb in town and fires rounds, then checks if restored world has the same
+// objects and rounds. Returns false if anything was lost.
+static bool checkTransient()
+{
+	World* pWorld = createBenchmarkWorld();
+	Building::createTown( pWorld, TOWN_START, TOWN_START + 200 );
+	
+	double x = TOWN_START + 100;
+	double y = pWorld->ground()->height( x );
+	Explosion::explode( pWorld, b2Vec2( x, y + 1.0 ), BOMB_ENERGY );
+	for( int i = 0; i < ROUNDS; i++ )
+	{
+		pWorld->projectiles()->fire( QPointF( x, y + 100 + i ), QPointF( 300, 10 ), 0.05, 5.0 );
+	}
+	for( int i = 0; i < STEPS; i++ )
+	{
+		pWorld->simulate( pWorld->timestep() );
+	}
+	
+	World* pRestored = WorldSnapshot::restore( WorldSnapshot::save( pWorld ) );
+	
+	// town and its surroundings; whole world has more shapes than render query can return
+	QRectF area( TOWN_START - 500, pWorld->boundary().top(), 1200, pWorld->boundary().height() );
+	int objects = pWorld->findObjectsToRender( area ).size();
+	int rounds = pWorld->projectiles()->count();
+	int restoredObjects = pRestored ? pRestored->findObjectsToRender( area ).size() : 0;
+	int restoredRounds = pRestored ? pRestored->projectiles()->count() : 0;
+	bool ok = restoredObjects == objects && restoredRounds == rounds;
+	
+	printf("Restored objects: %d of %d, rounds: %d of %d - %s\n"
+		, restoredObjects, objects, restoredRounds, rounds, ok ? "ok" : "LOST" );
+	
+	delete pRestored;
+	delete pWorld;
+	
+	return ok;
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	// baseline: full world generation
+	benchmarkStart( "Generating world" );
+	World* pWorld = createBenchmarkWorld();
+	benchmarkStop();
+	delete pWorld;
+	
+	measure( 0 );
+	measure( 500 );
+	measure( 1000 );
+	measure( 2000 );
+	
+	measureGround();
+	
+	return checkTransient() ? 0 : 1;
+}
+
+// EOF
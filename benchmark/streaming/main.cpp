@@ -0,0 +1,223 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// World streaming benchmark. Flies over 500 km world, populated chunk by chunk by
+// generator, and measures simulation step time along the way. With streaming,
+// step time and memory should not depend on distance flown.
+// Before the flight, checks that objects parked and restored keep their positions,
+// so they have ground under them in whole active range.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QtAlgorithms>
+
+#include "world.h"
+#include "building.h"
+#include "ground.h"
+#include "antiairbattery.h"
+#include "worldstreamer.h"
+#include "physicalobject.h"
+#include "common.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const double WORLD_LENGTH = 500000;	///< World length [m]
+static const double HILLS_SPACING = 10000;	///< Distance between hills sections [m]
+static const double CHUNK_WIDTH = 2000;		///< Streaming chunk width [m]
+static const double SPEED = 250;			///< Speed of observer [m/s]
+static const double TIMESTEP = 0.1;			///< Simulation step [s]
+static const double REPORT_DISTANCE = 50000;	///< Distance between reports [m]
+static const double SETTLE_TIME = 3.0;		///< Time objects are simulated before their positions are checked [s]
+static const double POSITION_TOLERANCE = 1.0;	///< Allowed change of restored object's position [m]
+
+/// Populates each chunk with a town and AA battery
+class BenchmarkGenerator : public WorldStreamer::Generator
+{
+public:
+	virtual void generateChunk( World* pWorld, int index, double from, double to )
+	{
+		qsrand( index );
+		Building::createTown( pWorld, from + 200, from + 800 );
+		
+		double aaX = from + ( to - from ) * 0.75;
+		pWorld->addObject( new AntiAirBattery( pWorld, aaX, 1.2 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap );
+	}
+};
+
+// Creates alternating flats and hills along whole world
+static QList<Ground::Section> groundSeed( const QRectF& boundary )
+{
+	QList<Ground::Section> seed;
+	Ground::Section section;
+	
+	bool hills = false;
+	for( double x = boundary.left(); x < boundary.right(); x += HILLS_SPACING )
+	{
+		section.x = x;
+		section.y = 400;
+		section.canBeDividedRight = true;
+		section.maxSlope = hills ? 0.8 : 0.1;
+		section.minSectionSize = hills ? 70 : 100;
+		section.maxSectionSize = hills ? 200 : 400;
+		section.maxHeight = hills ? 1500 : 600;
+		section.minHeight = 250;
+		seed.append( section );
+		
+		hills = ! hills;
+	}
+	
+	section.x = boundary.right();
+	section.y = 400;
+	section.canBeDividedRight = false;
+	seed.append( section );
+	
+	return seed;
+}
+
+// Orders positions by x
+static bool leftOf( const QPointF& a, const QPointF& b )
+{
+	return a.x() < b.x();
+}
+
+// Simulates world for SETTLE_TIME, and returns positions of objects in chunks active around x, sorted by x
+static QList<QPointF> settledPositions( World* pWorld, WorldStreamer* pStreamer, double x )
+{
+	for( int i = 0; i < int( SETTLE_TIME / TIMESTEP ); i++ )
+	{
+		pWorld->simulate( TIMESTEP );
+	}
+	
+	int center = pStreamer->chunkIndex( x );
+	double left = ( center - pStreamer->activeRadius() ) * CHUNK_WIDTH;
+	double right = ( center + pStreamer->activeRadius() + 1 ) * CHUNK_WIDTH;
+	QRectF rect( left, pWorld->boundary().top(), right - left, pWorld->boundary().height() );
+	
+	QList<QPointF> positions;
+	foreach( WorldObject* pObject, pWorld->findObjectsToRender( rect ) )
+	{
+		PhysicalObject* pPhysical = dynamic_cast<PhysicalObject*>( pObject );
+		if ( pPhysical && pPhysical != pWorld->ground() && pPhysical->mainBody() )
+		{
+			positions.append( pPhysical->position() );
+		}
+	}
+	qSort( positions.begin(), positions.end(), leftOf );
+	
+	return positions;
+}
+
+// Activates chunks around x, parks them by moving away, and activates them again.
+// Returns false if restored objects moved.
+static bool checkRestore( World* pWorld, WorldStreamer* pStreamer, double x )
+{
+	pStreamer->update( x );
+	QList<QPointF> before = settledPositions( pWorld, pStreamer, x );
+	
+	pStreamer->update( x + ( 2 * pStreamer->activeRadius() + 3 ) * CHUNK_WIDTH );
+	pWorld->simulate( TIMESTEP );
+	
+	pStreamer->update( x );
+	QList<QPointF> after = settledPositions( pWorld, pStreamer, x );
+	
+	double worst = 0;
+	bool ok = before.size() == after.size();
+	for( int i = 0; ok && i < before.size(); i++ )
+	{
+		QPointF diff = after[i] - before[i];
+		worst = qMax( worst, diff.manhattanLength() );
+	}
+	ok = ok && worst < POSITION_TOLERANCE;
+	
+	printf("Restored objects: %d of %d, worst position change %.2f m - %s\n"
+		, after.size(), before.size(), worst, ok ? "ok" : "MOVED" );
+	
+	return ok;
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	qsrand( 1 );
+	QRectF boundary( -WORLD_LENGTH / 2, -500, WORLD_LENGTH, 3000 );
+	
+	benchmarkStart( QString("Creating %1 km streamed world").arg( WORLD_LENGTH / 1000 ) );
+	World* pWorld = new World( boundary );
+	
+	Ground* pGround = new Ground( pWorld );
+	pGround->setHeightmap( pGround->generate( groundSeed( boundary ) ) );
+	pGround->assembleTextures( qrand() );
+	pGround->prepareDecorations( qrand() );
+	pWorld->setGround( pGround );
+	
+	BenchmarkGenerator generator;
+	WorldStreamer* pStreamer = new WorldStreamer( pWorld, CHUNK_WIDTH );
+	pStreamer->setGenerator( & generator );
+	pWorld->setStreamer( pStreamer );
+	benchmarkStop();
+	
+	bool restored = checkRestore( pWorld, pStreamer, boundary.left() + 10 * CHUNK_WIDTH );
+	
+	// fly
+	double x = boundary.left() + CHUNK_WIDTH;
+	double nextReport = x + REPORT_DISTANCE;
+	double sectionTime = 0;
+	double worstStep = 0;
+	int sectionSteps = 0;
+	int steps = 0;
+	
+	while( x < boundary.right() - CHUNK_WIDTH )
+	{
+		// world updates streamer every second, using player's position
+		if ( steps % int( 1.0 / TIMESTEP ) == 0 )
+		{
+			pStreamer->update( x );
+		}
+		
+		double start = getms();
+		pWorld->simulate( TIMESTEP );
+		double time = getms() - start;
+		
+		sectionTime += time;
+		worstStep = qMax( worstStep, time );
+		sectionSteps++;
+		steps++;
+		x += SPEED * TIMESTEP;
+		
+		if ( x >= nextReport )
+		{
+			printf("%5.0f km: step %.3f ms (worst %.3f ms), %d active chunks, %d parked chunks, %d kB parked\n"
+				, ( x - boundary.left() ) / 1000.0, sectionTime / sectionSteps, worstStep
+				, pStreamer->activeChunks(), pStreamer->parkedChunks(), pStreamer->parkedBytes() / 1024 );
+			
+			nextReport += REPORT_DISTANCE;
+			sectionTime = 0;
+			worstStep = 0;
+			sectionSteps = 0;
+		}
+	}
+	
+	delete pWorld;
+	
+	return restored ? 0 : 1;
+}
+
+// EOF
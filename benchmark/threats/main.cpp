@@ -0,0 +1,126 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+// Threat index benchmark. Shooters of one side look for nearest target of the other side
+// within sight range, as AA gunners do every simulation step. Compares each shooter checking
+// all targets with building shared index once per step and querying it.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QVector>
+
+#include "world.h"
+#include "threatindex.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const double WORLD_LENGTH = 30000;	///< World length [m]
+static const double RANGE = 500;			///< Sight range [m]
+static const int STEPS = 100;				///< Simulated steps per measurement
+
+// Random position in the world, up to 2 km above ground
+static b2Vec2 randomPosition()
+{
+	return b2Vec2( WORLD_LENGTH * ( ( qrand() % 10000 ) / 10000.0 - 0.5 ), 2000.0 * ( qrand() % 1000 ) / 1000.0 );
+}
+
+// Measures n shooters versus n targets
+static void measure( World* pWorld, int n )
+{
+	qsrand( n );
+	
+	QVector<b2Vec2> shooters( n );
+	QVector<ThreatIndex::Target> targets( n );
+	for( int i = 0; i < n; i++ )
+	{
+		shooters[i] = randomPosition();
+		
+		targets[i].pMachine = NULL;
+		targets[i].position = randomPosition();
+		targets[i].velocity = b2Vec2( 80, 0 );
+		targets[i].objectClass = World::ObjectPlane | World::ObjectSide1;
+	}
+	
+	// each shooter checks every target
+	int found = 0;
+	benchmarkStart( QString("%1 shooters vs %1 targets, brute force").arg( n ) );
+	for( int step = 0; step < STEPS; step++ )
+	{
+		for( int s = 0; s < n; s++ )
+		{
+			const ThreatIndex::Target* pNearest = NULL;
+			double nearest = RANGE * RANGE;
+			for( int t = 0; t < n; t++ )
+			{
+				double d = ( targets[t].position - shooters[s] ).LengthSquared();
+				if ( d <= nearest )
+				{
+					nearest = d;
+					pNearest = & targets[t];
+				}
+			}
+			if ( pNearest ) found++;
+		}
+	}
+	benchmarkStop( STEPS );
+	
+	// shared index, built once per step
+	int foundIndexed = 0;
+	ThreatIndex index( pWorld );
+	benchmarkStart( QString("%1 shooters vs %1 targets, threat index").arg( n ) );
+	for( int step = 0; step < STEPS; step++ )
+	{
+		index.clear();
+		for( int t = 0; t < n; t++ )
+		{
+			index.addTarget( targets[t] );
+		}
+		index.build();
+		
+		for( int s = 0; s < n; s++ )
+		{
+			if ( index.nearestHostile( shooters[s], World::ObjectSide2, RANGE, World::ObjectPlane ) ) foundIndexed++;
+		}
+	}
+	benchmarkStop( STEPS );
+	
+	if ( found != foundIndexed )
+	{
+		printf("ERROR: brute force found %d targets, index found %d\n", found, foundIndexed );
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	World* pWorld = new World( QRectF( -WORLD_LENGTH / 2, -500, WORLD_LENGTH, 3000 ) );
+	
+	measure( pWorld, 10 );
+	measure( pWorld, 50 );
+	measure( pWorld, 100 );
+	measure( pWorld, 500 );
+	
+	delete pWorld;
+	
+	return 0;
+}
+
+// EOF
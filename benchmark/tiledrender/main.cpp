@@ -0,0 +1,103 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// Tiled world renderer benchmark. Measures frame time versus number of rendering threads.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QThread>
+
+#include "world.h"
+#include "ground.h"
+
+#include "benchmarkworld.h"
+
+using namespace Flyer;
+
+static const int FRAMES = 20;					///< Frames rendered per measurement
+static const double METERS_VISIBLE = 250;		///< Meters in viewport (standard zoom)
+static const double CAMERA_X = 600;			///< Camera position - over the town
+
+// Renders frames with given number of threads
+static void measure( World* pWorld, const QSize& size, int threads )
+{
+	QImage image( size, QImage::Format_ARGB32_Premultiplied );
+	
+	double zoom = qMax( size.width(), size.height() ) / METERS_VISIBLE;
+	double cameraY = pWorld->ground()->height( CAMERA_X ) + 40;
+	
+	QTransform t;
+	t.scale( zoom, -zoom );
+	t.translate( -CAMERA_X + size.width() * 0.5 / zoom, -cameraY - size.height() * 0.5 / zoom );
+	QRectF rect = t.inverted().mapRect( QRectF( QPointF( 0, 0 ), size ) );
+	
+	pWorld->setRenderThreads( threads );
+	
+	// warm up - creates tile images and styled textures
+	{
+		QPainter painter( & image );
+		painter.setTransform( t );
+		pWorld->render( painter, rect );
+	}
+	
+	benchmarkStart( QString("%1x%2, %3 threads")
+		.arg( size.width() ).arg( size.height() )
+		.arg( threads == 0 ? QString("single-threaded path,") : QString::number( threads ) ) );
+	for( int i = 0; i < FRAMES; i++ )
+	{
+		QPainter painter( & image );
+		painter.setRenderHint( QPainter::Antialiasing, true );
+		painter.setTransform( t );
+		pWorld->render( painter, rect );
+	}
+	benchmarkStop( FRAMES );
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	World* pWorld = createBenchmarkWorld();
+	pWorld->simulate( 1.0 ); // let things settle
+	
+	QList<QSize> sizes;
+	sizes << QSize( 1920, 1080 ) << QSize( 3840, 2160 );
+	
+	QList<int> threads;
+	threads << 0 << 1 << 2 << 4 << 8;
+	if ( ! threads.contains( QThread::idealThreadCount() ) )
+	{
+		threads << QThread::idealThreadCount();
+	}
+	
+	printf("Frame time, averaged over %d frames\n", FRAMES );
+	foreach( QSize size, sizes )
+	{
+		foreach( int t, threads )
+		{
+			measure( pWorld, size, t );
+		}
+	}
+	
+	delete pWorld;
+	return 0;
+}
+
+// EOF
+
@@ -0,0 +1,264 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <math.h>
+
+#include "environment.h"
+
+#include "aerokernel.h"
+
+namespace Flyer
+{
+
+static const int SURFACES_RESERVE	= 256;	///< Initial capacity for surfaces
+static const int ENGINES_RESERVE	= 64;	///< Initial capacity for engines
+
+// ============================================================================
+// Constructor
+AeroKernel::AeroKernel()
+{
+	_enabled = true;
+	
+	_surfaceBodies.reserve( SURFACES_RESERVE );
+	_angles.reserve( SURFACES_RESERVE );
+	_cos.reserve( SURFACES_RESERVE );
+	_sin.reserve( SURFACES_RESERVE );
+	_px.reserve( SURFACES_RESERVE );
+	_py.reserve( SURFACES_RESERVE );
+	_vx.reserve( SURFACES_RESERVE );
+	_vy.reserve( SURFACES_RESERVE );
+	_lx.reserve( SURFACES_RESERVE );
+	_ly.reserve( SURFACES_RESERVE );
+	_inclinations.reserve( SURFACES_RESERVE );
+	_lifts.reserve( SURFACES_RESERVE );
+	_dragsH.reserve( SURFACES_RESERVE );
+	_dragsV.reserve( SURFACES_RESERVE );
+	_densityFactors.reserve( SURFACES_RESERVE );
+	_density.reserve( SURFACES_RESERVE );
+	_windX.reserve( SURFACES_RESERVE );
+	_windY.reserve( SURFACES_RESERVE );
+	_fx.reserve( SURFACES_RESERVE );
+	_fy.reserve( SURFACES_RESERVE );
+	_ax.reserve( SURFACES_RESERVE );
+	_ay.reserve( SURFACES_RESERVE );
+	
+	_engineBodies.reserve( ENGINES_RESERVE );
+	_engineCos.reserve( ENGINES_RESERVE );
+	_engineSin.reserve( ENGINES_RESERVE );
+	_enginePx.reserve( ENGINES_RESERVE );
+	_enginePy.reserve( ENGINES_RESERVE );
+	_tx.reserve( ENGINES_RESERVE );
+	_ty.reserve( ENGINES_RESERVE );
+	_engineDensity.reserve( ENGINES_RESERVE );
+	_efx.reserve( ENGINES_RESERVE );
+	_efy.reserve( ENGINES_RESERVE );
+}
+
+// ============================================================================
+// Destructor
+AeroKernel::~AeroKernel()
+{
+}
+
+// ============================================================================
+/// Registers surface. Body state is captured now, force is applied during apply().
+void AeroKernel::addSurface( b2Body* pBody, const b2Vec2& point, const Coefficients& coefficients )
+{
+	Q_ASSERT( pBody );
+	
+	const b2XForm& xf = pBody->GetXForm();
+	const b2Vec2& velocity = pBody->GetLinearVelocity();
+	
+	_surfaceBodies.append( pBody );
+	_angles.append( pBody->GetAngle() );
+	_cos.append( xf.R.col1.x );
+	_sin.append( xf.R.col1.y );
+	_px.append( xf.position.x );
+	_py.append( xf.position.y );
+	_vx.append( velocity.x );
+	_vy.append( velocity.y );
+	_lx.append( point.x );
+	_ly.append( point.y );
+	_inclinations.append( coefficients.inclination );
+	_lifts.append( coefficients.lift );
+	_dragsH.append( coefficients.dragH );
+	_dragsV.append( coefficients.dragV );
+	_densityFactors.append( coefficients.densityFactor );
+}
+
+// ============================================================================
+/// Registers engine. Body state is captured now, force is applied during apply().
+void AeroKernel::addEngine( b2Body* pBody, const b2Vec2& thrust )
+{
+	Q_ASSERT( pBody );
+	
+	const b2XForm& xf = pBody->GetXForm();
+	
+	_engineBodies.append( pBody );
+	_engineCos.append( xf.R.col1.x );
+	_engineSin.append( xf.R.col1.y );
+	_enginePx.append( xf.position.x );
+	_enginePy.append( xf.position.y );
+	_tx.append( thrust.x );
+	_ty.append( thrust.y );
+}
+
+// ============================================================================
+/// Calculates forces of all registered surfaces and engines, applies them to bodies
+/// and clears registrations.
+void AeroKernel::apply( const Environment* pEnvironment )
+{
+	Q_ASSERT( pEnvironment );
+	
+	calculateSurfaces( pEnvironment );
+	calculateEngines( pEnvironment );
+	
+	const int surfaces = _surfaceBodies.size();
+	for( int i = 0; i < surfaces; i++ )
+	{
+		_surfaceBodies[i]->ApplyForce( b2Vec2( _fx[i], _fy[i] ), b2Vec2( _ax[i], _ay[i] ) );
+	}
+	
+	const int engines = _engineBodies.size();
+	for( int i = 0; i < engines; i++ )
+	{
+		b2Body* pBody = _engineBodies[i];
+		pBody->ApplyForce( b2Vec2( _efx[i], _efy[i] ), pBody->GetPosition() );
+	}
+	
+	clear();
+}
+
+// ============================================================================
+/// Calculates surface forces. Same model as Surface::aerodynamicForce(), but angle of attack
+/// is obtained from airspeed vector directly: v*sin(attack) = sin(a)*vx - cos(a)*vy, where
+/// a is surface angle. Loop has no branches and no calls except sin/cos, so compiler can vectorize it.
+void AeroKernel::calculateSurfaces( const Environment* pEnvironment )
+{
+	const int count = _surfaceBodies.size();
+	_density.resize( count );
+	_windX.resize( count );
+	_windY.resize( count );
+	pEnvironment->sampleDensity( count, _px.constData(), _py.constData(), _density.data() );
+	pEnvironment->sampleWind( count, _px.constData(), _py.constData(), _windX.data(), _windY.data() );
+	
+	_fx.resize( count );
+	_fy.resize( count );
+	_ax.resize( count );
+	_ay.resize( count );
+	
+	const double* angles = _angles.constData();
+	const double* cs = _cos.constData();
+	const double* sn = _sin.constData();
+	const double* px = _px.constData();
+	const double* py = _py.constData();
+	const double* vx = _vx.constData();
+	const double* vy = _vy.constData();
+	const double* lx = _lx.constData();
+	const double* ly = _ly.constData();
+	const double* inclinations = _inclinations.constData();
+	const double* lifts = _lifts.constData();
+	const double* dragsH = _dragsH.constData();
+	const double* dragsV = _dragsV.constData();
+	const double* densityFactors = _densityFactors.constData();
+	const double* densities = _density.constData();
+	const double* windX = _windX.constData();
+	const double* windY = _windY.constData();
+	double* fx = _fx.data();
+	double* fy = _fy.data();
+	double* ax = _ax.data();
+	double* ay = _ay.data();
+	
+	for( int i = 0; i < count; i++ )
+	{
+		double attack = angles[i] + inclinations[i];
+		double ux = vx[i] - windX[i]; // airspeed
+		double uy = vy[i] - windY[i];
+		double v2 = ux*ux + uy*uy;
+		double v = sqrt( v2 );
+		double q = sin( attack )*ux - cos( attack )*uy; // v * sin(angle of attack)
+		double density = 1.0 + densityFactors[i] * ( densities[i] - 1.0 );
+		
+		// force in surface coordinates
+		double lift = -density * v * q * lifts[i];
+		double drag = -density * ( v2 * dragsH[i] + q * q * ( dragsV[i] - dragsH[i] ) );
+		
+		fx[i] = drag*cs[i] + lift*sn[i];
+		fy[i] = drag*sn[i] - lift*cs[i];
+		ax[i] = px[i] + cs[i]*lx[i] - sn[i]*ly[i];
+		ay[i] = py[i] + sn[i]*lx[i] + cs[i]*ly[i];
+	}
+}
+
+// ============================================================================
+/// Calculates engine forces - thrust rotated to world coordinates and reduced by air density.
+void AeroKernel::calculateEngines( const Environment* pEnvironment )
+{
+	const int count = _engineBodies.size();
+	_engineDensity.resize( count );
+	pEnvironment->sampleDensity( count, _enginePx.constData(), _enginePy.constData(), _engineDensity.data() );
+	
+	_efx.resize( count );
+	_efy.resize( count );
+	
+	const double* cs = _engineCos.constData();
+	const double* sn = _engineSin.constData();
+	const double* densities = _engineDensity.constData();
+	const double* tx = _tx.constData();
+	const double* ty = _ty.constData();
+	double* fx = _efx.data();
+	double* fy = _efy.data();
+	
+	for( int i = 0; i < count; i++ )
+	{
+		double density = densities[i];
+		fx[i] = density * ( tx[i]*cs[i] - ty[i]*sn[i] );
+		fy[i] = density * ( tx[i]*sn[i] + ty[i]*cs[i] );
+	}
+}
+
+// ============================================================================
+/// Removes all registered surfaces and engines. Buffers keep their capacity.
+void AeroKernel::clear()
+{
+	_surfaceBodies.resize( 0 );
+	_angles.resize( 0 );
+	_cos.resize( 0 );
+	_sin.resize( 0 );
+	_px.resize( 0 );
+	_py.resize( 0 );
+	_vx.resize( 0 );
+	_vy.resize( 0 );
+	_lx.resize( 0 );
+	_ly.resize( 0 );
+	_inclinations.resize( 0 );
+	_lifts.resize( 0 );
+	_dragsH.resize( 0 );
+	_dragsV.resize( 0 );
+	_densityFactors.resize( 0 );
+	
+	_engineBodies.resize( 0 );
+	_engineCos.resize( 0 );
+	_engineSin.resize( 0 );
+	_enginePx.resize( 0 );
+	_enginePy.resize( 0 );
+	_tx.resize( 0 );
+	_ty.resize( 0 );
+}
+
+}
+
+// EOF
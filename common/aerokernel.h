@@ -0,0 +1,121 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERAEROKERNEL_H
+#define FLYERAEROKERNEL_H
+
+#include <QVector>
+
+#include "Box2D.h"
+
+namespace Flyer
+{
+
+class Environment;
+
+/**
+	Evaluates aerodynamic forces of all surfaces and engine thrusts in the world in single pass.
+	During object simulation, surfaces and engines only register their coefficients
+	and the state of their bodies in flat arrays. After all objects are simulated,
+	forces are calculated in tight loops without virtual calls and trigonometry of
+	velocity angle, and applied to bodies in bulk. Air density and wind are sampled
+	from environment in batches.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class AeroKernel
+{
+public:
+	
+	/// Aerodynamic coefficients of surface in its current state
+	struct Coefficients
+	{
+		double	inclination;		///< Inclination angle, including orientation [radians]
+		double	lift;				///< Lift coefficient [N/m2]
+		double	dragH;				///< Horizontal drag coefficient [N/m2]
+		double	dragV;				///< Vertical drag coefficient [N/m2]
+		double	densityFactor;		///< How much air density affects the surface: 1 - fully, 0 - not at all
+	};
+	
+	AeroKernel();
+	~AeroKernel();
+	
+	/// Registers surface attached to body at point (in body coordinates)
+	void addSurface( b2Body* pBody, const b2Vec2& point, const Coefficients& coefficients );
+	/// Registers engine thrust [N], in body coordinates, reduced by air density
+	void addEngine( b2Body* pBody, const b2Vec2& thrust );
+	
+	/// Calculates and applies forces of all registered surfaces and engines
+	void apply( const Environment* pEnvironment );
+	void clear();		///< Removes all registered surfaces and engines
+	
+	/// Enables kernel. When disabled, surfaces and engines apply forces themselves
+	void setEnabled( bool enabled ) { _enabled = enabled; }
+	bool enabled() const { return _enabled; }
+	
+	int surfaces() const { return _surfaceBodies.size(); }	///< Surfaces registered
+	int engines() const { return _engineBodies.size(); }	///< Engines registered
+
+private:
+	
+	void calculateSurfaces( const Environment* pEnvironment );	///< Calculates surface forces
+	void calculateEngines( const Environment* pEnvironment );	///< Calculates engine forces
+	
+	bool	_enabled;			///< If kernel is used
+	
+	// surfaces - input
+	QVector<b2Body*>	_surfaceBodies;	///< Bodies
+	QVector<double>	_angles;			///< Body angle [radians]
+	QVector<double>	_cos;				///< Body angle cosine
+	QVector<double>	_sin;				///< Body angle sine
+	QVector<double>	_px;				///< Body position [m]
+	QVector<double>	_py;
+	QVector<double>	_vx;				///< Body linear velocity [m/s]
+	QVector<double>	_vy;
+	QVector<double>	_lx;				///< Surface position, in body coordinates [m]
+	QVector<double>	_ly;
+	QVector<double>	_inclinations;		///< Inclination [radians]
+	QVector<double>	_lifts;				///< Lift coefficients
+	QVector<double>	_dragsH;			///< Horizontal drag coefficients
+	QVector<double>	_dragsV;			///< Vertical drag coefficients
+	QVector<double>	_densityFactors;	///< Density factors
+	QVector<double>	_density;			///< Sampled relative air density
+	QVector<double>	_windX;				///< Sampled wind [m/s]
+	QVector<double>	_windY;
+	
+	// surfaces - output
+	QVector<double>	_fx;				///< Force [N]
+	QVector<double>	_fy;
+	QVector<double>	_ax;				///< Force application point, in world coordinates [m]
+	QVector<double>	_ay;
+	
+	// engines
+	QVector<b2Body*>	_engineBodies;	///< Bodies
+	QVector<double>	_engineCos;			///< Body angle cosine
+	QVector<double>	_engineSin;			///< Body angle sine
+	QVector<double>	_enginePx;			///< Body position [m]
+	QVector<double>	_enginePy;
+	QVector<double>	_tx;				///< Thrust, in body coordinates [N]
+	QVector<double>	_ty;
+	QVector<double>	_engineDensity;		///< Sampled relative air density
+	QVector<double>	_efx;				///< Force [N]
+	QVector<double>	_efy;
+};
+
+}
+
+#endif // FLYERAEROKERNEL_H
+
+// EOF
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "common.h"
 #include "world.h"
 #include "ground.h"
@@ -68,4 +70,11 @@ void Airfield::render(QPainter& painter, const QRectF&, const RenderingOptions&
 	painter.fillRect( rect, Qt::darkBlue );
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void Airfield::saveParams( QDataStream& stream ) const
+{
+	stream << _x1 << _x2;
+}
+
 }
@@ -35,6 +35,11 @@ public:
 	virtual QRectF boundingRect() const;
 	virtual void renderOnMap(QPainter& painter, const QRectF& rect );
 	virtual void render(QPainter& painter, const QRectF& rect, const RenderingOptions& options );
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Airfield"; }
+	virtual void saveParams( QDataStream& stream ) const;
 
 private:
 
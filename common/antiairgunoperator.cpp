@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPointF>
 #include "world.h"
 #include "antiairgunoperator.h"
@@ -22,6 +24,7 @@
 #include "body.h"
 #include "machine.h"
 #include "plane.h"
+#include "threatindex.h"
 
 namespace Flyer
 {
@@ -132,24 +135,21 @@ void AntiAirGunOperator::simulate ( double dt )
 }
 
 // ============================================================================
-/// Seeks for enemy,. Returns it's position, or null QpointF if not found
+/// Seeks for enemy: nearest hostile plane in sight range. Returns it's position, or null QpointF if not found
 QPointF AntiAirGunOperator::getEnemyPos()
 {
-	// player pos
-	Plane* pPlayerPlane = parent()->world()->playerPlane();
-	if ( pPlayerPlane )
+	if ( _pGun && _pGun->body() && _pGun->body()->b2body() )
 	{
-		QPointF playerPos = pPlayerPlane->position();
-		if ( _pGun && _pGun->body() && _pGun->body()->b2body() )
+		World* pWorld = parent()->world();
+		
+		// own pos
+		b2Vec2 gunPos = _pGun->body()->b2body()->GetWorldPoint( point2vec( _pGun->muzzle() ) );
+		
+		const ThreatIndex::Target* pTarget = pWorld->threats()->nearestHostile( gunPos,
+			pWorld->objectSide( parent() ), SIGHT_RANGE, World::ObjectPlane );
+		if ( pTarget )
 		{
-			// own pos
-			b2Vec2 gunPos = _pGun->body()->b2body()->GetWorldPoint( point2vec( _pGun->muzzle() ) );
-			
-			// check range
-			if ( ( gunPos - point2vec( playerPos ) ).Length() <= SIGHT_RANGE )
-			{
-				return playerPos;
-			}
+			return vec2point( pTarget->position );
 		}
 	}
 	
@@ -163,4 +163,18 @@ double AntiAirGunOperator::currentAngleNormalized() const
 	return M_PI/2 - _currentAngle;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void AntiAirGunOperator::saveState( QDataStream& stream ) const
+{
+	stream << _currentAngle << _desiredGunAngle << _damageReceived << _broken;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void AntiAirGunOperator::restoreState( QDataStream& stream )
+{
+	stream >> _currentAngle >> _desiredGunAngle >> _damageReceived >> _broken;
+}
+
 }
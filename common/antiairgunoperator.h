@@ -53,9 +53,13 @@ public:
 	/// Retruns current angle from zenith
 	double currentAngle() const { return _currentAngle; }
 	/// Returns current angler in std coordinates
-	double currentAngleNormalized() const;			
+	double currentAngleNormalized() const;
 	
+	// snapshots
 	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
+
 private:
 
 	QPointF getEnemyPos(); ///< The Tricky Part(TM) - sekes for enemy
@@ -0,0 +1,239 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "assetpack.h"
+
+namespace Flyer
+{
+
+const char		AssetPack::MAGIC[] = "FLYRPACK";
+const quint32	AssetPack::VERSION = 1;
+const int		AssetPack::DATA_ALIGNMENT = 16;
+
+static const int HEADER_SIZE = 24;	///< Size of file header: magic, version, entries, index offset
+
+// ============================================================================
+// Constructor
+AssetPack::AssetPack()
+{
+	_pData = NULL;
+	_size = 0;
+}
+
+// ============================================================================
+// Destructor
+AssetPack::~AssetPack()
+{
+	if ( _pData )
+	{
+		_file.unmap( const_cast<uchar*>( _pData ) );
+	}
+}
+
+// ============================================================================
+/// Opens and maps archive, reads index.
+bool AssetPack::open( const QString& path )
+{
+	_file.setFileName( path );
+	if ( ! _file.open( QIODevice::ReadOnly ) )
+	{
+		return false;
+	}
+	
+	_size = _file.size();
+	if ( _size < HEADER_SIZE )
+	{
+		qWarning("Asset pack %s is too small", qPrintable( path ) );
+		return false;
+	}
+	
+	_pData = _file.map( 0, _size );
+	if ( ! _pData )
+	{
+		qWarning("Can't map asset pack %s: %s", qPrintable( path ), qPrintable( _file.errorString() ) );
+		return false;
+	}
+	
+	// header
+	QByteArray header = QByteArray::fromRawData( reinterpret_cast<const char*>( _pData ), HEADER_SIZE );
+	QDataStream headerStream( header );
+	
+	char magic[ 8 ];
+	quint32 version = 0;
+	quint32 count = 0;
+	quint64 indexOffset = 0;
+	headerStream.readRawData( magic, 8 );
+	headerStream >> version >> count >> indexOffset;
+	
+	if ( qstrncmp( magic, MAGIC, 8 ) != 0 || version != VERSION || indexOffset >= quint64( _size ) )
+	{
+		qWarning("Asset pack %s has invalid header, ignored", qPrintable( path ) );
+		return false;
+	}
+	
+	// index
+	QByteArray index = QByteArray::fromRawData( reinterpret_cast<const char*>( _pData ) + indexOffset, _size - indexOffset );
+	QDataStream indexStream( index );
+	for( quint32 i = 0; i < count; i++ )
+	{
+		Entry entry;
+		indexStream >> entry;
+		
+		if ( indexStream.status() != QDataStream::Ok || entry.offset + entry.size > quint64( _size ) )
+		{
+			qWarning("Asset pack %s has corrupted index, ignored", qPrintable( path ) );
+			_bodies.clear();
+			_textures.clear();
+			return false;
+		}
+		
+		if ( entry.type == AssetBody )
+		{
+			_bodies.insert( entry.name, entry );
+		}
+		else if ( entry.type == AssetTexture )
+		{
+			_textures.insert( entry.name, entry );
+		}
+	}
+	
+	qDebug("Asset pack %s: %d bodies, %d textures", qPrintable( path ), _bodies.size(), _textures.size() );
+	return true;
+}
+
+// ============================================================================
+/// Returns index entry of asset
+const AssetPack::Entry* AssetPack::entry( AssetType type, const QString& name ) const
+{
+	const QHash< QString, Entry >& index = ( type == AssetBody ) ? _bodies : _textures;
+	
+	QHash< QString, Entry >::const_iterator it = index.find( name );
+	if ( it == index.end() )
+	{
+		return NULL;
+	}
+	
+	return & it.value();
+}
+
+// ============================================================================
+/// Checks if asset is in archive
+bool AssetPack::contains( AssetType type, const QString& name ) const
+{
+	return entry( type, name ) != NULL;
+}
+
+// ============================================================================
+/// Returns asset data, wrapping mapped memory.
+QByteArray AssetPack::data( AssetType type, const QString& name ) const
+{
+	const Entry* pEntry = entry( type, name );
+	if ( ! pEntry )
+	{
+		return QByteArray();
+	}
+	
+	return QByteArray::fromRawData( reinterpret_cast<const char*>( _pData ) + pEntry->offset, pEntry->size );
+}
+
+// ============================================================================
+/// Returns texture image. Image uses mapped memory, it will be copied only if modified.
+QImage AssetPack::image( const QString& name ) const
+{
+	const Entry* pEntry = entry( AssetTexture, name );
+	if ( ! pEntry || quint64( pEntry->bytesPerLine ) * pEntry->height > pEntry->size )
+	{
+		return QImage();
+	}
+	
+	return QImage( _pData + pEntry->offset, pEntry->width, pEntry->height, pEntry->bytesPerLine
+		, QImage::Format( pEntry->format ) );
+}
+
+// ============================================================================
+/// Returns names of all assets of given type
+QStringList AssetPack::names( AssetType type ) const
+{
+	return ( type == AssetBody ) ? _bodies.keys() : _textures.keys();
+}
+
+// ============================================================================
+/// Returns archive opened at first call. If there is no valid archive at default path,
+/// returns NULL - providers use loose files then.
+AssetPack* AssetPack::instance()
+{
+	static QMutex mutex;
+	static AssetPack* pInstance = NULL;
+	static bool opened = false;
+	
+	QMutexLocker locker( & mutex );
+	if ( ! opened )
+	{
+		opened = true;
+		pInstance = new AssetPack();
+		if ( ! pInstance->open( defaultPath() ) )
+		{
+			delete pInstance;
+			pInstance = NULL;
+		}
+	}
+	
+	return pInstance;
+}
+
+// ============================================================================
+/// Returns default archive path: next to the bodies and textures libraries.
+QString AssetPack::defaultPath()
+{
+	QDir dir( QCoreApplication::applicationDirPath() );
+	dir.cdUp();
+	return dir.absoluteFilePath( "flyer.pack" );
+}
+
+// ============================================================================
+/// Writes index entry
+QDataStream& operator << ( QDataStream& stream, const AssetPack::Entry& entry )
+{
+	stream << entry.name << entry.type << entry.offset << entry.size;
+	if ( entry.type == AssetPack::AssetTexture )
+	{
+		stream << entry.width << entry.height << entry.bytesPerLine << entry.format;
+	}
+	
+	return stream;
+}
+
+// ============================================================================
+/// Reads index entry
+QDataStream& operator >> ( QDataStream& stream, AssetPack::Entry& entry )
+{
+	stream >> entry.name >> entry.type >> entry.offset >> entry.size;
+	if ( entry.type == AssetPack::AssetTexture )
+	{
+		stream >> entry.width >> entry.height >> entry.bytesPerLine >> entry.format;
+	}
+	
+	return stream;
+}
+
+}
+
+// EOF
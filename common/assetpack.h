@@ -0,0 +1,118 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERASSETPACK_H
+#define FLYERASSETPACK_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QFile>
+#include <QImage>
+#include <QByteArray>
+#include <QDataStream>
+
+namespace Flyer
+{
+
+/**
+	Read-only archive with all bodies and pre-decoded textures, built by flyer-pack tool.
+	Archive file is memory-mapped; assets are provided without copying data.
+	
+	File layout (all numbers written with QDataStream):
+	- header: magic (8 bytes), version, number of entries, index offset
+	- asset data, each entry aligned to DATA_ALIGNMENT bytes
+	- index: for each entry name, type, data offset and size; for textures also
+	  width, height, bytes per line and image format.
+	
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class AssetPack
+{
+public:
+
+	/// Asset type
+	enum AssetType {
+		AssetBody		= 1,	///< Serialized body
+		AssetTexture	= 2		///< Decoded texture image
+	};
+	
+	/// Index entry
+	struct Entry
+	{
+		Entry() : type( 0 ), offset( 0 ), size( 0 ), width( 0 ), height( 0 ), bytesPerLine( 0 ), format( 0 ) {}
+		
+		QString	name;			///< Asset name, path relative to library
+		quint32	type;			///< Asset type
+		quint64	offset;			///< Data offset from file start
+		quint64	size;			///< Data size
+		qint32	width;			///< Texture width [px]
+		qint32	height;			///< Texture height [px]
+		qint32	bytesPerLine;	///< Texture row length [bytes]
+		quint32	format;			///< Texture format (QImage::Format)
+	};
+	
+	static const char	MAGIC[];			///< File magic, 8 bytes
+	static const quint32	VERSION;			///< Current format version
+	static const int	DATA_ALIGNMENT;		///< Alignment of asset data
+	
+	AssetPack();
+	~AssetPack();
+	
+	/// Opens and maps archive. Returns \b false if archive is missing or invalid.
+	bool open( const QString& path );
+	
+	/// Checks if asset is in archive
+	bool contains( AssetType type, const QString& name ) const;
+	
+	/// Returns asset data. Data is not copied, it's valid as long as archive is open.
+	QByteArray data( AssetType type, const QString& name ) const;
+	
+	/// Returns texture image, using mapped memory
+	QImage image( const QString& name ) const;
+	
+	/// Returns names of all assets of given type
+	QStringList names( AssetType type ) const;
+	
+	/// Returns archive opened at startup, or NULL if there is none
+	static AssetPack* instance();
+	
+	/// Returns default archive path
+	static QString defaultPath();
+
+private:
+
+	/// Returns index entry, or NULL
+	const Entry* entry( AssetType type, const QString& name ) const;
+
+	QFile					_file;		///< Archive file
+	const uchar*			_pData;		///< Mapped file content
+	qint64					_size;		///< File size
+	QHash< QString, Entry >	_bodies;	///< Index of bodies
+	QHash< QString, Entry >	_textures;	///< Index of textures
+};
+
+/// Writes index entry
+QDataStream& operator << ( QDataStream& stream, const AssetPack::Entry& entry );
+
+/// Reads index entry
+QDataStream& operator >> ( QDataStream& stream, AssetPack::Entry& entry );
+
+}
+
+#endif // FLYERASSETPACK_H
+
+// EOF
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPainter>
 
 #include "body.h"
@@ -307,4 +309,18 @@ void Autopilot::render( QPainter& /*painter*/, const QRectF&, const RenderingOpt
 	*/
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Autopilot::saveState( QDataStream& stream ) const
+{
+	stream << _on << _previousError << _errorIntegral << _posErrorIntegral;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Autopilot::restoreState( QDataStream& stream )
+{
+	stream >> _on >> _previousError >> _errorIntegral >> _posErrorIntegral;
+}
+
 }
@@ -102,6 +102,11 @@ public:
 	QLinkedList<TrackSegment>& track(){ return _track; }
 	const QLinkedList<TrackSegment>& track() const { return _track; }
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
+
 private:
 
 	// operations
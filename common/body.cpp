@@ -15,6 +15,7 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include <QPainter>
+#include <QAtomicInt>
 
 #include "textureprovider.h"
 #include "renderingoptions.h"
@@ -34,10 +35,13 @@ static const double DEFAULT_TOLERANCE		= 40E3;	/// 30 kN
 static const double TEMPERATURE_TRANSFER	= 1.0;	// how fast bodies cool down
 static const double TEMPERATURE_TOLERANCE	= 10.0;	///< Tolerated temperature delta [K]
 
+static QAtomicInt nextId( 1 );	///< Id of next body created. Bodies may be created by many threads
+
 // ============================================================================
 // Constructor
 Body::Body( const QString& name ) : Serializable()
 {
+	_id = nextId.fetchAndAddRelaxed( 1 );
 	_name = name;
 	_pBody = NULL;
 	_layers = 0;
@@ -63,21 +67,30 @@ Body::Body( const QString& name ) : Serializable()
 /// Copy constructor. If original has b2body created, creates new body with the same dynamical properties.
 Body::Body( const Body& src ) : Serializable( src )
 {
+	_id					= nextId.fetchAndAddRelaxed( 1 ); // copy is a different body
 	_shapes				= src._shapes;
 	_definition			= src._definition;
 	_name				= src._name;
+	_prototype			= src._prototype;
 	_layers				= src._layers;
 	_texture			= src._texture;
 	_texturePath		= src._texturePath;
 	_texturePosition	= src._texturePosition;
 	_limitTextureToShape	= src._limitTextureToShape;
+	_textureClip		= src._textureClip;
 	_orientation		= src._orientation;
 	_damageCapacity		= src._damageCapacity;
 	_damageTolerance	= src._damageTolerance;
 	_damageReceived		= src._damageReceived;
 	_damageMultiplier	= src._damageMultiplier;
+	_heatCapacity		= 0.0; // not inherited
+	_explosionTemp		= 0.0;
+	_explosionEnergy	= 0.0;
+	_temperature		= 0.0;
+	_awake				= false;
 	
 	
+	_pBody	= NULL;
 	_pWorld	= NULL; // will be set by create() below if appliable
 	
 	// if original has b2body, create and copy dynamic parameters
@@ -159,19 +172,27 @@ void Body::create( World* pWorld )
 // Adds shape to body
 // Returns pointer to shape in body's intenral shape list
 Shape* Body::addShape( const Shape& shape, bool removeUserData )
+{
+	Shape* pShape = appendShape( shape, removeUserData );
+	updateTextureClip();
+	
+	return pShape;
+}
+
+// ============================================================================
+/// Adds shape to body, without baking texture. Used when many shapes are added at once.
+Shape* Body::appendShape( const Shape& shape, bool removeUserData )
 {
 	_shapes.append( shape ); // copy
 	
-	b2ShapeDef* pDef = _shapes.last().def();
-	Q_ASSERT( pDef );
+	Q_ASSERT( _shapes.last().def() );
 	
 	if ( removeUserData )
 	{
-		pDef->userData = NULL;
+		_shapes.last().def()->userData = NULL;
 	}
 	
-	pDef->filter.categoryBits = _layers;
-	pDef->filter.maskBits = _layers;
+	// collision layers are applied when shape is created
 	
 	// create b2 shape if body available
 	if ( _pBody )
@@ -322,6 +343,8 @@ void Body::flip( const QPointF& p1, const QPointF& p2 )
 		_pBody->SetAngularVelocity( angularSpeed );
 		
 	}
+	
+	updateTextureClip();
 }
 
 // ============================================================================
@@ -342,7 +365,14 @@ void Body::render( QPainter& painter, const RenderingOptions& options )
 				
 				if ( _limitTextureToShape )
 				{
-					_texture.fill( painter,  _texturePosition, outline(), options );
+					if ( _textureClip.isNull() )
+					{
+						_texture.fill( painter,  _texturePosition, outline(), options );
+					}
+					else
+					{
+						_textureClip.render( painter, options );
+					}
 				}
 				else
 				{
@@ -382,15 +412,15 @@ bool Body::isConnectedTo( Body* pBody ) const
 	if ( ! _pBody ) return false;
 	if ( pBody == this ) return true;
 	
-	QList<const Body*> visited ;
+	QSet<const Body*> visited ;
 	return doIsConnectedTo( pBody, visited );
 }
 // ============================================================================
 /// Checks if body is connected to another through joints.
-/// List of visited bodies prevents infinite reccursion.
-bool Body::doIsConnectedTo( Body* pBody, QList<const Body*>& visited ) const
+/// Set of visited bodies prevents infinite reccursion.
+bool Body::doIsConnectedTo( Body* pBody, QSet<const Body*>& visited ) const
 {
-	visited.append( this );
+	visited.insert( this );
 	
 	b2JointEdge* pJointEdge = _pBody->GetJointList();
 	while( pJointEdge )
@@ -435,12 +465,8 @@ Body* Body::createCopy() const
 /// Sets collision layers
 void Body::setLayers( int layers )
 {
-	// modify stored definitions
-	for( int i = 0; i < _shapes.size(); i++ )
-	{
-		_shapes[i].def()->filter.categoryBits = layers;
-		_shapes[i].def()->filter.maskBits = layers;
-	}
+	// stored definitions are not modified, they may be shared with other bodies.
+	// Layers are applied when shapes are created.
 	
 	// modify existing shapes
 	if ( _pBody )
@@ -465,6 +491,7 @@ void Body::setTexture( const QString& path )
 {
 	_texture = TextureProvider::loadTexture( path );
 	_texturePath = path;
+	updateTextureClip();
 }
 
 // ============================================================================
@@ -472,6 +499,42 @@ void Body::setTexture( const QString& path )
 void Body::setTexturePosition( const QPointF& pos )
 {
 	_texturePosition = pos;
+	updateTextureClip();
+}
+
+// ============================================================================
+/// Sets 'limit to shape' flag
+void Body::setLimitTextureToShape( bool b )
+{
+	_limitTextureToShape = b;
+	updateTextureClip();
+}
+
+// ============================================================================
+/// Bakes texture limited to shape, if it's not baked yet. Bodies created before their
+/// texture was loaded are baked this way once loading completes.
+void Body::bakeTexture()
+{
+	if ( _limitTextureToShape && _textureClip.isNull() )
+	{
+		updateTextureClip();
+	}
+}
+
+// ============================================================================
+/// Bakes texture limited to shape into sprite, so it doesn't have to be clipped each frame.
+/// Done here, not in render(), as body may be rendered by many threads at once.
+/// If texture is not loaded yet, body keeps filling shape with texture brush.
+void Body::updateTextureClip()
+{
+	if ( _limitTextureToShape && ! _shapes.isEmpty() && _texture.isReady() && ! _texture.isNull() )
+	{
+		_textureClip = _texture.clip( _texturePosition, outline() );
+	}
+	else
+	{
+		_textureClip = TextureClip();
+	}
 }
 
 // ============================================================================
@@ -571,6 +634,8 @@ void Body::fromStream( QDataStream& stream )
 	stream >> _heatCapacity;
 	stream >> _explosionTemp;
 	stream >> _explosionEnergy;
+	
+	updateTextureClip();
 }
 
 // ============================================================================
@@ -749,6 +814,67 @@ void Body::simulate( double dt )
 	}
 }
 
+// ============================================================================
+/// Writes body for snapshot. Unlike toStream(), shapes are written with current orientation,
+/// so flipped bodies which are not part of any machine (shrapnels) can be re-created.
+void Body::saveParams( QDataStream& stream ) const
+{
+	toStream( stream );
+	stream << _prototype << _layers << _orientation << _limitTextureToShape;
+}
+
+// ============================================================================
+/// Restores body written by saveParams(). Shapes are already flipped, only orientation flag is restored.
+void Body::restoreParams( QDataStream& stream )
+{
+	fromStream( stream );
+	
+	bool limitTextureToShape;
+	stream >> _prototype >> _layers >> _orientation >> limitTextureToShape;
+	setLimitTextureToShape( limitTextureToShape );
+}
+
+// ============================================================================
+/// Writes dynamic state to snapshot stream.
+void Body::saveState( QDataStream& stream ) const
+{
+	b2Vec2 pos = position();
+	b2Vec2 v = velocity();
+	
+	stream << double( pos.x ) << double( pos.y ) << angle();
+	stream << double( v.x ) << double( v.y ) << angularVelocity();
+	stream << _damageReceived << _temperature << _awake;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream. Body should be already created.
+void Body::restoreState( QDataStream& stream )
+{
+	double x, y, a, vx, vy, va;
+	bool awake;
+	
+	stream >> x >> y >> a;
+	stream >> vx >> vy >> va;
+	stream >> _damageReceived >> _temperature >> awake;
+	
+	if ( _pBody )
+	{
+		_pBody->SetXForm( b2Vec2( x, y ), a );
+		_pBody->SetLinearVelocity( b2Vec2( vx, vy ) );
+		_pBody->SetAngularVelocity( va );
+	}
+	else
+	{
+		setPosition( b2Vec2( x, y ) );
+		setAngle( a );
+	}
+	
+	if ( awake )
+	{
+		wakeUp();
+	}
+}
+
 // ============================================================================
 /// Removes hsape from body
 void Body::removeShape( const Shape* pShape )
@@ -766,6 +892,7 @@ void Body::removeShape( const Shape* pShape )
 	if ( index >= 0 )
 	{
 		_shapes.removeAt( index );
+		updateTextureClip();
 	}
 	else
 	{
@@ -793,13 +920,15 @@ void Body::setShape( const QPolygonF& shape, double friction, double restitution
 			def.density = density;
 			
 			Shape shape( & def );
-			addShape( shape );
+			appendShape( shape, false );
 		}
 		else
 		{
 			//qDebug("Triangle rejected");
 		}
 	}
+	
+	updateTextureClip();
 }
 	
 // ============================================================================
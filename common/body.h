@@ -18,6 +18,7 @@
 #define FLYERBODY_H
 
 #include <QList>
+#include <QSet>
 #include <QPainterPath>
 #include <QTransform>
 #include <QString>
@@ -64,6 +65,9 @@ public:
 	/// Retruns underlying box2d body
 	b2Body* b2body() const { return _pBody; }
 	
+	/// Unique id of the body. Unlike address, id is never reused by other body
+	int id() const { return _id; }
+	
 	
 	World* world() const { return _pWorld; }		///< World in which the body exists
 	
@@ -126,6 +130,10 @@ public:
 	QString name() const { return _name; }
 	void setName( const QString& s ) { _name = s; }
 	
+	/// Name of library prototype body was created from, if any
+	QString prototype() const { return _prototype; }
+	void setPrototype( const QString& s ) { _prototype = s; }
+	
 	/// Sets body's collision layers
 	void setLayers( int layers );
 	int layers() const { return _layers; }
@@ -139,8 +147,12 @@ public:
 	const QPointF& texturePosition() const { return _texturePosition; }
 	
 	/// Sets 'limit to shape' flag
-	void setLimitTextureToShape( bool b ) { _limitTextureToShape = b; }
+	void setLimitTextureToShape( bool b );
 	bool limitTextureToShap() const { return _limitTextureToShape; }
+	/// Checks if texture limited to shape is baked into sprite
+	bool textureBaked() const { return ! _textureClip.isNull(); }
+	/// Bakes texture limited to shape, if it's not baked yet and texture is loaded now
+	void bakeTexture();
 	
 	PhysicalObject* parent() const { return _pParent; }
 	void setParent( PhysicalObject* p ) { _pParent = p; }
@@ -152,6 +164,17 @@ public:
 	
 	/// Simualates body
 	void simulate( double dt );
+	
+	// snapshots
+	
+	/// Writes definition, shapes, texture and collision layers, as they are now
+	void saveParams( QDataStream& stream ) const;
+	/// Restores body written by saveParams(). Should be called before body is created.
+	void restoreParams( QDataStream& stream );
+	/// Writes transform, velocity, damage and heat
+	void saveState( QDataStream& stream ) const;
+	/// Restores state written by saveState()
+	void restoreState( QDataStream& stream );
 
 	// damage
 
@@ -196,11 +219,15 @@ protected:
 private:
 
 	// operations
-	bool doIsConnectedTo( Body* pBody, QList<const Body*>& visited ) const;
+	bool doIsConnectedTo( Body* pBody, QSet<const Body*>& visited ) const;
+	void updateTextureClip();	///< Bakes texture limited to shape
+	Shape* appendShape( const Shape& shape, bool removeUserData );	///< Adds shape without baking texture
 
 	// config
 	
+	int			_id;			///< Unique id
 	QString		_name;			///< Body name
+	QString		_prototype;		///< Library prototype name
 	b2Body*		_pBody;
 	b2BodyDef	_definition;
 	QList<Shape>	_shapes;
@@ -231,6 +258,7 @@ private:
 	QString		_texturePath;	///< Path to texture
 	QPointF		_texturePosition;
 	bool		_limitTextureToShape;	///< Cuts texture using shape.
+	TextureClip	_textureClip;			///< Texture baked into shape, used when texture is limited to shape
 };
 
 }
@@ -14,10 +14,19 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <math.h>
+
 #include <QDir>
 #include <QCoreApplication>
+#include <QBuffer>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPolygonF>
 
 #include "body.h"
+#include "assetpack.h"
+#include "common.h"
 
 #include "bodyprovider.h"
 
@@ -25,19 +34,255 @@ namespace Flyer
 {
 
 static QString libraryPathCache; ///< Library path cache
+static const int FRACTURE_PATTERNS = 4;	///< Fracture patterns per prototype and orientation
+
+/// Parsed body, with time it took to parse it
+struct Prototype
+{
+	Body*	pBody;
+	double	parseTime;	///< [ms]
+	QList< QList<Body*> >	fractures[2];	///< Fracture patterns - fragments, for normal and flipped body
+};
+
+static QHash< QString, Prototype >	prototypes;		///< Prototype cache
+static QMutex						prototypesMutex;	///< Guards prototype cache and statistics
+static bool							caching = true;	///< If prototype cache is used
+static BodyProvider::Statistics		stats = { 0, 0, 0.0, 0.0, 0.0 };	///< Cache statistics
+
+// ============================================================================
+/// Parses body from asset pack, if available. Otherwise, from file in library dir.
+static Body* parseBody( const QString& name )
+{
+	Body* pBody = new Body();
+	
+	AssetPack* pPack = AssetPack::instance();
+	if ( pPack && pPack->contains( AssetPack::AssetBody, name ) )
+	{
+		QByteArray data = pPack->data( AssetPack::AssetBody, name );
+		QBuffer buffer( & data );
+		buffer.open( QIODevice::ReadOnly );
+		pBody->fromDevice( & buffer );
+	}
+	else
+	{
+		QString path = BodyProvider::libraryPath() + "/" + name; // TODO stupid and unreliable
+		pBody->fromFile( path );
+	}
+	
+	return pBody;
+}
+
+// ============================================================================
+/// Precomputes fracture patterns of prototype, for body in both orientations.
+/// Patterns are cuts through the center, at evenly spaced angles - qrand() is not used,
+/// so prototype loading doesn't disturb random sequence of the simulation.
+static void buildFractures( Prototype* pPrototype )
+{
+	Body flipped( *pPrototype->pBody );
+	flipped.flip( QPointF( 0, 0 ), QPointF( 1, 0 ) );
+	
+	const Body* bodies[2] = { pPrototype->pBody, & flipped };
+	for( int o = 0; o < 2; o++ )
+	{
+		QPolygonF outline = bodies[o]->outline();
+		for( int i = 0; i < FRACTURE_PATTERNS; i++ )
+		{
+			double angle = ( i + 0.5 ) * M_PI / FRACTURE_PATTERNS;
+			QList<QPolygonF> shapes = splitPolygonAtAngle( outline, angle );
+			if ( shapes.size() >= 2 )
+			{
+				pPrototype->fractures[o].append( BodyProvider::fragmentBody( bodies[o], shapes ) );
+			}
+		}
+	}
+}
+
+// ============================================================================
+/// Parses body and stores it as prototype, if caching is enabled. Returns parsed body.
+/// Caller must hold prototypesMutex.
+static Body* parsePrototype( const QString& name )
+{
+	double start = getms();
+	Body* pParsed = parseBody( name );
+	double parseTime = getms() - start;
+	
+	stats.misses++;
+	stats.parseTime += parseTime;
+	
+	if ( caching )
+	{
+		Prototype prototype;
+		prototype.pBody = pParsed;
+		prototype.parseTime = parseTime;
+		
+		double fractureStart = getms();
+		buildFractures( & prototype );
+		stats.fractureTime += getms() - fractureStart;
+		
+		prototypes.insert( name, prototype );
+	}
+	
+	return pParsed;
+}
 
 // ============================================================================
 /// Loads body from library. BOdy name is file name relative to library dir.
 /// Caller is responsiblefor destroying allocated body.
+/// Body file is parsed only once, next bodies are copies of cached prototype.
 Body* BodyProvider::loadBody( const QString& name )
 {
-	QString path = libraryPath() + "/" + name; // TODO stupid and unreliable
-	Body* pBody = new Body();
-	pBody->fromFile( path );
+	QMutexLocker locker( & prototypesMutex );
+	
+	if ( ! prototypes.contains( name ) )
+	{
+		Body* pParsed = parsePrototype( name );
+		if ( ! caching )
+		{
+			return pParsed;
+		}
+	}
+	else
+	{
+		stats.hits++;
+		stats.savedTime += prototypes[ name ].parseTime;
+	}
+	
+	// texture could be not loaded yet when prototype was parsed
+	Body* pPrototype = prototypes[ name ].pBody;
+	pPrototype->bakeTexture();
+	
+	// instantiate
+	Body* pBody = new Body( *pPrototype );
+	pBody->setPrototype( name );
+	
+	// not copied by copy constructor
+	pBody->setHeatCapacity( pPrototype->heatCapacity() );
+	pBody->setExplosionTemp( pPrototype->explosionTemp() );
+	pBody->setExplosionEnergy( pPrototype->explosionEnergy() );
 	
 	return pBody;
 }
 
+// ============================================================================
+/// Parses body into prototype cache, so later loadBody() calls only copy it.
+/// Thread-safe, may be used to warm up the cache on worker thread. Does nothing if caching is disabled.
+void BodyProvider::preload( const QString& name )
+{
+	QMutexLocker locker( & prototypesMutex );
+	
+	if ( caching && ! prototypes.contains( name ) )
+	{
+		parsePrototype( name );
+	}
+}
+
+// ============================================================================
+/// Creates fragments of breaking body, as copies of fragments from randomly selected fracture pattern
+/// of body's prototype. Fragments are in body coordinates, and are not created in the world.
+/// Returns false if body doesn't come from cached prototype, or the prototype can't be fractured.
+bool BodyProvider::loadFragments( const Body* pBody, QList<Body*>* pFragments )
+{
+	Q_ASSERT( pBody && pFragments );
+	
+	QMutexLocker locker( & prototypesMutex );
+	
+	if ( ! prototypes.contains( pBody->prototype() ) )
+	{
+		return false;
+	}
+	
+	const QList< QList<Body*> >& patterns = prototypes[ pBody->prototype() ].fractures[ pBody->orientation() < 0 ? 1 : 0 ];
+	if ( patterns.isEmpty() )
+	{
+		return false;
+	}
+	
+	foreach( Body* pFragment, patterns[ qrand() % patterns.size() ] )
+	{
+		// texture could be not loaded yet when pattern was created
+		pFragment->bakeTexture();
+		pFragments->append( new Body( *pFragment ) );
+	}
+	
+	return true;
+}
+
+// ============================================================================
+/// Creates fragment bodies from shapes body was split into. Fragments have body's texture
+/// and material, but are not positioned nor created in the world. Too small shapes are skipped.
+QList<Body*> BodyProvider::fragmentBody( const Body* pBody, const QList<QPolygonF>& shapes )
+{
+	Q_ASSERT( pBody && ! pBody->shapes().isEmpty() );
+	
+	// get basic infromation form source body
+	const Shape& firstShape = pBody->shapes().first(); // const - don't detach definition
+	float friction		= firstShape.def()->friction;
+	float restitution	= firstShape.def()->restitution;
+	float density		= firstShape.def()->density;
+	
+	if ( density == 0 )
+	{
+		density = 100; // TODO dome stupid value, calculate it better.
+	}
+	
+	QList<Body*> fragments;
+	foreach( const QPolygonF& shape, shapes )
+	{
+		double area = convexPolygonArea( shape );
+		if ( area >= 1E-4 )
+		{
+			Body* pFragment = new Body("shrapnell");
+			pFragment->setTexture( pBody->texture() );
+			pFragment->setLimitTextureToShape( true );
+			pFragment->setShape( shape, friction, restitution, density );
+			fragments.append( pFragment );
+		}
+	}
+	
+	return fragments;
+}
+
+// ============================================================================
+/// Enables/disables prototype cache. When disabled, each body is parsed from library.
+void BodyProvider::setCaching( bool enabled )
+{
+	QMutexLocker locker( & prototypesMutex );
+	caching = enabled;
+}
+
+// ============================================================================
+/// Deletes cached prototypes and resets statistics.
+void BodyProvider::clearCache()
+{
+	QMutexLocker locker( & prototypesMutex );
+	foreach( const Prototype& prototype, prototypes )
+	{
+		delete prototype.pBody;
+		for( int o = 0; o < 2; o++ )
+		{
+			foreach( const QList<Body*>& pattern, prototype.fractures[o] )
+			{
+				qDeleteAll( pattern );
+			}
+		}
+	}
+	prototypes.clear();
+	
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.parseTime = 0.0;
+	stats.savedTime = 0.0;
+	stats.fractureTime = 0.0;
+}
+
+// ============================================================================
+/// Returns cache statistics
+BodyProvider::Statistics BodyProvider::statistics()
+{
+	QMutexLocker locker( & prototypesMutex );
+	return stats;
+}
+
 // ============================================================================
 /// Returns absolute path to directory which is a body library.
 QString BodyProvider::libraryPath()
@@ -18,6 +18,8 @@
 #define FLYERBODYPROVIDER_H
 
 #include <QString>
+#include <QList>
+#include <QPolygonF>
 
 namespace Flyer
 {
@@ -26,6 +28,10 @@ class Body;
 
 /**
 Body library manager. Provides boduies form body library.
+Each body file is parsed once, into prototype. Bodies are created as copies of prototypes,
+sharing shape definitions and texture.
+Fracture patterns - prototype split into fragments, with shapes triangulated and textures baked -
+are precomputed with the prototype, so breaking body only copies the fragments.
 @author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
 
@@ -33,11 +39,39 @@ class BodyProvider
 {
 public:
 	
+	/// Prototype cache statistics
+	struct Statistics
+	{
+		int		hits;			///< Bodies created from cached prototype
+		int		misses;			///< Bodies which had to be parsed
+		double	parseTime;		///< Time spent parsing [ms]
+		double	savedTime;		///< Parsing time saved by cache [ms]
+		double	fractureTime;	///< Time spent precomputing fracture patterns [ms]
+	};
+	
 	/// Loads body from library.
 	static Body* loadBody( const QString& name );
 	
+	/// Parses body into prototype cache, without creating instance
+	static void preload( const QString& name );
+	
+	/// Creates fragments of breaking body from one of prototype's fracture patterns
+	static bool loadFragments( const Body* pBody, QList<Body*>* pFragments );
+	
+	/// Creates fragments of body split into shapes, in body coordinates
+	static QList<Body*> fragmentBody( const Body* pBody, const QList<QPolygonF>& shapes );
+	
 	/// Returns path to body library
 	static QString libraryPath();
+	
+	/// Enables/disables prototype cache
+	static void setCaching( bool enabled );
+	
+	/// Removes all prototypes, resets statistics
+	static void clearCache();
+	
+	/// Returns prototype cache statistics
+	static Statistics statistics();
 };
 
 }
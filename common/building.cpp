@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "b2dqt.h"
 #include "world.h"
 #include "ground.h"
@@ -25,11 +27,17 @@
 namespace Flyer
 {
 
+static const int SMALL_BUILDING_TYPES = 4;			///< Number of small house bodies
+static const double SMALL_BUILDING_WIDTH = 9.0;	///< Small house width [m]
+
 // ============================================================================
 // Constructor
 Building::Building ( World* pWorld ) : PhysicalObject( pWorld )
 {
 	_pBody = NULL;
+	_type = 0;
+	_background = false;
+	_width = 0.0;
 }
 
 // ============================================================================
@@ -46,12 +54,16 @@ QRectF Building::boundingRect() const
 }
 
 // ============================================================================
-/// Initializes small building.
-void Building::initSmallBuilding( double location, bool background )
+/// Initializes small building. \b type is 1-based; random type is used if it's 0.
+void Building::initSmallBuilding( double location, bool background, int type )
 {
-	int housenum = ( qrand() % 4 ) + 1;
-	QString fileName = QString("house_small_%1.body").arg( housenum );
-	_pBody = BodyProvider::loadBody( fileName );
+	if ( type <= 0 )
+	{
+		type = ( qrand() % SMALL_BUILDING_TYPES ) + 1;
+	}
+	_pBody = BodyProvider::loadBody( smallBuildingBody( type ) );
+	_type = type;
+	_background = background;
 	
 	// set physical layer
 	if ( background ) setLayers( PhysLayerBackground );
@@ -62,7 +74,8 @@ void Building::initSmallBuilding( double location, bool background )
 	else setRenderLayer( LayerBuildings );
 	
 	b2Vec2 pos = b2Vec2(location, world()->ground()->height( location ) );
-	_width = 9;
+	_width = SMALL_BUILDING_WIDTH;
+	_position = pos;
 	_pBody->setPosition( pos );
 	_pBody->create( world() );
 	setName( "Small building" );
@@ -73,11 +86,11 @@ void Building::initSmallBuilding( double location, bool background )
 }
 
 // ============================================================================
-/// Creates random small building
-Building* Building::createSmallBuilding( World* pWorld, double location, bool background )
+/// Creates small building. Random type is used if \b type is 0.
+Building* Building::createSmallBuilding( World* pWorld, double location, bool background, int type )
 {
 	Building* pBuilding = new Building( pWorld );
-	pBuilding->initSmallBuilding( location, background );
+	pBuilding->initSmallBuilding( location, background, type );
 	
 	// add object
 	int objectClass = World::ObjectStatic;
@@ -87,6 +100,76 @@ Building* Building::createSmallBuilding( World* pWorld, double location, bool ba
 	
 }
 
+// ============================================================================
+/// Returns number of small building types
+int Building::smallBuildingTypes()
+{
+	return SMALL_BUILDING_TYPES;
+}
+
+// ============================================================================
+/// Returns width of small building
+double Building::smallBuildingWidth()
+{
+	return SMALL_BUILDING_WIDTH;
+}
+
+// ============================================================================
+/// Returns name of body file for small building type (1-based)
+QString Building::smallBuildingBody( int type )
+{
+	return QString("house_small_%1.body").arg( type );
+}
+
+// ============================================================================
+/// Plans buildings of town between \b start and \b end: row of foreground buildings and row
+/// of background ones, with random types and spacing. Uses qrand(), doesn't touch the world,
+/// so it can be run on worker thread.
+QList<Building::Placement> Building::planTown( double start, double end )
+{
+	QList<Placement> buildings;
+	Placement placement;
+	
+	// foreground
+	placement.background = false;
+	placement.x = start;
+	while( placement.x < end )
+	{
+		placement.type = ( qrand() % SMALL_BUILDING_TYPES ) + 1;
+		buildings.append( placement );
+		
+		double spacing = 2.0 + ((qrand()%400)/100.0);
+		placement.x += spacing * SMALL_BUILDING_WIDTH;
+	}
+	
+	// background
+	placement.background = true;
+	placement.x = start + 20.0 * ((qrand()%100)/100.0);
+	while( placement.x < end )
+	{
+		placement.type = ( qrand() % SMALL_BUILDING_TYPES ) + 1;
+		buildings.append( placement );
+		
+		double spacing = 2.0 + ((qrand()%400)/100.0);
+		placement.x += spacing * SMALL_BUILDING_WIDTH;
+	}
+	
+	return buildings;
+}
+
+// ============================================================================
+/// Creates town between \b start and \b end in the world. Returns number of buildings created.
+int Building::createTown( World* pWorld, double start, double end )
+{
+	QList<Placement> buildings = planTown( start, end );
+	foreach( const Placement& placement, buildings )
+	{
+		createSmallBuilding( pWorld, placement.x, placement.background, placement.type );
+	}
+	
+	return buildings.size();
+}
+
 // ============================================================================
 /// Creates random city building
 Building* Building::createLargeBuilding( World* /*pWorld*/, double /*location*/, bool /*background*/ )
@@ -95,5 +178,11 @@ Building* Building::createLargeBuilding( World* /*pWorld*/, double /*location*/,
 	return NULL;
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void Building::saveParams( QDataStream& stream ) const
+{
+	stream << double( _position.x ) << _background << _type;
+}
 
 }
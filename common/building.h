@@ -18,6 +18,7 @@
 #define FLYERBUILDING_H
 
 #include <QPainterPath>
+#include <QList>
 
 #include "physicalobject.h"
 
@@ -42,10 +43,34 @@ public:
 	double width() const { return _width; }
 	double location() const { return _position.x; }
 	
-	void initSmallBuilding( double location, bool background );
+	void initSmallBuilding( double location, bool background, int type = 0 );
 	
-	static Building* createSmallBuilding( World* pWorld, double location, bool background );
+	static Building* createSmallBuilding( World* pWorld, double location, bool background, int type = 0 );
 	static Building* createLargeBuilding( World* pWorld, double location, bool background );
+	
+	// small building types
+	
+	static int smallBuildingTypes();				///< Number of small building types
+	static double smallBuildingWidth();				///< Width of small building [m]
+	static QString smallBuildingBody( int type );	///< Body file of small building type
+	
+	// towns
+	
+	/// Planned location of small building in a town
+	struct Placement
+	{
+		double	x;			///< Location [m]
+		bool	background;	///< If building is in background
+		int		type;		///< Small building type
+	};
+	
+	static QList<Placement> planTown( double start, double end );		///< Plans buildings of town
+	static int createTown( World* pWorld, double start, double end );	///< Creates town, returns number of buildings
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Building"; }
+	virtual void saveParams( QDataStream& stream ) const;
 
 private:
 
@@ -58,6 +83,7 @@ private:
 	b2Vec2			_position;		///< Buildong's position
 	double			_width;
 	bool			_background;
+	int				_type;			///< Small building type
 };
 
 }
@@ -26,6 +26,7 @@ namespace Flyer
 
 static const double MINIMAL_MOMENTUM	= 1.0; ///< below this momentum bullet is removed
 static const double DAMAGE_MULTIPLIER	= 10;	///< Damage multiplier
+static const double TAIL_TIMESPAN		= 0.05;	///< Flame tail lifespan [s]
 
 // ============================================================================
 // Constructor
@@ -55,10 +56,12 @@ Bullet::~Bullet()
 // Returns bullet's boundong rect
 QRectF Bullet::boundingRect() const
 {
-	// bullet fired, return rect
+	// bullet fired, return rect including flame tail
 	b2Vec2 pos = _pBody->position();
+	b2Vec2 tail = pos + TAIL_TIMESPAN * _pBody->velocity();
 	
-	return QRectF( pos.x - _size/2, pos.y - _size/2, _size, _size );
+	QRectF br = QRectF( vec2point( pos ), vec2point( tail ) ).normalized();
+	return br.adjusted( -_size/2, -_size/2, _size/2, _size/2 );
 }
 
 // ============================================================================
@@ -69,8 +72,6 @@ void Bullet::render ( QPainter& painter, const QRectF&, const RenderingOptions&
 	b2Vec2 pos = _pBody->position();
 	b2Vec2 vel = _pBody->velocity();
 	
-	double timespan = 0.05; // flame tail lifespan
-	
 	if ( qrand() % 2 == 0 )
 	{
 		painter.setPen( Qt::red );
@@ -80,7 +81,7 @@ void Bullet::render ( QPainter& painter, const QRectF&, const RenderingOptions&
 		painter.setPen( QColor( 255, 128, 0 ) );
 	}
 	
-	QPointF endPos = vec2point( pos + timespan* vel );
+	QPointF endPos = vec2point( pos + TAIL_TIMESPAN * vel );
 	painter.drawLine( vec2point( pos ), endPos );
 }
 
@@ -59,15 +59,12 @@ QRectF Cloud::boundingRect() const
 }
 
 // ============================================================================
-/// Renders cloud. 
+/// Renders cloud. Expired clouds are not drawn, they are removed by 1-second timer.
+/// Rendering may be called from multiple threads at once, so object is not modified here.
 void Cloud::render ( QPainter& painter, const QRectF& /*rect*/, const RenderingOptions& /*options*/ )
 {
 	double age = world()->time() - _birdthDate;
-	if ( age > _lifespan )
-	{
-		world()->removeObject( this );
-	}
-	else
+	if ( age <= _lifespan )
 	{
 		// find alpha
 		double alpha = _color.alphaF() * (1.0 - age / _lifespan );
@@ -83,7 +80,7 @@ void Cloud::render ( QPainter& painter, const QRectF& /*rect*/, const RenderingO
 		
 		painter.setBrush( currentColor );
 		painter.setPen( Qt::NoPen );
-		painter.drawEllipse( QRectF( p.x, p.y, currentRadius*2, currentRadius*2 ) );
+		painter.drawEllipse( QRectF( p.x - currentRadius, p.y - currentRadius, currentRadius*2, currentRadius*2 ) );
 	}
 }
 
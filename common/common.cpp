@@ -72,10 +72,15 @@ QPolygonF findApproximateOutline( const QPainterPath& path )
 /// Splits polygon in two
 QList<QPolygonF> splitPolygonRandomly( const QPolygonF& polygon, QLineF* pdebugout )
 {
-	QRectF br = polygon.boundingRect();
-	
 	// get random angle on cutting
-	double angle = random01()* 6.28;
+	return splitPolygonAtAngle( polygon, random01()* 6.28, pdebugout );
+}
+
+// ============================================================================
+/// Splits polygon in two, with line through center of polygon's bounding rect, at specified angle.
+QList<QPolygonF> splitPolygonAtAngle( const QPolygonF& polygon, double angle, QLineF* pdebugout )
+{
+	QRectF br = polygon.boundingRect();
 	
 	// cut throught the center
 	QPointF center = br.center();
@@ -72,6 +72,9 @@ QPolygonF findApproximateOutline( const QPainterPath& path );
 /// Splits polygon randomly into two, similary-sized polygons
 QList<QPolygonF> splitPolygonRandomly( const QPolygonF& polygon, QLineF* pdebugout = NULL );
 
+/// Splits polygon into two, cutting it through the center at angle
+QList<QPolygonF> splitPolygonAtAngle( const QPolygonF& polygon, double angle, QLineF* pdebugout = NULL );
+
 /// Splits polygon into two, cutting it with the supplied line
 QList<QPolygonF> splitPolygon( const QPolygonF& polygon, const QLineF& line );
 
@@ -57,7 +57,21 @@ HEADERS += activeattachpoint.h \
  hangar.h \
  message.h \
  physicalobject.h \
- pilot.h
+ pilot.h \
+ tiledrenderer.h \
+ layercache.h \
+ particlesystem.h \
+ assetpack.h \
+ texturecache.h \
+ jobgraph.h \
+ worldsnapshot.h \
+ inputlog.h \
+ worldstreamer.h \
+ terraingenerator.h \
+ projectilesystem.h \
+ threatindex.h \
+ simulationscheduler.h \
+ aerokernel.h
 
 
 SOURCES += activeattachpoint.cpp \
@@ -106,7 +120,21 @@ SOURCES += activeattachpoint.cpp \
  message.cpp \
  common.cpp \
  physicalobject.cpp \
- pilot.cpp
+ pilot.cpp \
+ tiledrenderer.cpp \
+ layercache.cpp \
+ particlesystem.cpp \
+ assetpack.cpp \
+ texturecache.cpp \
+ jobgraph.cpp \
+ worldsnapshot.cpp \
+ inputlog.cpp \
+ worldstreamer.cpp \
+ terraingenerator.cpp \
+ projectilesystem.cpp \
+ threatindex.cpp \
+ simulationscheduler.cpp \
+ aerokernel.cpp
 
 
 QT += opengl
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "contactfuse.h"
 #include "world.h"
 #include "machine.h"
@@ -54,4 +56,18 @@ void ContactFuse::damage ( double force )
 	}
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void ContactFuse::saveState( QDataStream& stream ) const
+{
+	stream << _damageReceived << _destroyed;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void ContactFuse::restoreState( QDataStream& stream )
+{
+	stream >> _damageReceived >> _destroyed;
+}
+
 }
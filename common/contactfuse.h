@@ -37,6 +37,11 @@ public:
 	virtual void damage ( double force );
 	
 	void setEnergy( double e ) { _energy = e; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 private:
 
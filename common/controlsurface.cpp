@@ -14,11 +14,14 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPainter>
 
 #include "body.h"
 #include "b2dqt.h"
 #include "plane.h"
+#include "world.h"
 #include "controlsurface.h"
 
 namespace Flyer {
@@ -54,7 +57,9 @@ QPointF ControlSurface::aerodynamicForce() const
 		b2Body* pBody = body()->b2body();
 		double bodyAngle = pBody->GetAngle(); // body angle
 	
-		b2Vec2 velocity = pBody->GetLinearVelocity();
+		// airspeed
+		QPointF wind = parent()->world()->environment()->wind( vec2point( pBody->GetPosition() ) );
+		b2Vec2 velocity = pBody->GetLinearVelocity() - point2vec( wind );
 		double v = velocity.Length();
 		double velAngle = atan2( velocity.y, velocity.x );
 	
@@ -96,6 +101,21 @@ QPointF ControlSurface::calculateForce( double velocity, double sinAttack ) cons
 	return QPointF( drag, lift );	
 }
 
+// ============================================================================
+/// Returns current coefficients. Control surface deflection is added to inclination,
+/// air density is not taken into account.
+AeroKernel::Coefficients ControlSurface::coefficients() const
+{
+	AeroKernel::Coefficients c;
+	c.inclination = ( _value*_step + _inclination ) *parent()->orientation();
+	c.lift = _currentLift;
+	c.dragH = _currentDragH;
+	c.dragV = _currentDragV;
+	c.densityFactor = 0.0;
+	
+	return c;
+}
+
 // ============================================================================
 /// Damages control surface.
 void ControlSurface::damage(double force)
@@ -181,4 +201,20 @@ double ControlSurface::status() const
 	return ( _currentMaxValue - _currentMinValue )  / 2.0;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void ControlSurface::saveState( QDataStream& stream ) const
+{
+	Surface::saveState( stream );
+	stream << _value << _currentMaxValue << _currentMinValue;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void ControlSurface::restoreState( QDataStream& stream )
+{
+	Surface::restoreState( stream );
+	stream >> _value >> _currentMaxValue >> _currentMinValue;
+}
+
 }
@@ -42,11 +42,17 @@ public:
 	double value() const { return _value; }
 	
 	void setStep( double s ) { _step = s; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 protected:
 
 	virtual QPointF aerodynamicForce() const;
 	virtual QPointF calculateForce(double velocity, double sinAttack) const;
+	virtual AeroKernel::Coefficients coefficients() const;
 
 	// config
 	double	_step;	///< Actual max angle [radians]
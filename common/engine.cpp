@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPainter>
 
 #include "Box2D.h"
@@ -22,7 +24,8 @@
 #include "body.h"
 #include "plane.h"
 #include "world.h"
-#include "cloud.h"
+#include "particlesystem.h"
+#include "aerokernel.h"
 
 namespace Flyer
 {
@@ -36,12 +39,18 @@ Engine::Engine ( Machine* pParent, const QString& name, double thrust, const QPo
 	_throttle	= 0.0;
 	_normal		= normal;
 	_propellerBladeLength = 0;
+	_pSmoke		= NULL;
 }
 
 // ============================================================================
 // Destructor
 Engine::~Engine()
 {
+	// let the smoke dissolve
+	if ( _pSmoke )
+	{
+		_pSmoke->release();
+	}
 }
 
 // ============================================================================
@@ -107,10 +116,20 @@ void Engine::simulate ( double dt )
 	{
 		const b2Vec2& pos = body()->b2body()->GetPosition();
 		
-		QPointF thrust	= thrustForce();
-		body()->b2body()->ApplyForce
-			( 10.0 * b2Vec2( thrust.x(), thrust.y() ) // newtons per kg
-			, pos );
+		AeroKernel* pKernel = parent()->world()->aeroKernel();
+		if ( pKernel->enabled() )
+		{
+			// rotation and air density are applied by kernel
+			QPointF thrust = 10.0 * _normal * _throttle * _currentMaxThrust; // newtons per kg
+			pKernel->addEngine( body()->b2body(), b2Vec2( thrust.x(), thrust.y() ) );
+		}
+		else
+		{
+			QPointF thrust	= thrustForce();
+			body()->b2body()->ApplyForce
+				( 10.0 * b2Vec2( thrust.x(), thrust.y() ) // newtons per kg
+				, pos );
+		}
 			
 		// if engine damaged - create smoke
 		double s = status();
@@ -121,7 +140,11 @@ void Engine::simulate ( double dt )
 			double prop = smokesPerSecond*dt * (1.0-s); // propability of emitting smoke
 			if ( r < prop )
 			{
-				Cloud::createSmoke( parent()->world(), pos );
+				if ( ! _pSmoke )
+				{
+					_pSmoke = ParticleSystem::createSmoke( parent()->world() );
+				}
+				_pSmoke->addSmoke( pos );
 			}
 		}
 	}
@@ -205,5 +228,18 @@ double Engine::status() const
 	return _currentMaxThrust / _maxThrust;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Engine::saveState( QDataStream& stream ) const
+{
+	stream << _throttle << _currentMaxThrust;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Engine::restoreState( QDataStream& stream )
+{
+	stream >> _throttle >> _currentMaxThrust;
+}
 
 }
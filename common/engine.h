@@ -25,6 +25,8 @@
 namespace Flyer
 {
 
+class ParticleSystem;
+
 /**
 	This class impelemnts generic engine behavior.
 	
@@ -55,6 +57,10 @@ public:
 	void setPropellerBladeLength( double length ) { _propellerBladeLength = length; }
 	void setPropllerAxis( const QLineF& axis ) { _propellerAxis = axis; }
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 private:
 
@@ -72,6 +78,8 @@ private:
 	QPointF	_propellerCenter;		///< Propeller mounting point
 	double	_propellerBladeLength;	///< Blade lenght
 	QLineF	_propellerAxis;			///< Propeller axis 
+	
+	ParticleSystem*	_pSmoke;		///< Smoke emitter, created when engine starts smoking
 };
 
 }
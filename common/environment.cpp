@@ -14,16 +14,28 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <math.h>
+
+#include <QDataStream>
+
 #include "environment.h"
 
 namespace Flyer
 {
 
+static const double GRID_STEP		= 250.0;	///< Distance between grid nodes [m]
+static const double RASTER_DISTANCE	= 50.0;		///< Cell is re-rasterized after moving this far [m]
+static const double WIND_ALTITUDE	= 1000.0;	///< Altitude at which prevailing wind is specified [m]
+
 // ============================================================================
 // Constructor
 Environment::Environment()
 {
-	// nope
+	_originX = 0;
+	_originY = 0;
+	_columns = 0;
+	_rows = 0;
+	_wind = 0;
 }
 
 // ============================================================================
@@ -33,28 +45,293 @@ Environment::~Environment()
 	// nope
 }
 
+// ============================================================================
+/// Creates grid covering the boundary, with one node of margin on each side.
+void Environment::setBoundary( const QRectF& boundary )
+{
+	_boundary = boundary;
+	
+	_originX = boundary.left() - GRID_STEP;
+	_originY = boundary.top() - GRID_STEP;
+	_columns = int( ceil( boundary.width() / GRID_STEP ) ) + 3;
+	_rows = int( ceil( boundary.height() / GRID_STEP ) ) + 3;
+	
+	int nodes = _columns * _rows;
+	_pressure.resize( nodes );
+	_density.resize( nodes );
+	_temperature.resize( nodes );
+	_windX.resize( nodes );
+	_windY.resize( nodes );
+	
+	rebuild( QRect( 0, 0, _columns, _rows ) );
+}
+
+// ============================================================================
+/// Moves weather cells with prevailing wind. Cells leaving the world on one side
+/// re-enter on the other. Cells which moved far enough are re-rasterized.
+void Environment::simulate( double dt )
+{
+	for( int i = 0; i < _cells.size(); i++ )
+	{
+		WeatherCell& cell = _cells[i];
+		
+		cell.position.rx() += windX( cell.position.y() ) * dt;
+		if ( cell.position.x() > _boundary.right() + cell.radius )
+		{
+			cell.position.rx() -= _boundary.width() + 2 * cell.radius;
+		}
+		else if ( cell.position.x() < _boundary.left() - cell.radius )
+		{
+			cell.position.rx() += _boundary.width() + 2 * cell.radius;
+		}
+		
+		if ( qAbs( cell.position.x() - cell.rasterPosition.x() ) >= RASTER_DISTANCE )
+		{
+			QRect oldNodes = footprint( cell.rasterPosition, cell.radius );
+			cell.rasterPosition = cell.position;
+			QRect newNodes = footprint( cell.position, cell.radius );
+			
+			// separate rects, becouse cell may have wrapped around
+			if ( oldNodes.intersects( newNodes ) )
+			{
+				rebuild( oldNodes | newNodes );
+			}
+			else
+			{
+				rebuild( oldNodes );
+				rebuild( newNodes );
+			}
+		}
+	}
+}
+
+// ============================================================================
+/// Recalculates grid nodes: standard atmosphere, prevailing wind and weather cells.
+void Environment::rebuild( const QRect& nodes )
+{
+	QRect r = nodes & QRect( 0, 0, _columns, _rows );
+	
+	for( int j = r.top(); j <= r.bottom(); j++ )
+	{
+		double y = _originY + j * GRID_STEP;
+		
+		// standard atmosphere
+		double pressure = 101.3E3 - 7.18E3 * ( y / 1000.0 ); // assumin 101.3 kPa at 0, and loss of 7.18 kPa per km
+		double temperature = 300 - 10 * ( y / 1000.0 ); // assuming 300 at 0 and 10 less per kilometer
+		double density = 1.0 - 0.08 * ( y / 1000.0 );
+		double wind = windX( y );
+		
+		for( int i = r.left(); i <= r.right(); i++ )
+		{
+			double x = _originX + i * GRID_STEP;
+			
+			double deltaT = 0;
+			double updraft = 0;
+			foreach( const WeatherCell& cell, _cells )
+			{
+				double dx = x - cell.rasterPosition.x();
+				double dy = y - cell.rasterPosition.y();
+				double d2 = ( dx*dx + dy*dy ) / ( cell.radius * cell.radius );
+				if ( d2 < 1.0 )
+				{
+					double w = ( 1.0 - d2 ) * ( 1.0 - d2 );
+					deltaT += cell.temperature * w;
+					updraft += cell.updraft * w;
+				}
+			}
+			
+			int index = j * _columns + i;
+			_pressure[ index ] = pressure;
+			_temperature[ index ] = temperature + deltaT;
+			_density[ index ] = density * temperature / ( temperature + deltaT ); // warm air is lighter
+			_windX[ index ] = wind;
+			_windY[ index ] = updraft;
+		}
+	}
+}
+
+// ============================================================================
+/// Returns grid nodes affected by circle.
+QRect Environment::footprint( const QPointF& position, double radius ) const
+{
+	int left	= int( floor( ( position.x() - radius - _originX ) / GRID_STEP ) );
+	int right	= int( ceil( ( position.x() + radius - _originX ) / GRID_STEP ) );
+	int top		= int( floor( ( position.y() - radius - _originY ) / GRID_STEP ) );
+	int bottom	= int( ceil( ( position.y() + radius - _originY ) / GRID_STEP ) );
+	
+	return QRect( QPoint( left, top ), QPoint( right, bottom ) );
+}
+
+// ============================================================================
+/// Prevailing wind at altitude. Grows linearly from 0 at sea level [m/s].
+double Environment::windX( double altitude ) const
+{
+	return _wind * qMax( 0.0, altitude ) / WIND_ALTITUDE;
+}
+
+// ============================================================================
+/// Finds grid cell. Horizontally point is clamped to the grid, vertically it is
+/// extrapolated, so atmosphere above and below the world continues linearly.
+void Environment::locate( double x, double y, int* pIndex, double* pTx, double* pTy ) const
+{
+	Q_ASSERT( _columns > 1 && _rows > 1 );
+	
+	double fx = ( x - _originX ) / GRID_STEP;
+	double fy = ( y - _originY ) / GRID_STEP;
+	int i = qBound( 0, int( floor( fx ) ), _columns - 2 );
+	int j = qBound( 0, int( floor( fy ) ), _rows - 2 );
+	
+	*pIndex = j * _columns + i;
+	*pTx = qBound( 0.0, fx - i, 1.0 );
+	*pTy = fy - j;
+}
+
+// ============================================================================
+/// Bilinear interpolation of field in grid cell.
+double Environment::interpolate( const QVector<double>& field, int index, double tx, double ty ) const
+{
+	const double* p = field.constData() + index;
+	double bottom	= p[0] + ( p[1] - p[0] ) * tx;
+	double top		= p[_columns] + ( p[_columns + 1] - p[_columns] ) * tx;
+	
+	return bottom + ( top - bottom ) * ty;
+}
+
 // ============================================================================
 /// Returns athmospheric pressure in Pa at secified location.
 double Environment::pressure( const QPointF& location ) const
 {
-	return 101.3E3 - 7.18E3 * ( location.y() / 1000.0 ); // assumin 101.3 kPa at 0, and loss of 7.18 kPa per km
+	int index;
+	double tx, ty;
+	locate( location.x(), location.y(), &index, &tx, &ty );
+	
+	return interpolate( _pressure, index, tx, ty );
 }
 
 // ============================================================================
 /// Returns relative density. 1.0 at sea level, decreasing with height. Used to calculating drag, lift and thrust.
 double Environment::relativeDensity( const QPointF& location ) const
 {
-	return 1.0 - 0.08 * ( location.y() / 1000.0 );
+	int index;
+	double tx, ty;
+	locate( location.x(), location.y(), &index, &tx, &ty );
+	
+	return interpolate( _density, index, tx, ty );
 }
 
 // ============================================================================
 /// Returns temperature in K at specified world point.
 double Environment::temperature( const QPointF& location ) const
 {
-	return 300 - 10 * ( location.y() / 1000.0 ); // assuming 300 at 0 and 10 less per kilometer
+	int index;
+	double tx, ty;
+	locate( location.x(), location.y(), &index, &tx, &ty );
+	
+	return interpolate( _temperature, index, tx, ty );
 }
 
+// ============================================================================
+/// Returns wind velocity at specified world point [m/s].
+QPointF Environment::wind( const QPointF& location ) const
+{
+	int index;
+	double tx, ty;
+	locate( location.x(), location.y(), &index, &tx, &ty );
+	
+	return QPointF( interpolate( _windX, index, tx, ty ), interpolate( _windY, index, tx, ty ) );
 }
 
-// EOF
+// ============================================================================
+/// Samples relative density at many points at once.
+void Environment::sampleDensity( int count, const double* x, const double* y, double* density ) const
+{
+	for( int i = 0; i < count; i++ )
+	{
+		int index;
+		double tx, ty;
+		locate( x[i], y[i], &index, &tx, &ty );
+		
+		density[i] = interpolate( _density, index, tx, ty );
+	}
+}
+
+// ============================================================================
+/// Samples wind at many points at once.
+void Environment::sampleWind( int count, const double* x, const double* y, double* windX, double* windY ) const
+{
+	for( int i = 0; i < count; i++ )
+	{
+		int index;
+		double tx, ty;
+		locate( x[i], y[i], &index, &tx, &ty );
+		
+		windX[i] = interpolate( _windX, index, tx, ty );
+		windY[i] = interpolate( _windY, index, tx, ty );
+	}
+}
+
+// ============================================================================
+/// Sets prevailing wind at 1000 m. Whole grid is recalculated.
+void Environment::setWind( double wind )
+{
+	_wind = wind;
+	rebuild( QRect( 0, 0, _columns, _rows ) );
+}
+
+// ============================================================================
+/// Adds weather cell - column of warm, rising air.
+void Environment::addCell( const QPointF& position, double radius, double temperature, double updraft )
+{
+	Q_ASSERT( radius > 0 );
+	
+	WeatherCell cell;
+	cell.position = position;
+	cell.rasterPosition = position;
+	cell.radius = radius;
+	cell.temperature = temperature;
+	cell.updraft = updraft;
+	_cells.append( cell );
+	
+	rebuild( footprint( position, radius ) );
+}
+
+// ============================================================================
+/// Removes all weather cells.
+void Environment::clearCells()
+{
+	_cells.clear();
+	rebuild( QRect( 0, 0, _columns, _rows ) );
+}
+
+// ============================================================================
+/// Writes weather to snapshot stream. Grid is not stored, it's rebuilt on restore.
+void Environment::saveState( QDataStream& stream ) const
+{
+	stream << _wind << _cells.size();
+	foreach( const WeatherCell& cell, _cells )
+	{
+		stream << cell.position << cell.radius << cell.temperature << cell.updraft << cell.rasterPosition;
+	}
+}
+
+// ============================================================================
+/// Restores weather from snapshot stream.
+void Environment::restoreState( QDataStream& stream )
+{
+	int count = 0;
+	stream >> _wind >> count;
+	
+	_cells.clear();
+	for( int i = 0; i < count; i++ )
+	{
+		WeatherCell cell;
+		stream >> cell.position >> cell.radius >> cell.temperature >> cell.updraft >> cell.rasterPosition;
+		_cells.append( cell );
+	}
+	
+	rebuild( QRect( 0, 0, _columns, _rows ) );
+}
+
+}
 
+// EOF
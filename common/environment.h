@@ -18,23 +18,97 @@
 #define FLYERENVIRONMENT_H
 
 #include <QPointF>
+#include <QRectF>
+#include <QRect>
+#include <QList>
+#include <QVector>
+
+class QDataStream;
 
 namespace Flyer
 {
 
 /**
-	This class provides environment data - pressure, air density, temperature etc.
+	This class provides environment data - pressure, air density, temperature and wind.
+	Data is kept in regular grid covering the world, and sampled with bilinear interpolation,
+	so sampling costs the same, no matter how rich the weather is.
+	Grid holds standard atmosphere, prevailing wind growing with altitude, and weather cells -
+	warm, rising columns of air, which drift with the wind. Only grid nodes under moving
+	cells are recalculated.
 	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
 class Environment
 {
 public:
+	
+	/// Weather cell - thermal
+	struct WeatherCell
+	{
+		QPointF	position;		///< Center [m]
+		double	radius;			///< Radius [m]
+		double	temperature;	///< Temperature difference at center [K]
+		double	updraft;		///< Vertical wind at center [m/s]
+		QPointF	rasterPosition;	///< Position at which cell is stored in grid [m]
+	};
+	
 	Environment();
 	virtual ~Environment();
 	
+	void setBoundary( const QRectF& boundary );	///< Creates grid covering boundary
+	void simulate( double dt );					///< Moves weather cells with the wind
+	
 	double pressure( const QPointF& location ) const;				///< Pressure [Pa]
 	double relativeDensity( const QPointF& location ) const;		///< Desnity [relative units, 1->0]
 	double temperature( const QPointF& location ) const;			///< Temperature [k]
+	QPointF wind( const QPointF& location ) const;					///< Wind velocity [m/s]
+	
+	/// Samples relative density at \b count points
+	void sampleDensity( int count, const double* x, const double* y, double* density ) const;
+	/// Samples wind at \b count points
+	void sampleWind( int count, const double* x, const double* y, double* windX, double* windY ) const;
+	
+	// weather
+	
+	/// Sets prevailing wind at 1000 m [m/s]. Wind grows linearly from 0 at sea level.
+	void setWind( double wind );
+	double prevailingWind() const { return _wind; }
+	
+	void addCell( const QPointF& position, double radius, double temperature, double updraft );
+	void clearCells();
+	const QList<WeatherCell>& cells() const { return _cells; }
+	
+	// snapshots
+	
+	void saveState( QDataStream& stream ) const;
+	void restoreState( QDataStream& stream );
+
+private:
+	
+	void rebuild( const QRect& nodes );					///< Recalculates grid nodes
+	QRect footprint( const QPointF& position, double radius ) const;	///< Grid nodes covered by circle
+	double windX( double altitude ) const;				///< Prevailing wind at altitude
+	
+	/// Finds grid cell containing point. Returns index of cell's bottom-left node and position inside the cell.
+	void locate( double x, double y, int* pIndex, double* pTx, double* pTy ) const;
+	/// Interpolates field in grid cell
+	double interpolate( const QVector<double>& field, int index, double tx, double ty ) const;
+	
+	QRectF	_boundary;		///< World boundary
+	
+	// grid
+	double	_originX;		///< Position of first node [m]
+	double	_originY;
+	int		_columns;		///< Nodes in row
+	int		_rows;			///< Rows of nodes
+	QVector<double>	_pressure;		///< Pressure [Pa], row by row
+	QVector<double>	_density;		///< Relative density, row by row
+	QVector<double>	_temperature;	///< Temperature [K], row by row
+	QVector<double>	_windX;			///< Wind [m/s], row by row
+	QVector<double>	_windY;
+	
+	// weather
+	double				_wind;		///< Prevailing wind at 1000 m [m/s]
+	QList<WeatherCell>	_cells;		///< Weather cells
 };
 
 }
@@ -42,5 +116,3 @@ public:
 #endif // FLYERENVIRONMENT_H
 
 // EOF
-
-
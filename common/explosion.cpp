@@ -17,6 +17,8 @@
 #include <math.h>
 
 #include <QPainter>
+#include <QDataStream>
+#include <QtAlgorithms>
 
 #include "Box2D.h"
 
@@ -25,6 +27,10 @@
 #include "body.h"
 #include "damagemanager.h"
 #include "common.h"
+#include "particlesystem.h"
+#include "simulationscheduler.h"
+#include "physicalobject.h"
+#include "worldsnapshot.h"
 
 #include "explosion.h"
 
@@ -33,6 +39,7 @@ namespace Flyer
 
 static const double DAMAGE_MULTIPLIER	= 10; ///< Explosion damage multiplier
 static const double MIN_FORCE	=	2E3;		///< Minimal reasonable to force
+static const int HIT_BODIES_RESERVE = 64;		///< Initial capacity of hit bodies set
 
 // ============================================================================
 // Constructor
@@ -44,6 +51,10 @@ Explosion::Explosion ( World* pWorld ) : WorldObject ( pWorld )
 	_maxRadius = 0;
 	
 	_speed = 85; // 1/4 the speed of sound
+	
+	// world can't have more shapes than proxies, so query is never truncated
+	_shapes.resize( b2_maxProxies );
+	_hitBodies.reserve( HIT_BODIES_RESERVE );
 }
 
 // ============================================================================
@@ -76,29 +87,6 @@ void Explosion::setEnergy( double e )
 	_energy = e;
 }
 
-// ============================================================================
-// Renders
-void Explosion::render ( QPainter& painter, const QRectF&, const RenderingOptions&  )
-{
-	// render fire
-	double fireRadius = qMin( _radius*0.9, _maxFireRadius );
-	QRectF fire( _center.x - fireRadius, _center.y - fireRadius, fireRadius*2, fireRadius*2 );
-	QRectF shockwave( _center.x - _radius, _center.y - _radius, _radius*2, _radius*2 );
-	
-	painter.setPen( Qt::NoPen );
-	painter.setBrush( QColor( 128, 0, 0, 200 ) );
-	
-	painter.drawEllipse( fire );
-	
-	// render shockwave
-	painter.setPen( QPen( QColor( 0,0,0,32 ), 1 ) );
-	painter.setBrush( Qt::NoBrush );
-	
-	painter.drawEllipse( shockwave );
-	
-
-}
-
 // ============================================================================
 // Simulates
 void Explosion::simulate ( double dt )
@@ -118,61 +106,177 @@ void Explosion::simulate ( double dt )
 }
 
 // ============================================================================
-/// Acts with a force on body
+/// Acts with force on bodies reached by shockwave in current step. Shockwave is a ring
+/// between current radius and radius in next step; body is hit when ring reaches the closest
+/// point of any of its shapes. Each body is hit only once during explosion's life.
 void Explosion::actWithForce()
 {
 	// find range of force in current step
-	double minRange = _radius; // current radius
 	double maxRange = qMin( _radius + _speed * world()->timestep(), _maxRadius );
 	
 	if ( maxRange < 0.01 ) return; // do nothing for small damage
 	
-	// find bodies within range
+	// find shapes within range
 	b2AABB aabb;
 	aabb.lowerBound.Set( _center.x-maxRange, _center.y-maxRange );
 	aabb.upperBound.Set( _center.x+maxRange, _center.y+maxRange );
 	
-	const int bufsize = 100; // firs 100 lucky ibjects. rest will go untouched. Maybe use some heuristiv value basing on radius?
-	b2Shape* shapes[ bufsize ];
-	int count = world()->b2world()->Query(aabb, shapes, bufsize);
-	
-	// ok, now i have 'count' shapes. Acti with force on bodies and damage managers
-	
-	QList<b2Body*> bodiesTouched; // to not repeat
+	int count = world()->b2world()->Query( aabb, _shapes.data(), _shapes.size() );
 	
 	for( int i = 0; i < count; i++ )
 	{
-		// get body
-		b2Body* pb2Body = shapes[i]->GetBody();
+		b2Shape* pShape = _shapes[i];
+		
+		// closest point reached by the ring? Bodies inside the ring were hit in previous steps,
+		// or entered it later - hit them now.
+		double shapeDistance = distance( pShape, _center );
+		if ( shapeDistance >= maxRange )
+		{
+			continue;
+		}
+		
+		// b2Body address can be reused by fragments created while shockwave is alive, body id can't.
+		// All b2 bodies are created by Body.
+		b2Body* pb2Body = pShape->GetBody();
+		Body* pBody = static_cast<Body*>( pb2Body->GetUserData() );
+		if ( ! pBody || ! markHit( pBody->id() ) )
+		{
+			continue;
+		}
+		
+		double force = qMin( _energy, _energy / ( shapeDistance*shapeDistance+1) );
+		
+		// radial impulse, equal to force acting during one step
+		b2Vec2 normal = pb2Body->GetWorldCenter() - _center;
+		normal.Normalize();
+		pb2Body->ApplyImpulse( float32( force * world()->timestep() ) * normal, pb2Body->GetWorldCenter() );
+		world()->scheduler()->release( pBody ); // keep the push if body is held
 		
-		// find distance, normal vector and force value
-		double distance = ( pb2Body->GetPosition() - _center ).Length();
+		// damge DM
+		pBody->contact( force * DAMAGE_MULTIPLIER );
+		//qDebug("Explosion: contact with body %s, force: %g", qPrintable(pBody->name()),force * DAMAGE_MULTIPLIER ); 
+	}
+}
+
+// ============================================================================
+/// Adds body id to set of bodies hit by the explosion. Returns false if body was already there.
+bool Explosion::markHit( int bodyId )
+{
+	QVector<int>::iterator it = qLowerBound( _hitBodies.begin(), _hitBodies.end(), bodyId );
+	if ( it != _hitBodies.end() && *it == bodyId )
+	{
+		return false;
+	}
+	
+	_hitBodies.insert( it, bodyId );
+	return true;
+}
 
-		if ( distance < maxRange &&  distance >= minRange )
+// ============================================================================
+/// Writes center and energy. Fire and shockwave emitters are stored separately.
+void Explosion::saveParams( QDataStream& stream ) const
+{
+	stream << double( _center.x ) << double( _center.y ) << _energy;
+}
+
+// ============================================================================
+/// Writes current radius and bodies already hit. Body is identified by id of its object
+/// in snapshot and its index in object's bodies; bodies of objects not stored in snapshot are skipped.
+void Explosion::saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const
+{
+	QList< QPair<int, int> > hitBodies;
+	for( int id = 0; id < snapshot.objectCount(); id++ )
+	{
+		PhysicalObject* pPhysical = dynamic_cast<PhysicalObject*>( snapshot.object( id ) );
+		if ( ! pPhysical )
 		{
-			b2Vec2 diff = pb2Body->GetPosition() - _center;
-			b2Vec2 normal = diff;
-			normal.Normalize();
-			
-			double force = qMin( _energy, _energy / ( distance*distance+1) );
+			continue;
+		}
 		
-			// act with force on body (but only once)
-			if ( ! bodiesTouched.contains( pb2Body ) )
+		const QList<Body*>& bodies = pPhysical->bodies();
+		for( int i = 0; i < bodies.size(); i++ )
+		{
+			if ( qBinaryFind( _hitBodies.begin(), _hitBodies.end(), bodies[i]->id() ) != _hitBodies.end() )
 			{
-				pb2Body->ApplyForce( force*normal, pb2Body->GetPosition() );
-				bodiesTouched.append( pb2Body );
+				hitBodies.append( qMakePair( id, i ) );
 			}
-			
-			// damge DM
-			Body* pBody = static_cast<Body*>( pb2Body->GetUserData() );
-			if ( pBody )
+		}
+	}
+	
+	stream << _radius << _currentStep << hitBodies;
+}
+
+// ============================================================================
+/// Restores radius and bodies hit, mapping them to ids of re-created bodies.
+void Explosion::restoreState( QDataStream& stream, const WorldSnapshot& snapshot )
+{
+	QList< QPair<int, int> > hitBodies;
+	stream >> _radius >> _currentStep >> hitBodies;
+	
+	_hitBodies.resize( 0 );
+	for( int i = 0; i < hitBodies.size(); i++ )
+	{
+		PhysicalObject* pPhysical = dynamic_cast<PhysicalObject*>( snapshot.object( hitBodies[i].first ) );
+		int index = hitBodies[i].second;
+		if ( pPhysical && index < pPhysical->bodies().size() )
+		{
+			_hitBodies.append( pPhysical->bodies()[ index ]->id() );
+		}
+	}
+	qSort( _hitBodies );
+}
+
+// ============================================================================
+/// Calculates distance from point to shape's closest point. Returns 0 if point is inside the shape.
+double Explosion::distance( const b2Shape* pShape, const b2Vec2& point )
+{
+	const b2XForm& xf = pShape->GetBody()->GetXForm();
+	
+	if ( pShape->GetType() == e_circleShape )
+	{
+		const b2CircleShape* pCircle = static_cast<const b2CircleShape*>( pShape );
+		b2Vec2 center = b2Mul( xf, pCircle->GetLocalPosition() );
+		return qMax( 0.0, double( ( center - point ).Length() - pCircle->GetRadius() ) );
+	}
+	
+	if ( pShape->GetType() == e_polygonShape )
+	{
+		const b2PolygonShape* pPolygon = static_cast<const b2PolygonShape*>( pShape );
+		const b2Vec2* pVertices = pPolygon->GetVertices();
+		const b2Vec2* pNormals = pPolygon->GetNormals();
+		int vertices = pPolygon->GetVertexCount();
+		
+		b2Vec2 local = b2MulT( xf, point );
+		
+		// inside, if behind all edges
+		bool inside = true;
+		for( int i = 0; i < vertices && inside; i++ )
+		{
+			inside = b2Dot( pNormals[i], local - pVertices[i] ) <= 0.0f;
+		}
+		if ( inside )
+		{
+			return 0.0;
+		}
+		
+		// closest edge
+		double minDistance = -1;
+		for( int i = 0; i < vertices; i++ )
+		{
+			const b2Vec2& a = pVertices[i];
+			b2Vec2 edge = pVertices[ ( i + 1 ) % vertices ] - a;
+			float32 t = b2Clamp( b2Dot( local - a, edge ) / b2Dot( edge, edge ), 0.0f, 1.0f );
+			double d = ( local - ( a + t * edge ) ).Length();
+			if ( minDistance < 0 || d < minDistance )
 			{
-				pBody->contact( force * DAMAGE_MULTIPLIER );
-				//qDebug("Explosion: contact with body %s, force: %g", qPrintable(pBody->name()),force * DAMAGE_MULTIPLIER ); 
+				minDistance = d;
 			}
-			
 		}
+		return minDistance;
 	}
+	
+	// unknown shape - use body position
+	return ( pShape->GetBody()->GetPosition() - point ).Length();
 }
 
 // ============================================================================
@@ -182,11 +286,33 @@ void Explosion::explode( World* pWorld, const b2Vec2& center, double energy )
 	Explosion* pExplosion = new Explosion( pWorld );
 	pExplosion->setEnergy( energy );
 	pExplosion->setCenter( center );
-	pExplosion->setRenderLayer( LayerForeground );
 
 	//add explosion to the world
 	pWorld->addObject( pExplosion, World::ObjectSimulated );
-	pWorld->addDecoration( pExplosion );
+	
+	// fire and shockwave are drawn by emitters, released right away, so they disappear with their particles
+	double lifespan = pExplosion->_maxRadius / pExplosion->_speed;
+	
+	ParticleSystem* pFire = new ParticleSystem( pWorld );
+	pFire->setColor( QColor( 128, 0, 0, 200 ) );
+	pFire->setExpansion( pExplosion->_speed * 0.9 );
+	pFire->setMaxRadius( pExplosion->_maxFireRadius );
+	pFire->setFadeOut( false );
+	pFire->setName( "Explosion fire" );
+	pWorld->addObject( pFire, World::ObjectSimulated );
+	pFire->addParticle( center, b2Vec2( 0, 0 ), 0.0, lifespan );
+	pFire->release();
+	
+	ParticleSystem* pShockwave = new ParticleSystem( pWorld );
+	pShockwave->setSprite( ParticleSystem::SpriteRing );
+	pShockwave->setColor( QColor( 0, 0, 0, 32 ) );
+	pShockwave->setExpansion( pExplosion->_speed );
+	pShockwave->setMaxRadius( pExplosion->_maxRadius );
+	pShockwave->setFadeOut( false );
+	pShockwave->setName( "Explosion shockwave" );
+	pWorld->addObject( pShockwave, World::ObjectSimulated );
+	pShockwave->addParticle( center, b2Vec2( 0, 0 ), 0.0, lifespan );
+	pShockwave->release();
 	
 	//qDebug("BOOOOM!!!");
 }
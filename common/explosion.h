@@ -43,13 +43,20 @@ public:
 	virtual ~Explosion();
 
 	virtual QRectF boundingRect() const;
-	virtual void render ( QPainter& painter, const QRectF& rect, const RenderingOptions& options );
 	virtual void simulate ( double dt );
 	
 	// properties
 	void setCenter( const b2Vec2& c ) { _center = c; }
 	void setEnergy( double e );
 	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Explosion"; }
+	virtual bool transient() const { return true; }
+	virtual void saveParams( QDataStream& stream ) const;
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
+	
 	// utilities
 	
 	/// Creates explosion
@@ -58,6 +65,8 @@ public:
 private:
 
 	void actWithForce();	///< Pushes bodies, activates damage managers for current step
+	bool markHit( int bodyId );		///< Marks body as hit, returns false if it was hit already
+	static double distance( const b2Shape* pShape, const b2Vec2& point );	///< Distance from point to shape
 
 	// config
 	double _speed;			///< Speed of expansions [m/s], defaults to speed of sound
@@ -69,6 +78,9 @@ private:
 	// variables
 	double	_radius;		///< Current radius
 	int		_currentStep;	///< Current simulation step
+	
+	QVector<b2Shape*>	_shapes;		///< Broadphase query buffer, large enough for all proxies
+	QVector<int>		_hitBodies;		///< Ids of bodies already hit by the shockwave, sorted
 
 };
 
@@ -14,6 +14,11 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <math.h>
+
+#include <QDataStream>
+#include <QVarLengthArray>
+
 #include "Box2D.h"
 
 #include "renderingoptions.h"
@@ -21,18 +26,30 @@
 #include "textureprovider.h"
 #include "grounddecoration.h"
 #include "common.h"
+#include "terraingenerator.h"
 
 #include "ground.h"
 
 namespace Flyer
 {
 
+static const double TEXTURE_LENGTH = 50;	///< Ground texture length [m]
+static const double BODY_LENGTH = 1000;		///< Length of terrain covered by single static body [m]
+static const int MAX_PIECE_SEGMENTS = b2_maxPolygonVertices - 3;	///< Segments merged into single polygon, 2 vertices are at bottom
+static const double MIN_PIECE_TURN = 3.0 * M_PI / 180.0;	///< Minimal surface bend at merged vertex, above Box2D's angular slop [rad]
+static const double HEIGHT_GRID_CELL = 25;	///< Cell of height lookup grid [m], smaller than shortest segment
+static const double LOD_MIN_TOLERANCE = 0.25;	///< Simplification tolerance of first LOD level [m], doubled at each level
+static const int LOD_MAX_LEVELS = 16;		///< Max number of LOD levels, including full heightmap
+static const int LOD_BLOCK = 32;			///< Number of LOD points covered by single bounding rect
+static const double LOD_MAX_ERROR = 1.0;	///< Max rendered LOD error [px]
+
 // ============================================================================
 // Constructor
 Ground::Ground ( World* pWorld ) : PhysicalObject ( pWorld )
 {
 	setName( "Ground" );
 	setRenderLayer( LayerForeground );
+	_chunked = false;
 }
 
 // ============================================================================
@@ -45,17 +62,47 @@ Ground::~Ground()
 /// Gemnerates random terrain using provided description
 void Ground::random( QList<Section> seed )
 {
-	_heightmap = generate( seed );
+	setHeightmap( generate( seed ) );
+	createBody();
+	prepareTextures();
+}
+
+// ============================================================================
+/// Creates ground bodies from heightmap. Terrain is split into static bodies, each covering
+/// BODY_LENGTH of terrain. Creates physical bodies, so should be called
+/// on the thread which simulates the world.
+void Ground::createBody()
+{
 	setLayers( 0xffff ); //all!
 	
+	for( double from = _heightmap.first().x(); from < _heightmap.last().x(); from += BODY_LENGTH )
+	{
+		Body* pBody = createGroundBody( from, from + BODY_LENGTH );
+		if ( pBody )
+		{
+			_groundBodies.append( pBody );
+		}
+	}
+}
+
+// ============================================================================
+/// Creates body from heightmap segments which start in x-range [from, to).
+/// Returns NULL if there is no such segment.
+Body* Ground::createGroundBody( double from, double to )
+{
+	QList<b2PolygonDef*> shapes = createShape( from, to );
+	if ( shapes.isEmpty() )
+	{
+		return NULL;
+	}
+	
 	// create ground
 	b2BodyDef groundBodyDef;
 	groundBodyDef.position.SetZero();
 	
-	_pGround = new Body("Ground");
-	_pGround->create( groundBodyDef, world() );
+	Body* pBody = new Body("Ground");
+	pBody->create( groundBodyDef, world() );
 	
-	QList<b2PolygonDef*> shapes = createShape();
 	foreach( b2PolygonDef* pShape, shapes )
 	{
 		/*
@@ -65,15 +112,13 @@ void Ground::random( QList<Section> seed )
 			, pShape->vertices[2].x, pShape->vertices[2].y
 			);
 		*/
-		_pGround->addShape( pShape );
+		pBody->addShape( pShape );
 		delete pShape;
 	}
 	
-	addBody( _pGround, BodyRendered1 );
-	setMainBody( _pGround );
-	
-	prepareTextures();
+	addBody( pBody, BodyRendered1 );
 	
+	return pBody;
 }
 
 // ================================= set heightmap =====================
@@ -81,26 +126,102 @@ void Ground::random( QList<Section> seed )
 void Ground::setHeightmap( const QPolygonF& heightMap )
 {
 	_heightmap = heightMap;
+	buildHeightIndex();
+	
+	// LODs are not created lazily, because rendering may run on multiple threads
+	buildLods();
 }
 
 // ================================== height ========================
-/// Calculates y for specified x.
+/// Calculates y for specified x. Returns 0 outside heightmap.
 double Ground::height( double x ) const
 {
-	// find line containing this coordinate
-	for( int i = 0; i < _heightmap.size() - 1; i++ )
+	int i = segment( x );
+	if ( i < 0 )
 	{
-		if ( _heightmap[i].x() <= x && _heightmap[i+1].x() >= x )
+		return 0;
+	}
+	
+	return _heightmap[i].y() + _slopes[i] * ( x - _heightmap[i].x() );
+}
+
+// ============================================================================
+/// Calculates heights for \b count x-coordinates from \b pX, stores them in \b pY.
+/// Segments are found first, then heights are interpolated in single tight loop.
+void Ground::heights( const double* pX, double* pY, int count ) const
+{
+	QVarLengthArray<int, 256> segments( count );
+	for( int k = 0; k < count; k++ )
+	{
+		segments[k] = segment( pX[k] );
+	}
+	
+	const QPointF* pPoints = _heightmap.constData();
+	const double* pSlopes = _slopes.constData();
+	for( int k = 0; k < count; k++ )
+	{
+		int i = segments[k];
+		pY[k] = i < 0 ? 0.0 : pPoints[i].y() + pSlopes[i] * ( pX[k] - pPoints[i].x() );
+	}
+}
+
+// ============================================================================
+/// Returns index of first heightmap segment containing x, or -1 if x is outside heightmap.
+/// Uses uniform grid, each cell points to first segment overlapping it. Cells are
+/// shorter than segments, so only a step or two is needed from there.
+int Ground::segment( double x ) const
+{
+	if ( _heightGrid.isEmpty() || x < _heightmap.first().x() || x > _heightmap.last().x() )
+	{
+		return -1;
+	}
+	
+	int cell = qBound( 0, int( ( x - _heightmap.first().x() ) / HEIGHT_GRID_CELL ), _heightGrid.size() - 1 );
+	int i = _heightGrid[ cell ];
+	int last = _heightmap.size() - 2;
+	while( i < last && _heightmap[i+1].x() < x )
+	{
+		i++;
+	}
+	
+	return i;
+}
+
+// ============================================================================
+/// Builds height lookup structures: segment slopes and grid. Heightmap x-coordinates
+/// are expected to be in ascending order.
+void Ground::buildHeightIndex()
+{
+	_slopes.clear();
+	_heightGrid.clear();
+	
+	int segments = _heightmap.size() - 1;
+	if ( segments < 1 )
+	{
+		return;
+	}
+	
+	_slopes.resize( segments );
+	for( int i = 0; i < segments; i++ )
+	{
+		double dx = _heightmap[i+1].x() - _heightmap[i].x();
+		_slopes[i] = dx > 0 ? ( _heightmap[i+1].y() - _heightmap[i].y() ) / dx : 0.0;
+	}
+	
+	double origin = _heightmap.first().x();
+	int cells = int( ( _heightmap.last().x() - origin ) / HEIGHT_GRID_CELL ) + 1;
+	_heightGrid.resize( cells );
+	
+	int i = 0;
+	for( int c = 0; c < cells; c++ )
+	{
+		double cellStart = origin + c * HEIGHT_GRID_CELL;
+		while( i < segments - 1 && _heightmap[i+1].x() < cellStart )
 		{
-			double x1 = _heightmap[i].x();
-			double y1 = _heightmap[i].y();
-			double x2 = _heightmap[i+1].x();
-			double y2 = _heightmap[i+1].y();
-			
-			return y1 + ( y2 - y1 ) * ( x - x1) / ( x2 - x1 );
+			i++;
 		}
+		_heightGrid[c] = i;
 	}
-	return 0;
 }
 
 // ============================================================================
@@ -191,217 +312,116 @@ void Ground::random()
 }
 
 // ============================================================================
-// Recursively generates random terrain using provided seed
+/// Generates random terrain using provided seed, see TerrainGenerator.
+/// Doesn't modify the ground, uses only qrand(), so may be called on worker thread.
 QPolygonF Ground::generate( QList<Section> seed )
 {
+	TerrainGenerator generator( seed, qrand() );
+	QPolygonF result = generator.generate();
 	
-	QPolygonF result;
- 	// prepare seed
-	int seedSize = seed.size();
-	for( int i =0; i< seedSize; i++ )
+	foreach( const QPointF& point, result )
 	{
-		Section& section = seed[i];
-		// common
-		section.canBeDividedLeft = false; // we divining only to the right
-		
-		if ( section.canBeDividedRight && i < seedSize-1 )
-		{
-			section.nextX = seed[i+1].x;
-			section.nextY = seed[i+1].y;
-			
-			divideRight( section );
-		}
-			
-		traverseSection( section, result );
-		
+		Q_ASSERT( world()->boundary().contains( point ) );
 	}
 	
 	return result;
 }
 
-// ============================================================================
-// Traverses section in-order and appends result to polygon
-void Ground::traverseSection( Section& section, QPolygonF& points )
+// =========================== create shape ============================
+/// Creates shapes for heightmap segments starting in x-range [from, to).
+/// Consecutive segments are merged into single convex polygon as long as
+/// the surface bends down (hill tops) and polygon vertex limit allows.
+/// Each polygon spans from surface to 100m below its lowest point.
+QList<b2PolygonDef*> Ground::createShape( double from, double to )
 {
-	if ( section.pLeft )
+	QList<b2PolygonDef*> list;
+	
+	// find points of segments in range
+	int first = -1;
+	int last = -1;
+	for( int i = 0; i < _heightmap.size() - 1; i++ )
 	{
-		traverseSection( * section.pLeft, points );
+		double x = _heightmap[i].x();
+		if ( x >= from && x < to )
+		{
+			if ( first < 0 ) first = i;
+			last = i + 1;
+		}
 	}
-	points.append( QPointF( section.x, section.y ) );
-	if ( section.pRight )
+	if ( first < 0 )
 	{
-		traverseSection( * section.pRight, points );
+		return list;
 	}
 	
-}
-
-// ============================================================================
-// Divides scetion to the right
-void Ground::divideRight( Section& section )
-{
-	double width = section.nextX - section.x;
-	
-	if ( width < section.minSectionSize * 2 )
+	// merge segments into pieces
+	int start = first;
+	for( int i = first + 1; i <= last; i++ )
 	{
-		return; // STOP
+		bool extend = i < last
+			&& ( i + 1 - start ) <= MAX_PIECE_SEGMENTS
+			&& isConvexVertex( _heightmap[i-1], _heightmap[i], _heightmap[i+1] );
+		
+		if ( ! extend )
+		{
+			list.append( createPieceB2Shape( start, i ) );
+			start = i;
+		}
 	}
 	
-	// ok, find x of new point
-	double newX = rand( section.x +  section.minSectionSize, section.nextX - section.minSectionSize );
-	
-	double widthLeft = newX - section.x;
-	double widthRight = section.nextX - newX;
-	
-	// now find y
-	double maxY = qMin( section.y + widthLeft * section.maxSlope,
-		section.nextY + widthRight * section.maxSlope );
-	double minY = qMax( section.y - widthLeft * section.maxSlope,
-		section.nextY - widthRight * section.maxSlope );
-	
-	
-	double newY = rand( qMax( section.minHeight, minY), qMin( section.maxHeight, maxY ) );
-	
-	//qDebug("divide right between %.0f,%0.f and %.0f,%.0f: new point: %.0f,%.0f",
-	//	section.x, section.y, section.nextX, section.nextY, newX, newY );
-	
-	Section* newSection = new Section;
-	
-	newSection->minSectionSize = section.minSectionSize;
-	newSection->maxSectionSize = section.maxSectionSize;
-	newSection->maxSlope = section.maxSlope;
-	newSection->maxHeight = section.maxHeight;
-	newSection->minHeight = section.minHeight;
-	
-	newSection->x = newX;
-	newSection->y = newY;
-	
-	Q_ASSERT( world()->boundary().contains( newX, newY ) );
-	 
-	newSection->prevX = section.x;
-	newSection->prevY = section.y;
-	newSection->nextX = section.nextX;
-	newSection->nextY = section.nextY;
-	
-	section.pRight = newSection;
-	
-	divideRight( *newSection );
-	divideLeft( *newSection );
+	return list;
 }
 
 // ============================================================================
-// Divides scetion to the left
-void Ground::divideLeft( Section& section )
+/// Checks if surface turns down (clockwise) at point \b b, by more than Box2D's
+/// angular tolerance. Polygon built from such points is convex.
+bool Ground::isConvexVertex( const QPointF& a, const QPointF& b, const QPointF& c )
 {
-	double width = section.x - section.prevX;
-	
-	if ( width < section.minSectionSize * 2 )
-	{
-		return; // STOP
-	}
-	
-	// ok, find x of new point
-	double newX = rand( section.prevX +  section.minSectionSize, section.x - section.minSectionSize );
-	double widthLeft = newX - section.prevX;
-	double widthRight = section.x - newX;
-	// now find y
-	double maxY = qMin( section.y + widthRight * section.maxSlope,
-		section.prevY + widthLeft * section.maxSlope );
-	double minY = qMax( section.y - widthRight * section.maxSlope,
-		section.prevY - widthLeft * section.maxSlope );
-	
-	double newY = rand( qMax( section.minHeight, minY), qMin( section.maxHeight, maxY ) );
-	
-	//qDebug("divide left between %.0f,%0.f and %.0f,%.0f: new point: %.0f,%.0f",
-	//	section.prevX, section.prevY, section.x, section.y, newX, newY );
-	
-	Section* newSection = new Section;
-	
-	newSection->minSectionSize = section.minSectionSize;
-	newSection->maxSectionSize = section.maxSectionSize;
-	newSection->maxSlope = section.maxSlope;
-	newSection->maxHeight = section.maxHeight;
-	newSection->minHeight = section.minHeight;
-	
-	newSection->x = newX;
-	newSection->y = newY;
-	
-	Q_ASSERT( world()->boundary().contains( newX, newY ) );
-	
-	newSection->prevX = section.prevX;
-	newSection->prevY = section.prevY;
-	newSection->nextX = section.x;
-	newSection->nextY = section.y;
-	
-	section.pLeft = newSection;
+	QPointF d1 = b - a;
+	QPointF d2 = c - b;
+	double cross = d1.x() * d2.y() - d1.y() * d2.x();
+	double dot = d1.x() * d2.x() + d1.y() * d2.y();
 	
-	divideRight( *newSection );
-	divideLeft( *newSection );
+	return atan2( cross, dot ) < -MIN_PIECE_TURN;
 }
 
-// ============================================================================
-// Generates random number from range from start to end inclusive
-double Ground::rand( double start, double end )
-{
-	return start + (end-start) * 0.001*(qrand() % 1000);
-}
-
-// =========================== create shape ============================
-QList<b2PolygonDef*> Ground::createShape()
+// ========================== create piece ================
+/// Creates polygon from heightmap points \b start to \b end, closed by vertical
+/// edges and bottom edge.
+b2PolygonDef* Ground::createPieceB2Shape( int start, int end )
 {
-	QList<b2PolygonDef*> list;
-	
-	// create two triangles for each point (trapezoid) in height map
-	int num = _heightmap.size();
-	QPointF prevPoint = _heightmap.first();
-	for ( int i = 1; i < num; i++ )
+	double low = _heightmap[start].y();
+	for( int i = start + 1; i <= end; i++ )
 	{
-		QPointF point = _heightmap[ i ];
-		
-		double bottom = qMax( qMin( point.y(), prevPoint.y() ) - 100, world()->boundary().top() );
-		
-		// calculate point at bottom
-		QPointF bottomPoint( ( prevPoint.x() + point.x() ) / 2, bottom );
-		
-		list.append( createTriangleB2Shape( bottomPoint, point, prevPoint ) );
-		
-		prevPoint = point;
+		low = qMin( low, _heightmap[i].y() );
 	}
+	double bottom = qMax( low - 100, world()->boundary().top() );
 	
-	return list;
-}
-// ========================== create triangle ================
-b2PolygonDef* Ground::createTriangleB2Shape( const QPointF& a, const QPointF& b, const QPointF& c )
-{
-	b2PolygonDef* pTriangle = new b2PolygonDef();
+	b2PolygonDef* pPolygon = new b2PolygonDef();
 	
-	pTriangle->vertexCount = 3;
-	pTriangle->vertices[0].Set( a.x(), a.y() );
-	pTriangle->vertices[1].Set( b.x(), b.y() );
-	pTriangle->vertices[2].Set( c.x(), c.y() );
+	// counter-clockwise: bottom edge, then surface from right to left
+	int v = 0;
+	pPolygon->vertices[v++].Set( _heightmap[start].x(), bottom );
+	pPolygon->vertices[v++].Set( _heightmap[end].x(), bottom );
+	for( int i = end; i >= start; i-- )
+	{
+		pPolygon->vertices[v++].Set( _heightmap[i].x(), _heightmap[i].y() );
+	}
+	pPolygon->vertexCount = v;
 	
-	pTriangle->restitution = 0.01;
+	pPolygon->restitution = 0.01;
 	
-	return pTriangle;
+	return pPolygon;
 }
 
 // ============================================================================
 // Renders ground
-void Ground::render ( QPainter& painter, const QRectF& /*rect*/, const RenderingOptions& /*options*/ )
+void Ground::render ( QPainter& painter, const QRectF& rect, const RenderingOptions& /*options*/ )
 {
 	painter.setPen( Qt::NoPen );
 	painter.setBrush( QColor("#8F6A32") );
 
 	// draw filling
-	
-	// create cached polygin, if none
-	if ( _painterPolygon.empty() )
-	{
-		_painterPolygon = _heightmap;
-		// add corners
-		_painterPolygon.append( world()->boundary().topRight() );
-		_painterPolygon.prepend( world()->boundary().topLeft() );
-	}
-	painter.drawPolygon( _painterPolygon );
+	painter.drawPolygon( outline( painter.transform(), rect ) );
 	
 	// draw textures
 	/* TODO remove, done by decoration now
@@ -454,22 +474,185 @@ void Ground::render ( QPainter& painter, const QRectF& /*rect*/, const Rendering
 
 // ============================================================================
 // Renders grpound on map
-void Ground::renderOnMap( QPainter& painter, const QRectF& /*rect*/ )
+void Ground::renderOnMap( QPainter& painter, const QRectF& rect )
 {
 	painter.setPen( Qt::black );
 	painter.setBrush( Qt::green );
 
-	// create cached polygin, if none
-	if ( _painterPolygon.empty() )
+	painter.drawPolygon( outline( painter.transform(), rect ) );
+}
+
+// ============================================================================
+/// Builds level-of-detail pyramid. First level is the heightmap itself, each next
+/// is simplified with twice the tolerance of previous one, until simplification
+/// leaves only end points. For each level, bounds of area below each LOD_BLOCK points
+/// are stored, so visible part of level can be found quickly.
+void Ground::buildLods()
+{
+	_lods.clear();
+	if ( _heightmap.size() < 2 )
 	{
-		_painterPolygon = _heightmap;
-		// add corners
-		_painterPolygon.append( world()->boundary().topRight() );
-		_painterPolygon.prepend( world()->boundary().topLeft() );
+		return;
 	}
 	
+	Lod full;
+	full.tolerance = 0.0;
+	full.points = _heightmap;
+	_lods.append( full );
 	
-	painter.drawPolygon( _painterPolygon );
+	// each level is simplified from full heightmap, so error doesn't accumulate
+	double tolerance = LOD_MIN_TOLERANCE;
+	while( _lods.size() < LOD_MAX_LEVELS && _lods.last().points.size() > 2 )
+	{
+		Lod lod;
+		lod.tolerance = tolerance;
+		lod.points = simplify( _heightmap, tolerance );
+		_lods.append( lod );
+		tolerance *= 2;
+	}
+	
+	// bounds
+	double bottom = world()->boundary().top();
+	for( int l = 0; l < _lods.size(); l++ )
+	{
+		Lod& lod = _lods[l];
+		int points = lod.points.size();
+		for( int start = 0; start < points - 1; start += LOD_BLOCK )
+		{
+			// block includes first point of next block, so it covers all its segments
+			int end = qMin( start + LOD_BLOCK, points - 1 );
+			double top = lod.points[start].y();
+			for( int i = start + 1; i <= end; i++ )
+			{
+				top = qMax( top, lod.points[i].y() );
+			}
+			lod.blockBounds.append( QRectF( QPointF( lod.points[start].x(), bottom ),
+				QPointF( lod.points[end].x(), top ) ).normalized() );
+		}
+	}
+	
+	//qDebug("Ground: %d LOD levels, coarsest has %d points", _lods.size(), _lods.last().points.size() );
+}
+
+// ============================================================================
+/// Simplifies polyline using Douglas-Peucker algorithm. Resulting polyline
+/// is never further from original points than tolerance.
+QPolygonF Ground::simplify( const QPolygonF& points, double tolerance )
+{
+	int size = points.size();
+	if ( size < 3 )
+	{
+		return points;
+	}
+	
+	QVector<bool> keep( size, false );
+	keep[0] = true;
+	keep[size-1] = true;
+	
+	// iterative - ranges to simplify are kept on stack
+	QVector< QPair<int, int> > stack;
+	stack.append( qMakePair( 0, size - 1 ) );
+	while( ! stack.isEmpty() )
+	{
+		QPair<int, int> range = stack.last();
+		stack.remove( stack.size() - 1 );
+		
+		const QPointF& a = points[range.first];
+		const QPointF& b = points[range.second];
+		double dx = b.x() - a.x();
+		double dy = b.y() - a.y();
+		double length = sqrt( dx*dx + dy*dy );
+		
+		// find point furthest from line
+		int furthest = -1;
+		double maxDistance = tolerance;
+		for( int i = range.first + 1; i < range.second; i++ )
+		{
+			double distance = fabs( dx * ( points[i].y() - a.y() ) - dy * ( points[i].x() - a.x() ) ) / length;
+			if ( distance > maxDistance )
+			{
+				maxDistance = distance;
+				furthest = i;
+			}
+		}
+		
+		if ( furthest >= 0 )
+		{
+			keep[furthest] = true;
+			stack.append( qMakePair( range.first, furthest ) );
+			stack.append( qMakePair( furthest, range.second ) );
+		}
+	}
+	
+	QPolygonF result;
+	for( int i = 0; i < size; i++ )
+	{
+		if ( keep[i] )
+		{
+			result.append( points[i] );
+		}
+	}
+	
+	return result;
+}
+
+// ============================================================================
+/// Builds ground outline polygon for view. Uses the coarsest LOD level which
+/// stays within LOD_MAX_ERROR pixels from heightmap under provided transform,
+/// and only points of blocks which intersect the rect.
+QPolygonF Ground::outline( const QTransform& transform, const QRectF& rect ) const
+{
+	if ( _lods.isEmpty() )
+	{
+		return QPolygonF();
+	}
+	
+	// pixels per meter
+	QPointF origin = transform.map( QPointF( 0, 0 ) );
+	double scale = qMax( QLineF( origin, transform.map( QPointF( 1, 0 ) ) ).length(),
+		QLineF( origin, transform.map( QPointF( 0, 1 ) ) ).length() );
+	
+	int level = 0;
+	while( level < _lods.size() - 1 && _lods[ level + 1 ].tolerance * scale <= LOD_MAX_ERROR )
+	{
+		level++;
+	}
+	const Lod& lod = _lods[ level ];
+	
+	// find visible blocks
+	int firstBlock = -1;
+	int lastBlock = -1;
+	for( int i = 0; i < lod.blockBounds.size(); i++ )
+	{
+		if ( lod.blockBounds[i].intersects( rect ) )
+		{
+			if ( firstBlock < 0 )
+			{
+				firstBlock = i;
+			}
+			lastBlock = i;
+		}
+	}
+	
+	if ( firstBlock < 0 )
+	{
+		return QPolygonF();
+	}
+	
+	int start = firstBlock * LOD_BLOCK;
+	int end = qMin( ( lastBlock + 1 ) * LOD_BLOCK, lod.points.size() - 1 );
+	double bottom = world()->boundary().top();
+	
+	QPolygonF polygon;
+	polygon.reserve( end - start + 3 );
+	polygon.append( QPointF( lod.points[start].x(), bottom ) );
+	for( int i = start; i <= end; i++ )
+	{
+		polygon.append( lod.points[i] );
+	}
+	polygon.append( QPointF( lod.points[end].x(), bottom ) );
+	
+	return polygon;
 }
 
 // ============================================================================
@@ -477,7 +660,19 @@ void Ground::renderOnMap( QPainter& painter, const QRectF& /*rect*/ )
 /// It is assumed that heightmap is already generated.
 void Ground::prepareTextures()
 {
-	const double TEXTURE_LENGTH = 50; // texture length, in meters
+	uint texturesSeed = qrand();
+	uint decorationsSeed = qrand();
+	assembleTextures( texturesSeed );
+	createDecorations( decorationsSeed );
+}
+
+// ============================================================================
+/// Assembles long ground textures from random combination of grass images, using
+/// random generator seeded with \b seed. Doesn't need heightmap, touches only textures
+/// and uses only qrand(), so may be called on worker thread.
+void Ground::assembleTextures( uint seed )
+{
+	qsrand( seed );
 	
 	// first - get list of source images
 	QList<Texture> components;
@@ -515,12 +710,39 @@ void Ground::prepareTextures()
 		
 		_textures.append( assembled );
 	}
+}
+
+// ============================================================================
+/// Creates ground decorations - textured ground segments - for each heightmap segment.
+/// Requires heightmap and assembled textures. Adds objects to world.
+void Ground::createDecorations( uint seed )
+{
+	prepareDecorations( seed );
+	createDecorations();
+}
+
+// ============================================================================
+/// Creates ground decorations for segments with textures assigned by prepareDecorations()
+/// or restoreTextures(). Adds objects to world.
+void Ground::createDecorations()
+{
+	for( int i = 0; i < _segmentTextures.size(); i++ )
+	{
+		_decorations.append( createDecoration( i ) );
+	}
+}
+
+// ============================================================================
+/// Generates random sequence of texture images for each heightmap segment, using
+/// random generator seeded with \b seed. Decoration objects are not created,
+/// chunked terrain creates them on demand in createChunk().
+void Ground::prepareDecorations( uint seed )
+{
+	qsrand( seed );
 	
-	// ok, now generate randomsequences for each ground segment
+	_segmentTextures.clear();
 	for( int i = 0; i < _heightmap.size()-1; i++ )
 	{
-		// random texture images
-		
 		QList<int> textureIndices;
 		double segmentLength = _heightmap[i+1].x() - _heightmap[i].x();
 		int imageCount = int( ceil( segmentLength / TEXTURE_LENGTH ) );
@@ -529,31 +751,170 @@ void Ground::prepareTextures()
 			textureIndices.append( qrand() % _textures.size() );
 		}
 		
-		// prepare transformation and bounding rect
-		
-		const QPointF& p1 = _heightmap[i];
-		const QPointF& p2 = _heightmap[i+1];
-		
-		double low = qMin( p1.y(), p2.y() );
-		double hi = qMax( p1.y(), p2.y() );
-		
-		double scale = 0.05; // std 5cm / pixel
-		double shear = ( p2.y() - p1.y() ) / ( p2.x() - p1.x() );
-		const double vmargin = 1.0; // max height of grass
-		
-		QRectF segmentRect( QPointF( p1.x(), low-vmargin), QPointF( p2.x(), hi+vmargin ) );
-		
-		QTransform t;
-		t.translate(  _heightmap[i].x(), _heightmap[i].y() );
-		t.scale( scale, - scale );
-		t.shear( 0, -shear );
-		
-		// create segment
+		_segmentTextures.append( textureIndices );
+	}
+}
+
+// ============================================================================
+/// Creates decoration - textured ground segment - for heightmap segment,
+/// and adds it to the world.
+GroundDecoration* Ground::createDecoration( int segment )
+{
+	// prepare transformation and bounding rect
+	
+	const QPointF& p1 = _heightmap[segment];
+	const QPointF& p2 = _heightmap[segment+1];
+	
+	double low = qMin( p1.y(), p2.y() );
+	double hi = qMax( p1.y(), p2.y() );
+	
+	double scale = 0.05; // std 5cm / pixel
+	double shear = ( p2.y() - p1.y() ) / ( p2.x() - p1.x() );
+	const double vmargin = 1.0; // max height of grass
+	
+	QRectF segmentRect( QPointF( p1.x(), low-vmargin), QPointF( p2.x(), hi+vmargin ) );
+	
+	QTransform t;
+	t.translate(  p1.x(), p1.y() );
+	t.scale( scale, - scale );
+	t.shear( 0, -shear );
+	
+	// create segment
+	
+	GroundDecoration* pDecoration = new GroundDecoration( world() );
+	pDecoration->init( _segmentTextures[segment], segmentRect, t, & _textures );
+	world()->addObject( pDecoration, World::ObjectStatic );
+	
+	return pDecoration;
+}
+
+// ============================================================================
+/// Destroys body and decorations created for whole ground by createBody() and createDecorations().
+/// After this, terrain is created in chunks, by createChunk().
+void Ground::releaseTerrain()
+{
+	_chunked = true;
+	
+	foreach( Body* pBody, _groundBodies )
+	{
+		removeBody( pBody );
+		delete pBody;
+	}
+	_groundBodies.clear();
+	
+	foreach( GroundDecoration* pDecoration, _decorations )
+	{
+		world()->removeObject( pDecoration );
+	}
+	_decorations.clear();
+}
+
+// ============================================================================
+/// Creates chunk of terrain: body and decorations for heightmap segments starting
+/// in x-range [from, to). Used by world streaming.
+void Ground::createChunk( int index, double from, double to )
+{
+	if ( _chunks.contains( index ) )
+	{
+		qWarning("Ground chunk %d already created", index );
+		return;
+	}
+	
+	setLayers( 0xffff ); //all!
+	
+	Chunk chunk;
+	chunk.pBody = createGroundBody( from, to );
+	for( int i = 0; i < _segmentTextures.size(); i++ )
+	{
+		double x = _heightmap[i].x();
+		if ( x >= from && x < to )
+		{
+			chunk.decorations.append( createDecoration( i ) );
+		}
+	}
+	
+	_chunks.insert( index, chunk );
+}
+
+// ============================================================================
+/// Destroys chunk of terrain.
+void Ground::destroyChunk( int index )
+{
+	if ( ! _chunks.contains( index ) )
+	{
+		return;
+	}
+	
+	Chunk chunk = _chunks.take( index );
+	if ( chunk.pBody )
+	{
+		removeBody( chunk.pBody );
+		delete chunk.pBody;
+	}
+	foreach( GroundDecoration* pDecoration, chunk.decorations )
+	{
+		world()->removeObject( pDecoration );
+	}
+}
+
+// ============================================================================
+/// Writes heightmap and textures. Ground re-created from them looks exactly the same.
+void Ground::saveParams( QDataStream& stream ) const
+{
+	stream << _heightmap << _chunked;
+	saveTextures( stream );
+}
+
+// ============================================================================
+/// Ground is static, and its bodies are re-created from heightmap, so there is no state to store.
+void Ground::saveState( QDataStream& /*stream*/, const WorldSnapshot& /*snapshot*/ ) const
+{
+}
+
+// ============================================================================
+/// Does nothing, see saveState().
+void Ground::restoreState( QDataStream& /*stream*/, const WorldSnapshot& /*snapshot*/ )
+{
+}
+
+// ============================================================================
+/// Writes assembled textures and texture indices of each segment. Image pixels are
+/// written raw, so they are read back with a copy, without decoding or painting.
+void Ground::saveTextures( QDataStream& stream ) const
+{
+	stream << _textures.size();
+	foreach( Texture texture, _textures )
+	{
+		const QImage& image = texture.baseImage();
+		stream << texture.resolution() << image.width() << image.height() << int( image.format() );
+		stream.writeRawData( reinterpret_cast<const char*>( image.bits() ), image.numBytes() );
+	}
+	
+	stream << _segmentTextures;
+}
+
+// ============================================================================
+/// Reads textures written by saveTextures(). Replaces assembleTextures() and prepareDecorations().
+void Ground::restoreTextures( QDataStream& stream )
+{
+	int count;
+	stream >> count;
+	
+	_textures.clear();
+	for( int i = 0; i < count; i++ )
+	{
+		double resolution;
+		int width, height, format;
+		stream >> resolution >> width >> height >> format;
 		
-		GroundDecoration* pDecoration = new GroundDecoration( world() );
-		pDecoration->init( textureIndices, segmentRect, t, & _textures );
-		world()->addObject( pDecoration, World::ObjectStatic );
+		QImage image( width, height, QImage::Format( format ) );
+		stream.readRawData( reinterpret_cast<char*>( image.bits() ), image.numBytes() );
+		_textures.append( Texture( image, resolution ) );
 	}
+	
+	stream >> _segmentTextures;
 }
 
 }
+
+// EOF
@@ -17,6 +17,8 @@
 #ifndef FLYERGROUND_H
 #define FLYERGROUND_H
 
+#include <QVector>
+
 #include "physicalobject.h"
 #include "body.h"
 
@@ -24,6 +26,8 @@
 namespace Flyer
 {
 
+class GroundDecoration;
+
 /**
 	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
@@ -38,11 +42,6 @@ public:
 	{
 		double x;			///< x-coord of left point
 		double y;			///< y -ccord of left point
-		double nextX;		///< x of next point
-		double nextY;		///< y of next point
-		double prevX;		///< x of prev point
-		double prevY;		///< y of prev point
-		bool canBeDividedLeft;	///< if section can be divided at left
 		bool canBeDividedRight;	///< if section can be divided at right
 		
 		// settings
@@ -52,47 +51,98 @@ public:
 		double minHeight;
 		
 		double maxSlope;	///< max slope in this section
-		
-		// kids
-		Section* pLeft, *pRight;
-		
-		Section() { pLeft = NULL; pRight = NULL; }
-		~Section() { delete pLeft; delete pRight; }
 	};
 
 	virtual void render ( QPainter& painter, const QRectF& rect, const RenderingOptions& options  );
 	virtual void renderOnMap( QPainter& painter, const QRectF& rect );
 	double height( double x ) const;					///< Calculates ground height at specified x
+	void heights( const double* pX, double* pY, int count ) const;	///< Calculates ground height for many x
+	const QPolygonF& heightmap() const { return _heightmap; }	///< Returns heightmap
 	
 	void setHeightmap( const QPolygonF& heightMap );	///< Sets heightmap
 	void random( QList<Section> seed );				///< Generates random ground
+	
+	// construction steps, used by random(). May be run separately, see comments in cpp
+	
+	QPolygonF generate( QList<Section> seed );		///< Generates random heightmap
+	void createBody();								///< Creates ground bodies from heightmap
+	void assembleTextures( uint seed );				///< Assembles ground textures
+	void createDecorations( uint seed );			///< Creates textured ground segments
+	void prepareDecorations( uint seed );			///< Assigns textures to segments, w/o creating objects
+	void createDecorations();						///< Creates segments with textures already assigned
+	
+	// streaming
+	
+	void releaseTerrain();							///< Destroys whole-ground body and decorations
+	void createChunk( int index, double from, double to );	///< Creates body and decorations in x-range
+	void destroyChunk( int index );					///< Destroys chunk created by createChunk()
+	bool isChunked() const { return _chunked; }		///< If terrain is created in chunks
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Ground"; }
+	virtual void saveParams( QDataStream& stream ) const;
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
+	
+	void saveTextures( QDataStream& stream ) const;	///< Writes assembled textures and segment textures
+	void restoreTextures( QDataStream& stream );	///< Reads textures, instead of assembling and assigning them
 
 private:
 
 	
-	void divideRight( Section& section ); // divides section on right
-	void divideLeft( Section& section );	// divides section on left
-	static double rand( double start, double end );
-	void traverseSection( Section& section, QPolygonF& points );
-	
-	QPolygonF generate( QList<Section> seed );
-	
 	void random();					///< Generates random ground
 
-	Body* _pGround;					///< Ground body
+	QList<Body*>	_groundBodies;		///< Bodies of whole ground, created by createBody()
 	QPolygonF	_heightmap;					///< Heightmap - poins of ground surface
-
-	/// Genrates shapes from heightmap
-	QList<b2PolygonDef*> createShape();
-	b2PolygonDef* createTriangleB2Shape( const QPointF& a, const QPointF& b, const QPointF& c );
 	
-	QPolygonF	_painterPolygon;		///< Cached outline
+	// height lookup
+	
+	void buildHeightIndex();			///< Builds height lookup grid
+	int segment( double x ) const;		///< Finds heightmap segment containing x
+	QVector<double>	_slopes;			///< Slope (dy/dx) of each heightmap segment
+	QVector<int>	_heightGrid;		///< First segment overlapping each grid cell
+
+	/// Genrates shapes from heightmap segments in x-range
+	QList<b2PolygonDef*> createShape( double from, double to );
+	Body* createGroundBody( double from, double to );	///< Creates body from segments in x-range
+	b2PolygonDef* createPieceB2Shape( int start, int end );	///< Creates polygon under heightmap points
+	static bool isConvexVertex( const QPointF& a, const QPointF& b, const QPointF& c );
+	
+	// rendering
+	
+	/// Single level of terrain detail
+	struct Lod
+	{
+		double			tolerance;		///< Max distance of simplified outline from heightmap [m]
+		QPolygonF		points;			///< Simplified heightmap
+		QVector<QRectF>	blockBounds;	///< Bounds of area below each block of points
+	};
 	
+	void buildLods();					///< Builds level-of-detail pyramid
+	static QPolygonF simplify( const QPolygonF& points, double tolerance );	///< Douglas-Peucker simplification
+	QPolygonF outline( const QTransform& transform, const QRectF& rect ) const;	///< Visible ground polygon
+	QList<Lod>	_lods;					///< Level-of-detail pyramid, from full heightmap to coarsest
 	
 	// texturing
 	
 	void prepareTextures();						///< Genrerates textures which will be used to render the ground
+	GroundDecoration* createDecoration( int segment );	///< Creates textured segment
 	QList<Texture>		_textures;				///< Textures used to draw ground
+	QList< QList<int> >	_segmentTextures;		///< Texture indices for each heightmap segment
+	QList<GroundDecoration*> _decorations;		///< Decorations of whole ground
+	
+	// streaming
+	
+	/// Terrain chunk
+	struct Chunk
+	{
+		Body* pBody;							///< Chunk body, NULL if chunk has no segments
+		QList<GroundDecoration*> decorations;	///< Chunk decorations
+	};
+	
+	QMap<int, Chunk>	_chunks;				///< Created chunks, by index
+	bool				_chunked;				///< Terrain is created in chunks
 
 };
 
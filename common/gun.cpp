@@ -14,12 +14,15 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "bullet.h"
 #include "world.h"
 #include "common.h"
 #include "plane.h"
 #include "b2dqt.h"
 #include "body.h"
+#include "projectilesystem.h"
 
 #include "gun.h"
 
@@ -38,6 +41,7 @@ Gun::Gun ( Machine* pParent, const QString& name ) : System ( pParent, name )
 	_timeFromLastFiring = 0;
 	_broken = false;
 	_muzzleShift = 0.0;
+	_bodyBullets = false;
 }
 
 // ============================================================================
@@ -95,16 +99,6 @@ void Gun::simulate( double dt )
 		{
 			b2Body* pBody = body()->b2body();
 			
-			// create bullet
-			Bullet* pBullet = new Bullet( parent()->world() );			
-			parent()->world()->addObject( pBullet, World::ObjectSimulated );
-			
-			
-			pBullet->setMass( _mass );
-			pBullet->setLifespan( _lifespan );
-			pBullet->setSize( _size );
-			pBullet->setRenderLayer( LayerForeground );
-			
 			// fire bullet
 			b2Vec2 startPoint = pBody->GetWorldPoint( point2vec( _muzzle + _normal*_muzzleShift ) );
 			b2Vec2 endPoint = pBody->GetWorldPoint( point2vec( _muzzle + _normal*(_muzzleShift+1) ) );
@@ -113,7 +107,22 @@ void Gun::simulate( double dt )
 			
 			QPointF velocity = vec2point( normal ) * _currentVelocity;
 			
-			pBullet->fire( vec2point( startPoint ), velocity );
+			if ( _bodyBullets )
+			{
+				Bullet* pBullet = new Bullet( parent()->world() );
+				parent()->world()->addObject( pBullet, World::ObjectSimulated );
+				
+				pBullet->setMass( _mass );
+				pBullet->setLifespan( _lifespan );
+				pBullet->setSize( _size );
+				pBullet->setRenderLayer( LayerForeground );
+				
+				pBullet->fire( vec2point( startPoint ), velocity );
+			}
+			else
+			{
+				parent()->world()->projectiles()->fire( vec2point( startPoint ), velocity, _mass, _lifespan );
+			}
 			
 			// apply reverse impulse to parent body
 			//a = f/m;
@@ -199,4 +208,18 @@ void Gun::setWorldNormal( const QPointF& n )
 	_normal = vec2point( localEndpoint - point2vec( _muzzle ) );
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Gun::saveState( QDataStream& stream ) const
+{
+	stream << _firing << _timeFromLastFiring << _currentVelocity << _currentnInterval << _broken;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Gun::restoreState( QDataStream& stream )
+{
+	stream >> _firing >> _timeFromLastFiring >> _currentVelocity >> _currentnInterval >> _broken;
+}
+
 }
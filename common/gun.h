@@ -52,6 +52,9 @@ public:
 	void setBulletVelocity( double v ) { _velocity = v; _currentVelocity = v;}
 	void setFiringInterval( double i ) { _interval = i; _currentnInterval = i;}
 	void setMuzzleShift( double s ) { _muzzleShift = s; }
+	/// Fires full-body Bullet objects instead of lightweight rounds
+	void setBodyBullets( bool b ) { _bodyBullets = b; }
+	bool bodyBullets() const { return _bodyBullets; }
 	
 	// actions
 	void setFiring( bool firing ) { _firing = firing; }
@@ -62,6 +65,11 @@ public:
 	static Gun* kalashikov( Machine* pParent, const QString& name = "Kalashinkov" );
 	static Gun* berezin( Machine* pParent, const QString& name = "Berezin" );
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
+
 private:
 
 	// config
@@ -71,6 +79,7 @@ private:
 	double _velocity;	///< Bullet;s initial velocity
 	double _interval;	///< shooting interval [seconds]
 	double _muzzleShift;	///< Shift between muzzle and point where bullets are actually created
+	bool _bodyBullets;		///< If fires Bullet objects, simulated by Box2D
 	
 	QPointF _muzzle;	///< Muzzle location
 	QPointF _normal;	///< Muzzle direction
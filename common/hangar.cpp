@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "world.h"
 #include "body.h"
 #include "bodyprovider.h"
@@ -41,6 +43,7 @@ static const double MAX_VELOCITY = 0.5;	// maximum speed for machine to get repa
 Hangar::Hangar( World* pWorld, double location ): Machine( pWorld )
 {
 	setName( "Hangar" );
+	_location = location;
 	setLayers( PhysLayerBackground );
 	setRenderLayer( LayerBackground );
 
@@ -141,6 +144,12 @@ void Hangar::timer1()
 	
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void Hangar::saveParams( QDataStream& stream ) const
+{
+	stream << _location;
+}
 
 }
 
@@ -36,9 +36,15 @@ public:
 	
 	virtual void timer1();
 	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Hangar"; }
+	virtual void saveParams( QDataStream& stream ) const;
+
 private:
 
 	QRectF	_activeArea;	///< Active area
+	double	_location;		///< Location [m]
 
 };
 
@@ -0,0 +1,242 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <QFile>
+#include <QDataStream>
+
+#include "world.h"
+#include "plane.h"
+#include "worldsnapshot.h"
+
+#include "inputlog.h"
+
+namespace Flyer
+{
+
+static const char MAGIC[] = "FLYRINPT";		///< Log file magic
+static const int MAGIC_SIZE = 8;			///< Magic size, w/o terminating zero
+static const quint32 VERSION = 1;			///< Log format version
+
+// ============================================================================
+/// Constructor
+InputLog::InputLog()
+{
+	_recording = false;
+	_timestep = 0.0;
+	_steps = 0;
+}
+
+// ============================================================================
+/// Starts new recording. Previously recorded events are discarded.
+/// Taking snapshot re-seeds random generator, so world restored from
+/// the log continues with the same random sequence as the recorded one.
+void InputLog::startRecording( const World* pWorld, double timestep )
+{
+	Q_ASSERT( pWorld );
+	
+	_snapshot = WorldSnapshot::save( pWorld );
+	_timestep = timestep;
+	_steps = 0;
+	_events.clear();
+	_recording = true;
+}
+
+// ============================================================================
+/// Records command applied before current simulation step.
+void InputLog::record( Command command, double value )
+{
+	if ( ! _recording )
+	{
+		return;
+	}
+	
+	// coalesce absolute commands issued in the same step
+	if ( ! _events.isEmpty() && ( command == Elevator || command == Throttle || command == Flaps ) )
+	{
+		Event& last = _events.last();
+		if ( last.step == _steps && last.command == command )
+		{
+			last.value = value;
+			return;
+		}
+	}
+	
+	Event event;
+	event.step = _steps;
+	event.command = command;
+	event.value = value;
+	_events.append( event );
+}
+
+// ============================================================================
+/// Applies command to plane. Does nothing if plane is NULL.
+void InputLog::apply( Plane* pPlane, Command command, double value )
+{
+	if ( ! pPlane )
+	{
+		return;
+	}
+	
+	switch( command )
+	{
+		case Elevator:
+			pPlane->setElevator( value );
+			break;
+			
+		case Throttle:
+			pPlane->setThrottle( value );
+			break;
+			
+		case Flaps:
+			pPlane->setFlaps( value );
+			break;
+			
+		case Firing:
+			pPlane->setFiring( value != 0.0 );
+			break;
+			
+		case ReleaseWeapon:
+			pPlane->releaseWeapon();
+			break;
+			
+		case Flip:
+			pPlane->flipPlane();
+			break;
+			
+		case WheelBrake:
+			pPlane->applyWheelBrake( value != 0.0 );
+			break;
+			
+		case Autopilot:
+			pPlane->setAutopilot( value != 0.0 );
+			break;
+	}
+}
+
+// ============================================================================
+/// Applies all events recorded for \b step. Events are searched from \b *pNext,
+/// which is advanced past applied events. Start with 0 and call for each step in order.
+void InputLog::applyStep( Plane* pPlane, int step, int* pNext ) const
+{
+	Q_ASSERT( pNext );
+	
+	while ( *pNext < _events.size() && _events[ *pNext ].step <= step )
+	{
+		const Event& event = _events[ *pNext ];
+		apply( pPlane, event.command, event.value );
+		(*pNext)++;
+	}
+}
+
+// ============================================================================
+/// Creates world from snapshot taken at the beginning of recording.
+World* InputLog::createWorld() const
+{
+	if ( _snapshot.isEmpty() )
+	{
+		return NULL;
+	}
+	
+	return WorldSnapshot::restore( _snapshot );
+}
+
+// ============================================================================
+/// Stores log in file. Returns \b false on error.
+bool InputLog::save( const QString& path ) const
+{
+	QFile file( path );
+	if ( ! file.open( QIODevice::WriteOnly ) )
+	{
+		qWarning("Can't write input log %s", qPrintable( path ) );
+		return false;
+	}
+	
+	QDataStream stream( & file );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	
+	stream.writeRawData( MAGIC, MAGIC_SIZE );
+	stream << VERSION << _timestep << qint32( _steps ) << _snapshot;
+	
+	stream << qint32( _events.size() );
+	foreach( const Event& event, _events )
+	{
+		stream << qint32( event.step ) << quint8( event.command ) << event.value;
+	}
+	
+	return stream.status() == QDataStream::Ok;
+}
+
+// ============================================================================
+/// Loads log from file. Returns \b false if file can't be read or is not valid input log.
+bool InputLog::load( const QString& path )
+{
+	QFile file( path );
+	if ( ! file.open( QIODevice::ReadOnly ) )
+	{
+		qWarning("Can't read input log %s", qPrintable( path ) );
+		return false;
+	}
+	
+	QDataStream stream( & file );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	
+	char magic[ MAGIC_SIZE ];
+	quint32 version = 0;
+	if ( stream.readRawData( magic, MAGIC_SIZE ) != MAGIC_SIZE || qstrncmp( magic, MAGIC, MAGIC_SIZE ) != 0 )
+	{
+		qWarning("%s is not an input log", qPrintable( path ) );
+		return false;
+	}
+	stream >> version;
+	if ( version != VERSION )
+	{
+		qWarning("Input log %s has unsupported version %u", qPrintable( path ), version );
+		return false;
+	}
+	
+	qint32 steps, count;
+	stream >> _timestep >> steps >> _snapshot >> count;
+	_steps = steps;
+	
+	_events.clear();
+	for( int i = 0; i < count && stream.status() == QDataStream::Ok; i++ )
+	{
+		qint32 step;
+		quint8 command;
+		Event event;
+		stream >> step >> command >> event.value;
+		event.step = step;
+		event.command = Command( command );
+		_events.append( event );
+	}
+	
+	_recording = false;
+	
+	if ( stream.status() != QDataStream::Ok )
+	{
+		qWarning("Input log %s is truncated", qPrintable( path ) );
+		return false;
+	}
+	
+	return true;
+}
+
+}
+
+// EOF
+
+
@@ -0,0 +1,118 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERINPUTLOG_H
+#define FLYERINPUTLOG_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace Flyer
+{
+
+class World;
+class Plane;
+
+/**
+	Log of player's input. Holds world snapshot taken when recording started
+	(which includes random generator seed), simulation timestep and list of
+	commands sent to player's plane, each tagged with number of simulation step
+	before which it was applied.
+	Since simulation is deterministic, log can be replayed without UI, at any speed,
+	reproducing recorded flight exactly.
+	Commands setting absolute value (elevator, throttle, flaps) issued in the same step
+	are coalesced, so mouse steering doesn't flood the log.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class InputLog
+{
+public:
+	
+	/// Command sent to player's plane
+	enum Command
+	{
+		Elevator,		///< Sets elevator, value is elevator position
+		Throttle,		///< Sets throttle, value is new throttle
+		Flaps,			///< Sets flaps, value is new flaps position
+		Firing,			///< Starts/stops firing, value is 1 or 0
+		ReleaseWeapon,	///< Releases weapon
+		Flip,			///< Flips plane
+		WheelBrake,		///< Applies/releases wheel brake, value is 1 or 0
+		Autopilot		///< Turns autopilot on/off, value is 1 or 0
+	};
+	
+	/// Single logged command
+	struct Event
+	{
+		int		step;		///< Simulation step before which command was applied
+		Command	command;	///< Command
+		double	value;		///< Command value
+	};
+	
+	InputLog();
+	
+	// recording
+	
+	/// Starts new recording. Takes snapshot of the world
+	void startRecording( const World* pWorld, double timestep );
+	/// Records command. Doesn't apply it
+	void record( Command command, double value = 0.0 );
+	/// Called after each simulation step
+	void stepFinished() { _steps++; }
+	/// Returns \b true if recording was started
+	bool isRecording() const { return _recording; }
+	
+	// replay
+	
+	/// Applies command to plane
+	static void apply( Plane* pPlane, Command command, double value );
+	/// Applies all commands recorded for simulation step. \b pNext is index of first not applied event.
+	void applyStep( Plane* pPlane, int step, int* pNext ) const;
+	/// Creates world from recorded snapshot. Returns NULL if there is no valid snapshot
+	World* createWorld() const;
+	
+	// properties
+	
+	double timestep() const { return _timestep; }				///< Simulation timestep [s]
+	int steps() const { return _steps; }						///< Number of recorded steps
+	const QList<Event>& events() const { return _events; }		///< Recorded events
+	const QByteArray& snapshot() const { return _snapshot; }	///< World state at start of recording
+	
+	// i/o
+	
+	/// Stores log in file
+	bool save( const QString& path ) const;
+	/// Loads log from file
+	bool load( const QString& path );
+
+private:
+	
+	bool		_recording;		///< Recording flag
+	double		_timestep;		///< Simulation timestep
+	int			_steps;			///< Simulation steps recorded
+	QByteArray	_snapshot;		///< Snapshot of world at start
+	QList<Event> _events;		///< Logged commands
+};
+
+}
+
+#endif // FLYERINPUTLOG_H
+
+// EOF
+
+
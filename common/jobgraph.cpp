@@ -0,0 +1,264 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <QRunnable>
+#include <QThread>
+#include <QMutexLocker>
+#include <QFile>
+#include <QTextStream>
+
+#include "common.h"
+
+#include "jobgraph.h"
+
+namespace Flyer
+{
+
+static const int TIMELINE_WIDTH = 40;	///< Width of printed timeline bar [characters]
+
+/// Runs single graph job on thread pool
+class JobRunner : public QRunnable
+{
+public:
+	JobRunner( JobGraph* pGraph, int job ) : _pGraph( pGraph ), _job( job )
+	{
+		setAutoDelete( true );
+	}
+	
+	virtual void run()
+	{
+		_pGraph->execute( _job );
+		
+		QMutexLocker locker( & _pGraph->_mutex );
+		_pGraph->finish( _job );
+	}
+	
+private:
+	JobGraph*	_pGraph;
+	int			_job;
+};
+
+// ============================================================================
+// Constructor
+JobGraph::JobGraph()
+{
+	_remaining = 0;
+	_running = 0;
+	_startTime = 0.0;
+	_totalTime = 0.0;
+	_pool.setMaxThreadCount( QThread::idealThreadCount() );
+}
+
+// ============================================================================
+// Destructor
+JobGraph::~JobGraph()
+{
+	_pool.waitForDone();
+	foreach( const Node& node, _nodes )
+	{
+		delete node.pJob;
+	}
+}
+
+// ============================================================================
+/// Adds job to graph. Graph takes ownership of the job.
+int JobGraph::addJob( const QString& name, Job* pJob, Affinity affinity )
+{
+	Q_ASSERT( pJob );
+	
+	Node node;
+	node.name = name;
+	node.pJob = pJob;
+	node.affinity = affinity;
+	node.dependencies = 0;
+	node.pending = 0;
+	node.start = 0.0;
+	node.end = 0.0;
+	
+	_nodes.append( node );
+	
+	return _nodes.size() - 1;
+}
+
+// ============================================================================
+/// Makes \b job wait for \b dependency.
+void JobGraph::addDependency( int job, int dependency )
+{
+	Q_ASSERT( job >= 0 && job < _nodes.size() );
+	Q_ASSERT( dependency >= 0 && dependency < _nodes.size() );
+	Q_ASSERT( job != dependency );
+	
+	_nodes[ dependency ].dependents.append( job );
+	_nodes[ job ].dependencies++;
+}
+
+// ============================================================================
+/// Sets max number of pool threads.
+void JobGraph::setThreads( int threads )
+{
+	_pool.setMaxThreadCount( qMax( 1, threads ) );
+}
+
+// ============================================================================
+/// Runs all jobs. Main-thread jobs are executed here, the rest on thread pool.
+/// Returns when all jobs are finished.
+void JobGraph::run()
+{
+	QMutexLocker locker( & _mutex );
+	
+	_startTime = getms();
+	_remaining = _nodes.size();
+	_running = 0;
+	_mainQueue.clear();
+	
+	for( int i = 0; i < _nodes.size(); i++ )
+	{
+		_nodes[i].pending = _nodes[i].dependencies;
+	}
+	for( int i = 0; i < _nodes.size(); i++ )
+	{
+		if ( _nodes[i].pending == 0 )
+		{
+			schedule( i );
+		}
+	}
+	
+	while( _remaining > 0 )
+	{
+		if ( ! _mainQueue.isEmpty() )
+		{
+			int job = _mainQueue.takeFirst();
+			
+			locker.unlock();
+			execute( job );
+			locker.relock();
+			
+			finish( job );
+		}
+		else if ( _running == 0 )
+		{
+			qWarning("JobGraph: %d jobs can not be started, dependency cycle?", _remaining );
+			break;
+		}
+		else
+		{
+			_changed.wait( & _mutex );
+		}
+	}
+	
+	_totalTime = getms() - _startTime;
+}
+
+// ============================================================================
+/// Starts job which has all dependencies finished. Caller must hold the mutex.
+void JobGraph::schedule( int job )
+{
+	if ( _nodes[ job ].affinity == MainThread )
+	{
+		_mainQueue.append( job );
+		_changed.wakeAll();
+	}
+	else
+	{
+		_running++;
+		_pool.start( new JobRunner( this, job ) );
+	}
+}
+
+// ============================================================================
+/// Runs the job and records its timing. Called without the mutex held.
+void JobGraph::execute( int job )
+{
+	Node& node = _nodes[ job ];
+	
+	node.start = getms() - _startTime;
+	node.pJob->run();
+	node.end = getms() - _startTime;
+}
+
+// ============================================================================
+/// Marks job as finished, schedules dependents which are now ready. Caller must hold the mutex.
+void JobGraph::finish( int job )
+{
+	if ( _nodes[ job ].affinity == AnyThread )
+	{
+		_running--;
+	}
+	_remaining--;
+	
+	foreach( int dependent, _nodes[ job ].dependents )
+	{
+		if ( --_nodes[ dependent ].pending == 0 )
+		{
+			schedule( dependent );
+		}
+	}
+	
+	_changed.wakeAll();
+}
+
+// ============================================================================
+/// Prints timeline of the last run, with bar showing when each job was running.
+void JobGraph::printTimeline() const
+{
+	qDebug("Timeline: %d jobs, %.1f ms", _nodes.size(), _totalTime );
+	
+	double scale = _totalTime > 0.0 ? TIMELINE_WIDTH / _totalTime : 0.0;
+	foreach( const Node& node, _nodes )
+	{
+		int from = qBound( 0, int( node.start * scale ), TIMELINE_WIDTH - 1 );
+		int to = qBound( from + 1, int( node.end * scale + 0.5 ), TIMELINE_WIDTH );
+		
+		QByteArray bar( TIMELINE_WIDTH, '.' );
+		for( int i = from; i < to; i++ )
+		{
+			bar[i] = '#';
+		}
+		
+		qDebug(" %s %7.1f - %7.1f ms %-4s %s", bar.constData(), node.start, node.end,
+			node.affinity == MainThread ? "main" : "pool", qPrintable( node.name ) );
+	}
+}
+
+// ============================================================================
+/// Exports timeline of the last run to CSV file, one line per job.
+bool JobGraph::exportTimeline( const QString& path ) const
+{
+	QFile file( path );
+	if ( ! file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+	{
+		qWarning("Could not write timeline to %s: %s", qPrintable( path ), qPrintable( file.errorString() ) );
+		return false;
+	}
+	
+	QTextStream out( & file );
+	out << "job,thread,start_ms,end_ms,duration_ms\n";
+	foreach( const Node& node, _nodes )
+	{
+		out << node.name << ","
+			<< ( node.affinity == MainThread ? "main" : "pool" ) << ","
+			<< node.start << ","
+			<< node.end << ","
+			<< ( node.end - node.start ) << "\n";
+	}
+	
+	return true;
+}
+
+}
+
+// EOF
@@ -0,0 +1,139 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERJOBGRAPH_H
+#define FLYERJOBGRAPH_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+
+namespace Flyer
+{
+
+class JobRunner;
+
+/**
+	Set of named jobs with dependencies between them. Jobs are started as soon as
+	all their dependencies are finished. Jobs run on thread pool, unless marked as
+	main-thread jobs; those are executed on thread which called run(), one at a time,
+	so they may safely touch non-thread-safe state (like physics world).
+	Start and end time of each job are recorded, and may be printed or exported
+	as startup timeline.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class JobGraph
+{
+public:
+	
+	/// Single job. Implement run().
+	class Job
+	{
+	public:
+		virtual ~Job() {}
+		virtual void run() = 0;
+	};
+	
+	/// Job calling object's method
+	template< class T >
+	class MethodJob : public Job
+	{
+	public:
+		MethodJob( T* pObject, void (T::*pMethod)() ) : _pObject( pObject ), _pMethod( pMethod ) {}
+		virtual void run() { (_pObject->*_pMethod)(); }
+	private:
+		T*		_pObject;
+		void	(T::*_pMethod)();
+	};
+	
+	/// Where job can be executed
+	enum Affinity
+	{
+		AnyThread,		///< On thread pool
+		MainThread		///< On thread which called run()
+	};
+	
+	JobGraph();
+	~JobGraph();
+	
+	/// Adds job. Graph takes ownership of the job. Returns job id.
+	int addJob( const QString& name, Job* pJob, Affinity affinity = AnyThread );
+	
+	/// Adds job calling object's method. Returns job id.
+	template< class T >
+	int addJob( const QString& name, T* pObject, void (T::*pMethod)(), Affinity affinity = AnyThread )
+	{
+		return addJob( name, new MethodJob<T>( pObject, pMethod ), affinity );
+	}
+	
+	/// Job won't start until dependency is finished
+	void addDependency( int job, int dependency );
+	
+	/// Sets max number of pool threads
+	void setThreads( int threads );
+	
+	/// Runs all jobs, returns when all are finished
+	void run();
+	
+	/// Time it took to run whole graph [ms]
+	double totalTime() const { return _totalTime; }
+	
+	/// Prints timeline of last run
+	void printTimeline() const;
+	/// Exports timeline of last run to CSV file
+	bool exportTimeline( const QString& path ) const;
+
+private:
+	
+	friend class JobRunner;
+	
+	/// Job with its dependencies and timing
+	struct Node
+	{
+		QString		name;
+		Job*		pJob;
+		Affinity	affinity;
+		QList<int>	dependents;		///< Jobs waiting for this one
+		int			dependencies;	///< Number of jobs this one waits for
+		int			pending;		///< Unfinished dependencies, during run
+		double		start;			///< Start time, relative to graph start [ms]
+		double		end;			///< End time, relative to graph start [ms]
+	};
+	
+	void schedule( int job );
+	void execute( int job );
+	void finish( int job );
+	
+	QVector<Node>	_nodes;			///< Jobs
+	QThreadPool		_pool;			///< Worker threads
+	QMutex			_mutex;			///< Guards scheduling state
+	QWaitCondition	_changed;		///< Signalled when job is finished or main-thread job is ready
+	QList<int>		_mainQueue;		///< Main-thread jobs ready to run
+	int				_remaining;		///< Jobs not finished yet
+	int				_running;		///< Jobs currently running on pool
+	double			_startTime;		///< Graph start time [ms]
+	double			_totalTime;		///< Graph run time [ms]
+};
+
+}
+
+#endif // FLYERJOBGRAPH_H
+
+// EOF
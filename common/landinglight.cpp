@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <math.h>
 
 #include <QPainter>
@@ -127,4 +129,11 @@ void LandingLight::render(QPainter& painter, const QRectF& rect, const Rendering
 	
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void LandingLight::saveParams( QDataStream& stream ) const
+{
+	stream << _x << _angle;
+}
+
 }
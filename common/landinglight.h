@@ -38,6 +38,11 @@ public:
 	
 	virtual QRectF boundingRect() const;
 	virtual void render(QPainter& painter, const QRectF& rect, const RenderingOptions& /*options*/ );
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "LandingLight"; }
+	virtual void saveParams( QDataStream& stream ) const;
 
 private:
 
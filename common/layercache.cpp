@@ -0,0 +1,141 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <QRegion>
+#include <QVector>
+
+#include "world.h"
+
+#include "layercache.h"
+
+namespace Flyer
+{
+
+static const int DEFAULT_MARGIN = 128;	///< Default margin around viewport [px]
+
+// ============================================================================
+// Constructor
+LayerCache::LayerCache( World* pWorld ) : _pWorld( pWorld )
+{
+	Q_ASSERT( pWorld );
+	_scaleX = 0.0;
+	_scaleY = 0.0;
+	_valid = false;
+	_margin = DEFAULT_MARGIN;
+}
+
+// ============================================================================
+// Destructor
+LayerCache::~LayerCache()
+{
+}
+
+// ============================================================================
+/// Renders cached layer on painter. Cache is updated if needed.
+/// Works only with scaling+translating transformations, for others returns \b false,
+/// and objects should be rendered directly.
+bool LayerCache::render( QPainter& painter, const QRectF& rect )
+{
+	QTransform t = painter.transform();
+	if ( t.type() > QTransform::TxScale )
+	{
+		return false;
+	}
+	
+	// viewport in scaled world pixels. Translation is rounded to whole pixels,
+	// so cached image is always blitted on pixel grid
+	QPoint pan( qRound( t.dx() ), qRound( t.dy() ) );
+	QRect view = t.mapRect( rect ).toAlignedRect().translated( -pan );
+	
+	_hints = painter.renderHints();
+	
+	if ( ! _valid || t.m11() != _scaleX || t.m22() != _scaleY
+		|| _image.size() != view.adjusted( -_margin, -_margin, _margin, _margin ).size() )
+	{
+		// full update
+		_scaleX = t.m11();
+		_scaleY = t.m22();
+		_area = view.adjusted( -_margin, -_margin, _margin, _margin );
+		_image = QImage( _area.size(), QImage::Format_ARGB32_Premultiplied );
+		_spare = QImage();
+		
+		renderArea( _area );
+		_valid = true;
+	}
+	else if ( ! _area.contains( view ) )
+	{
+		// scroll
+		QRect newArea = view.adjusted( -_margin, -_margin, _margin, _margin );
+		if ( _spare.size() != _image.size() )
+		{
+			_spare = QImage( _image.size(), QImage::Format_ARGB32_Premultiplied );
+		}
+		
+		QPainter p( & _spare );
+		p.setCompositionMode( QPainter::CompositionMode_Source );
+		p.fillRect( _spare.rect(), Qt::transparent );
+		p.drawImage( _area.topLeft() - newArea.topLeft(), _image );
+		p.end();
+		
+		QRegion exposed = QRegion( newArea ).subtracted( QRegion( _area ) );
+		qSwap( _image, _spare );
+		_area = newArea;
+		
+		QVector<QRect> rects = exposed.rects();
+		foreach( const QRect& r, rects )
+		{
+			renderArea( r );
+		}
+	}
+	
+	// blit
+	painter.save();
+		painter.resetTransform();
+		painter.drawImage( _area.topLeft() + pan, _image );
+	painter.restore();
+	
+	return true;
+}
+
+// ============================================================================
+/// Re-renders part of the cache. Area is in scaled world pixels.
+void LayerCache::renderArea( const QRect& area )
+{
+	QRect local = area.translated( - _area.topLeft() );
+	
+	QPainter painter( & _image );
+	
+	// clear
+	painter.setCompositionMode( QPainter::CompositionMode_Source );
+	painter.fillRect( local, Qt::transparent );
+	painter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+	
+	painter.setRenderHints( _hints );
+	painter.setClipRect( local );
+	
+	QTransform t( _scaleX, 0, 0, _scaleY, -_area.left(), -_area.top() );
+	painter.setTransform( t );
+	
+	QRectF worldRect = t.inverted().mapRect( QRectF( local ) );
+	QList<WorldObject*> objects = _pWorld->findObjectsToRender( worldRect, World::FilterCached );
+	_pWorld->renderObjects( painter, worldRect, objects );
+}
+
+}
+
+// EOF
+
+
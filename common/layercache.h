@@ -0,0 +1,76 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERLAYERCACHE_H
+#define FLYERLAYERCACHE_H
+
+#include <QImage>
+#include <QRect>
+#include <QPainter>
+
+namespace Flyer
+{
+
+class World;
+
+/**
+	Cached image of static objects from background layer.
+	Image is kept in device pixels, aligned to pixel grid, and covers viewport
+	with some margin. When camera pans outside the margin, old content is scrolled,
+	and only exposed edges are re-rendered. Whole image is re-rendered when scale
+	changes, or when cache is invalidated.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class LayerCache
+{
+public:
+	LayerCache( World* pWorld );
+	~LayerCache();
+	
+	/// Renders cached layer. Returns \b false if cache can't be used with painter's transformation
+	bool render( QPainter& painter, const QRectF& rect );
+	
+	/// Invalidates cache. It will be fully re-rendered next time.
+	void invalidate() { _valid = false; }
+	
+	/// Sets margin around viewport [px]
+	void setMargin( int margin ) { _margin = margin; _valid = false; }
+	
+	/// Returns margin around viewport [px]
+	int margin() const { return _margin; }
+
+private:
+
+	void renderArea( const QRect& area );	///< Renders part of the cache
+	
+	World*	_pWorld;			///< Rendered world
+	QImage	_image;				///< Cached image
+	QImage	_spare;				///< Spare image, used when scrolling
+	QRect	_area;				///< Area covered by image, in scaled world pixels
+	double	_scaleX;			///< Horizontal scale of cached image
+	double	_scaleY;			///< Vertical scale of cached image
+	bool	_valid;				///< If cache contains valid data
+	int		_margin;			///< Margin around viewport [px]
+	QPainter::RenderHints	_hints;	///< Render hints used to render content
+};
+
+}
+
+#endif // FLYERLAYERCACHE_H
+
+// EOF
+
+
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "machine.h"
 #include "system.h"
 #include "body.h"
@@ -24,6 +26,7 @@
 #include "world.h"
 #include "activeattachpoint.h"
 #include "passiveattachpoint.h"
+#include "worldsnapshot.h"
 
 namespace Flyer
 {
@@ -70,15 +73,15 @@ void Machine::render( QPainter& painter, const QRectF& rect, const RenderingOpti
 	
 	// draw systems 
 	
-	foreach( System* pSystem, _systems[ SystemRendered3 ] )
+	foreach( System* pSystem, _systems.value( SystemRendered3 ) )
 	{
 		pSystem->render( painter, rect, options );
 	}
-	foreach( System* pSystem, _systems[ SystemRendered2 ] )
+	foreach( System* pSystem, _systems.value( SystemRendered2 ) )
 	{
 		pSystem->render( painter, rect, options );
 	}
-	foreach( System* pSystem, _systems[ SystemRendered1 ] )
+	foreach( System* pSystem, _systems.value( SystemRendered1 ) )
 	{
 		pSystem->render( painter, rect, options );
 	}
@@ -183,5 +186,86 @@ void Machine::addSystemMessage( const QString& text )
 	_messages.append( Message( text, world()->time(), Message::System ) );
 }
 
+// ============================================================================
+/// Writes state of bodies, systems and attachments to other machines.
+void Machine::saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const
+{
+	QByteArray bodies;
+	QDataStream bodiesStream( & bodies, QIODevice::WriteOnly );
+	PhysicalObject::saveState( bodiesStream, snapshot );
+	stream << bodies;
+	
+	stream << _allSystems.size();
+	foreach( System* pSystem, _allSystems )
+	{
+		QByteArray state;
+		QDataStream systemStream( & state, QIODevice::WriteOnly );
+		pSystem->saveState( systemStream );
+		stream << pSystem->name() << state;
+	}
+	
+	// passive attach points: owner machine id and index of its active point
+	stream << _passiveAttachPoints.size();
+	foreach( PassiveAttachPoint* pPoint, _passiveAttachPoints )
+	{
+		int ownerId = -1;
+		int pointIndex = -1;
+		ActiveAttachPoint* pActive = pPoint->attachedPoint();
+		if ( pActive && pActive->parent() )
+		{
+			ownerId = snapshot.objectId( pActive->parent() );
+			pointIndex = pActive->parent()->activeAttachPoints().indexOf( pActive );
+		}
+		stream << ownerId << pointIndex;
+	}
+}
+
+// ============================================================================
+/// Restores state of bodies, systems and attachments. Machines this one is attached to
+/// should be already restored.
+void Machine::restoreState( QDataStream& stream, const WorldSnapshot& snapshot )
+{
+	QByteArray bodies;
+	stream >> bodies;
+	QDataStream bodiesStream( bodies );
+	PhysicalObject::restoreState( bodiesStream, snapshot );
+	
+	int systems;
+	stream >> systems;
+	for( int i = 0; i < systems; i++ )
+	{
+		QString name;
+		QByteArray state;
+		stream >> name >> state;
+		
+		if ( i < _allSystems.size() && _allSystems[i]->name() == name )
+		{
+			QDataStream systemStream( state );
+			_allSystems[i]->restoreState( systemStream );
+		}
+		else
+		{
+			qWarning("Snapshot of %s doesn't match, system %s not found", qPrintable( this->name() ), qPrintable( name ) );
+		}
+	}
+	
+	int points;
+	stream >> points;
+	for( int i = 0; i < points; i++ )
+	{
+		int ownerId, pointIndex;
+		stream >> ownerId >> pointIndex;
+		
+		Machine* pOwner = dynamic_cast<Machine*>( snapshot.object( ownerId ) );
+		if ( pOwner && i < _passiveAttachPoints.size() && pointIndex >= 0 && pointIndex < pOwner->activeAttachPoints().size() )
+		{
+			ActiveAttachPoint* pActive = pOwner->activeAttachPoints()[ pointIndex ];
+			if ( ! pActive->attached() )
+			{
+				pActive->attach( _passiveAttachPoints[i] );
+			}
+		}
+	}
+}
 
 }
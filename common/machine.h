@@ -80,6 +80,11 @@ public:
 	// messages
 	void addSystemMessage( const QString& );
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
+	
 	const QList<Message>& messages() const { return _messages; }
 
 protected:
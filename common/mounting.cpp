@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "mounting.h"
 #include "joint.h"
 #include "machine.h"
@@ -111,4 +113,18 @@ void Mounting::setJoint( Joint* pJoint )
 	*/
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Mounting::saveState( QDataStream& stream ) const
+{
+	stream << _damageReceived << _broken;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Mounting::restoreState( QDataStream& stream )
+{
+	stream >> _damageReceived >> _broken;
+}
+
 }
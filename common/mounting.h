@@ -46,6 +46,11 @@ public:
 	void setTolerance( double t ) { _tolerance = t; }
 	void setRigid( bool r ) { _rigid = r; }
 	bool rigid() const { return _rigid; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 private:
 
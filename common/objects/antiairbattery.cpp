@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "body.h"
 #include "gun.h"
 #include "ground.h"
@@ -39,6 +41,8 @@ AntiAirBattery::AntiAirBattery ( World* pWorld, double location, double angle  )
 	setLayers( PhysLayerBuildings );
 	setRenderLayer( LayerBuildings );
 	setName("Flak");
+	_location = location;
+	_angle = angle;
 
 	double locationY = world()->ground()->height( location );
 	b2Vec2 basePos( location, locationY );
@@ -77,6 +81,7 @@ AntiAirBattery::AntiAirBattery ( World* pWorld, double location, double angle  )
 	_sysOperator->setDamageCapacity( 100E3 );
 	addSystem( _sysOperator, SystemSimulated );
 	_lastDisplayedAngle = 0.5; // min angle from zenith;
+	_barrelTexture = TextureProvider::loadTexture("installations/flak1-barrel.png");
 	
 	// add systems to damage manager
 	_dmMain->addSystem( _sysGun, 1 );
@@ -99,6 +104,31 @@ void AntiAirBattery::render ( QPainter& painter, const QRectF& rect, const Rende
 	
 	QTransform t = _bodyMain->transform();
 	
+	double sign = _lastDisplayedAngle > 0 ? 1 : -1;
+	
+	// calculate screen angle
+	double screenAngle =  M_PI/2 - _lastDisplayedAngle;
+	
+	painter.save();
+		const QImage& barrel = _barrelTexture.image(Texture::Normal);
+		QPointF textureAxis = QPointF( 13, 8 ); // axis in texture coords
+		
+		double scale = 0.05; // TODO this has to go with texture somehow
+		t.rotateRadians( screenAngle );
+		t.scale( scale * sign, -scale * sign );
+		t.translate( -textureAxis.x(), -textureAxis.y() );
+		painter.setTransform( t, true );
+		painter.drawImage( 0, 0, barrel );
+	painter.restore();
+}
+
+// ============================================================================
+/// Simulates battery. Updates displayed barrel angle, and flips body when barrel
+/// crosses zenith. Done here, not in render(), as rendering may run on multiple threads.
+void AntiAirBattery::simulate( double dt )
+{
+	Machine::simulate( dt );
+	
 	// get angle
 	double currentAngle = _sysOperator->currentAngle();
 	double lastSign = _lastDisplayedAngle > 0 ? 1 : -1;
@@ -120,22 +150,6 @@ void AntiAirBattery::render ( QPainter& painter, const QRectF& rect, const Rende
 		_bodyMain->flip( QPointF( x, 1 ), QPointF( x, -1 ) ); // flip around vertical axis
 	}
 	_lastDisplayedAngle = currentAngle;
-	double sign = currentAngle > 0 ? 1 : -1;
-	
-	// calculate screen angle
-	double screenAngle =  M_PI/2 - currentAngle;
-	
-	painter.save();
-		QImage barrel = TextureProvider::loadTexture("installations/flak1-barrel.png").image(Texture::Normal);
-		QPointF textureAxis = QPointF( 13, 8 ); // axis in texture coords
-		
-		double scale = 0.05; // TODO this has to go with texture somehow
-		t.rotateRadians( screenAngle );
-		t.scale( scale * sign, -scale * sign );
-		t.translate( -textureAxis.x(), -textureAxis.y() );
-		painter.setTransform( t, true );
-		painter.drawImage( 0, 0, barrel );
-	painter.restore();
 }
 
 // ============================================================================
@@ -150,5 +164,11 @@ void  AntiAirBattery::renderOnMap( QPainter& painter, const QRectF&  )
 	painter.drawRect( r );
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void AntiAirBattery::saveParams( QDataStream& stream ) const
+{
+	stream << _location << _angle;
+}
 
 }
@@ -18,6 +18,7 @@
 #define FLYERANTIAIRBATTERY_H
 
 #include "machine.h"
+#include "texture.h"
 
 namespace Flyer
 {
@@ -39,6 +40,12 @@ public:
 
 	virtual void render ( QPainter& painter, const QRectF& rect, const RenderingOptions& options );
 	virtual void renderOnMap( QPainter& painter, const QRectF& rect );
+	virtual void simulate( double dt );
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "AntiAirBattery"; }
+	virtual void saveParams( QDataStream& stream ) const;
 
 private:
 
@@ -49,6 +56,9 @@ private:
 	DamageManager* _dmMain;
 	AntiAirGunOperator* _sysOperator;
 	double _lastDisplayedAngle;
+	double _location;			///< Location [m]
+	double _angle;				///< Gun angle
+	Texture _barrelTexture;		///< Barrel image
 };
 
 }
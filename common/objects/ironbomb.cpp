@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "body.h"
 #include "damagemanager.h"
 #include "controlsurface.h"
@@ -91,5 +93,11 @@ void IronBomb::init( const QPointF& position, double angle )
 	
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void IronBomb::saveParams( QDataStream& stream ) const
+{
+	stream << position() << angle();
+}
 
 }
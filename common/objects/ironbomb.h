@@ -49,6 +49,11 @@ public:
 	
 	void init( const QPointF& position, double angle );
 	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "IronBomb"; }
+	virtual void saveParams( QDataStream& stream ) const;
+
 private:
 
 	// config
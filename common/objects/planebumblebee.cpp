@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "world.h"
 #include "b2dqt.h"
 #include "damagemanager.h"
@@ -437,4 +439,11 @@ void PlaneBumblebee::render( QPainter& painter, const QRectF& rect, const Render
 
 }
 
+// ============================================================================
+/// Writes parameters used to re-create object from snapshot
+void PlaneBumblebee::saveParams( QDataStream& stream ) const
+{
+	stream << position() << angle();
+}
+
 }
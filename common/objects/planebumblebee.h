@@ -40,6 +40,11 @@ public:
 	~PlaneBumblebee();
 
 	virtual void render( QPainter& painter, const QRectF& rect, const RenderingOptions& options );
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "PlaneBumblebee"; }
+	virtual void saveParams( QDataStream& stream ) const;
 
 private:
 
@@ -0,0 +1,368 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <QPainter>
+#include <QDataStream>
+#include <QRadialGradient>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "world.h"
+#include "ground.h"
+#include "common.h"
+
+#include "particlesystem.h"
+
+namespace Flyer
+{
+
+static const double BOUNDING_RECT_MARGIN = 5.0;	///< Margin added to emitter's bounding rect, to not update broadphase each step [m]
+static const int BLOB_SPRITE_SIZE = 64;			///< Size of blob sprite [px]
+static const int RING_SPRITE_SIZE = 256;			///< Size of ring sprite [px]. Bigger, to keep ring thin.
+
+// ============================================================================
+/// Prepares sprite image. Sprites are cached, emitters of the same color share image.
+static QImage createSprite( const QColor& color, ParticleSystem::Sprite type )
+{
+	static QHash< QString, QImage > sprites;
+	static QMutex spritesMutex;
+	
+	QString key = QString("%1-%2").arg( color.rgba() ).arg( int( type ) );
+	
+	QMutexLocker locker( & spritesMutex );
+	if ( sprites.contains( key ) )
+	{
+		return sprites.value( key );
+	}
+	
+	int size = ( type == ParticleSystem::SpriteRing ) ? RING_SPRITE_SIZE : BLOB_SPRITE_SIZE;
+	QImage sprite( size, size, QImage::Format_ARGB32_Premultiplied );
+	sprite.fill( 0 ); // transparent
+	
+	QColor transparent = color;
+	transparent.setAlpha( 0 );
+	
+	QRadialGradient gradient( QPointF( size * 0.5, size * 0.5 ), size * 0.5 );
+	if ( type == ParticleSystem::SpriteRing )
+	{
+		gradient.setColorAt( 0.0, transparent );
+		gradient.setColorAt( 0.96, transparent );
+		gradient.setColorAt( 0.98, color );
+		gradient.setColorAt( 1.0, transparent );
+	}
+	else
+	{
+		gradient.setColorAt( 0.0, color );
+		gradient.setColorAt( 0.7, color );
+		gradient.setColorAt( 1.0, transparent );
+	}
+	
+	QPainter painter( & sprite );
+	painter.fillRect( sprite.rect(), gradient );
+	painter.end();
+	
+	sprites.insert( key, sprite );
+	return sprite;
+}
+
+// ============================================================================
+// Constructor
+ParticleSystem::ParticleSystem( World* pWorld ) : WorldObject( pWorld )
+{
+	_spriteType		= SpriteBlob;
+	_expansion		= 0.0;
+	_maxRadius		= 1E6;
+	_fadeOut		= 1.0f;
+	_inBroadphase	= false;
+	_released		= false;
+	_removed		= false;
+	
+	setColor( Qt::black );
+	setRenderLayer( LayerForeground );
+}
+
+// ============================================================================
+// Destructor
+ParticleSystem::~ParticleSystem()
+{
+}
+
+// ============================================================================
+/// Sets particle color
+void ParticleSystem::setColor( const QColor& color )
+{
+	_color = color;
+	_sprite = createSprite( _color, _spriteType );
+}
+
+// ============================================================================
+/// Sets particle sprite
+void ParticleSystem::setSprite( Sprite sprite )
+{
+	_spriteType = sprite;
+	_sprite = createSprite( _color, _spriteType );
+}
+
+// ============================================================================
+/// Adds particle. Ground height is checked once, here; particle will not fall below it.
+void ParticleSystem::addParticle( const b2Vec2& pos, const b2Vec2& velocity, double radius, double lifespan )
+{
+	_x.append( pos.x );
+	_y.append( pos.y );
+	_vx.append( velocity.x );
+	_vy.append( velocity.y );
+	_floor.append( world()->ground() ? world()->ground()->height( pos.x ) : -1E6 );
+	_radius.append( qMin( radius, _maxRadius ) );
+	_age.append( 0.0f );
+	_invLifespan.append( 1.0 / qMax( lifespan, 1E-3 ) );
+	_alpha.append( 1.0f );
+	
+	if ( ! _boundingRect.contains( QRectF( pos.x - radius, pos.y - radius, radius*2, radius*2 ) ) )
+	{
+		updateBoundingRect();
+	}
+}
+
+// ============================================================================
+/// Moves particles, removes expired. Updates bounding rect. Removes itself, when released and empty.
+void ParticleSystem::simulate( double dt )
+{
+	int n = _x.size();
+	if ( n > 0 )
+	{
+		float fdt			= dt;
+		float expansion		= dt * _expansion;
+		float maxRadius		= _maxRadius;
+		float fadeOut		= _fadeOut;
+		
+		float* x			= _x.data();
+		float* y			= _y.data();
+		const float* vx		= _vx.constData();
+		const float* vy		= _vy.constData();
+		const float* floor	= _floor.constData();
+		float* radius		= _radius.data();
+		float* age			= _age.data();
+		const float* invLifespan	= _invLifespan.constData();
+		float* alpha		= _alpha.data();
+		
+		// no branches, no calls - this loop should be vectorized
+		for( int i = 0; i < n; i++ )
+		{
+			age[i]		+= fdt;
+			x[i]		+= vx[i] * fdt;
+			y[i]		= qMax( y[i] + vy[i] * fdt, floor[i] );
+			radius[i]	= qMin( radius[i] + expansion, maxRadius );
+			alpha[i]	= 1.0f - fadeOut * age[i] * invLifespan[i];
+		}
+		
+		removeDead();
+		updateBoundingRect();
+	}
+	
+	if ( _released && _x.isEmpty() && ! _removed )
+	{
+		_removed = true;
+		world()->removeObject( this );
+	}
+}
+
+// ============================================================================
+/// Removes expired particles. Last particle is moved in place of removed one.
+void ParticleSystem::removeDead()
+{
+	int n = _x.size();
+	int i = 0;
+	while( i < n )
+	{
+		if ( _age[i] * _invLifespan[i] >= 1.0f )
+		{
+			n--;
+			_x[i]			= _x[n];
+			_y[i]			= _y[n];
+			_vx[i]			= _vx[n];
+			_vy[i]			= _vy[n];
+			_floor[i]		= _floor[n];
+			_radius[i]		= _radius[n];
+			_age[i]			= _age[n];
+			_invLifespan[i]	= _invLifespan[n];
+			_alpha[i]		= _alpha[n];
+		}
+		else
+		{
+			i++;
+		}
+	}
+	
+	if ( n < _x.size() )
+	{
+		_x.resize( n );
+		_y.resize( n );
+		_vx.resize( n );
+		_vy.resize( n );
+		_floor.resize( n );
+		_radius.resize( n );
+		_age.resize( n );
+		_invLifespan.resize( n );
+		_alpha.resize( n );
+	}
+}
+
+// ============================================================================
+/// Calculates particles' bounding rect. Broadphase is updated only if particles left
+/// current bounding rect, or it became much bigger than needed.
+void ParticleSystem::updateBoundingRect()
+{
+	int n = _x.size();
+	
+	// no particles - leave broadphase
+	if ( n == 0 )
+	{
+		if ( _inBroadphase )
+		{
+			world()->removeDecoration( this );
+			_inBroadphase = false;
+		}
+		_boundingRect = QRectF();
+		return;
+	}
+	
+	const float* x		= _x.constData();
+	const float* y		= _y.constData();
+	const float* radius	= _radius.constData();
+	
+	float minX = x[0] - radius[0];
+	float maxX = x[0] + radius[0];
+	float minY = y[0] - radius[0];
+	float maxY = y[0] + radius[0];
+	for( int i = 1; i < n; i++ )
+	{
+		minX = qMin( minX, x[i] - radius[i] );
+		maxX = qMax( maxX, x[i] + radius[i] );
+		minY = qMin( minY, y[i] - radius[i] );
+		maxY = qMax( maxY, y[i] + radius[i] );
+	}
+	
+	QRectF tight( minX, minY, maxX - minX, maxY - minY );
+	
+	bool outside = ! _boundingRect.contains( tight );
+	bool tooBig = _boundingRect.width() > tight.width() + 4*BOUNDING_RECT_MARGIN
+		|| _boundingRect.height() > tight.height() + 4*BOUNDING_RECT_MARGIN;
+	
+	if ( ! _inBroadphase || outside || tooBig )
+	{
+		_boundingRect = tight.adjusted( -BOUNDING_RECT_MARGIN, -BOUNDING_RECT_MARGIN, BOUNDING_RECT_MARGIN, BOUNDING_RECT_MARGIN );
+		if ( _inBroadphase )
+		{
+			world()->decorationMoved( this );
+		}
+		else
+		{
+			world()->addDecoration( this );
+			_inBroadphase = true;
+		}
+	}
+}
+
+// ============================================================================
+/// Renders particles. Doesn't modify emitter, may be called from multiple threads.
+void ParticleSystem::render( QPainter& painter, const QRectF& rect, const RenderingOptions& /*options*/ )
+{
+	int n = _x.size();
+	if ( n == 0 )
+	{
+		return;
+	}
+	
+	const float* x		= _x.constData();
+	const float* y		= _y.constData();
+	const float* radius	= _radius.constData();
+	const float* alpha	= _alpha.constData();
+	
+	qreal opacity = painter.opacity();
+	
+	for( int i = 0; i < n; i++ )
+	{
+		float r = radius[i];
+		QRectF target( x[i] - r, y[i] - r, r*2, r*2 );
+		if ( alpha[i] > 0 && target.intersects( rect ) )
+		{
+			painter.setOpacity( opacity * alpha[i] );
+			painter.drawImage( target, _sprite );
+		}
+	}
+	
+	painter.setOpacity( opacity );
+}
+
+// ============================================================================
+/// Writes emitter config.
+void ParticleSystem::saveParams( QDataStream& stream ) const
+{
+	stream << name() << _color << int( _spriteType ) << _expansion << _maxRadius << _fadeOut;
+}
+
+// ============================================================================
+/// Writes particle arrays.
+void ParticleSystem::saveState( QDataStream& stream, const WorldSnapshot& /*snapshot*/ ) const
+{
+	stream << _x << _y << _vx << _vy << _floor << _radius << _age << _invLifespan << _alpha;
+}
+
+// ============================================================================
+/// Restores particles. Owner of the emitter doesn't know restored one,
+/// so emitter is released - it is removed with its last particle.
+void ParticleSystem::restoreState( QDataStream& stream, const WorldSnapshot& /*snapshot*/ )
+{
+	stream >> _x >> _y >> _vx >> _vy >> _floor >> _radius >> _age >> _invLifespan >> _alpha;
+	
+	release();
+	updateBoundingRect();
+}
+
+// ============================================================================
+/// Creates smoke emitter, adds it to the world.
+ParticleSystem* ParticleSystem::createSmoke( World* pWorld )
+{
+	ParticleSystem* pSmoke = new ParticleSystem( pWorld );
+	
+	pSmoke->setColor( QColor( 0, 0, 0, 128 ) );
+	pSmoke->setExpansion( 0.1 );
+	pSmoke->setFadeOut( true );
+	pSmoke->setName( "Smoke" );
+	
+	pWorld->addObject( pSmoke, World::ObjectSimulated );
+	
+	return pSmoke;
+}
+
+// ============================================================================
+/// Adds single smoke puff
+void ParticleSystem::addSmoke( const b2Vec2& pos )
+{
+	double vx = (qrand() % 400)/100.0 - 2; // -2 - +2
+	double vy = (qrand() % 600)/100.0 - 1; // -1 - 5
+	
+	double radius = ( qrand() % 100 ) / 100.0 + 0.5;
+	
+	double lifespan = 1 + (qrand()%40000)/10000.0; // 1-5 s
+	
+	addParticle( pos, b2Vec2( vx, vy ), radius, lifespan );
+}
+
+}
+
+// EOF
@@ -0,0 +1,127 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERPARTICLESYSTEM_H
+#define FLYERPARTICLESYSTEM_H
+
+#include <QVector>
+#include <QImage>
+#include <QColor>
+
+#include "Box2D.h"
+
+#include "worldobject.h"
+
+namespace Flyer
+{
+
+/**
+	Emitter of short-lived, decorational particles: smoke, fire, shockwaves.
+	Particles are kept in separate arrays for each attribute, and updated by simple
+	loops over these arrays, which compiler can vectorize. Emitter is registered in
+	decoration broadphase as single object, covering all it's particles.
+	All particles are drawn using single sprite, prepared once.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class ParticleSystem : public WorldObject
+{
+public:
+
+	/// Particle sprite
+	enum Sprite {
+		SpriteBlob,		///< Soft, round blob
+		SpriteRing		///< Thin ring
+	};
+
+	ParticleSystem( World* pWorld );
+	virtual ~ParticleSystem();
+	
+	virtual void render( QPainter& painter, const QRectF& rect, const RenderingOptions& options );
+	virtual QRectF boundingRect() const { return _boundingRect; }
+	virtual void simulate( double dt );
+	
+	/// Adds new particle
+	void addParticle( const b2Vec2& pos, const b2Vec2& velocity, double radius, double lifespan );
+	
+	/// Returns number of live particles
+	int count() const { return _x.size(); }
+	
+	/// Removes emitter from world when all particles die. Owner should call it instead of deleting emitter.
+	void release() { _released = true; }
+	
+	// properties
+	
+	void setColor( const QColor& color );
+	void setSprite( Sprite sprite );
+	void setExpansion( double e ) { _expansion = e; }			///< Sets radius grow speed [m/s]
+	void setMaxRadius( double r ) { _maxRadius = r; }			///< Sets max particle radius [m]
+	void setFadeOut( bool fade ) { _fadeOut = fade ? 1.0f : 0.0f; }	///< Sets if particles fade out over lifespan
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "ParticleSystem"; }
+	virtual bool transient() const { return true; }
+	virtual void saveParams( QDataStream& stream ) const;
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
+	
+	// predefined emitters
+	
+	/// Creates smoke emitter, adds to world
+	static ParticleSystem* createSmoke( World* pWorld );
+	
+	/// Adds smoke puff with random parameters
+	void addSmoke( const b2Vec2& pos );
+	
+private:
+
+	void updateBoundingRect();		///< Updates bounding rect and broadphase proxy
+	void removeDead();				///< Removes expired particles
+	
+	// config
+	
+	QColor	_color;				///< Particle color
+	Sprite	_spriteType;		///< Sprite type
+	QImage	_sprite;			///< Pre-rendered sprite
+	double	_expansion;			///< Radius grow speed [m/s]
+	double	_maxRadius;			///< Max particle radius [m]
+	float	_fadeOut;			///< 1 if particles fade out, 0 otherwise
+	
+	// particles
+	
+	QVector<float>	_x;			///< Position x [m]
+	QVector<float>	_y;			///< Position y [m]
+	QVector<float>	_vx;		///< Velocity x [m/s]
+	QVector<float>	_vy;		///< Velocity y [m/s]
+	QVector<float>	_floor;		///< Min y, ground height at emission point [m]
+	QVector<float>	_radius;	///< Radius [m]
+	QVector<float>	_age;		///< Age [s]
+	QVector<float>	_invLifespan;	///< 1/lifespan [1/s]
+	QVector<float>	_alpha;		///< Opacity [0-1]
+	
+	// variables
+	
+	QRectF	_boundingRect;		///< Bounding rect, with margin
+	bool	_inBroadphase;		///< If emitter is registered in decoration broadphase
+	bool	_released;			///< If emitter is released by owner
+	bool	_removed;			///< If emitter was removed from the world
+};
+
+}
+
+#endif // FLYERPARTICLESYSTEM_H
+
+// EOF
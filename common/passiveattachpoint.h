@@ -39,6 +39,7 @@ public:
 	// control mnessages from active point
 	
 	void setAttachedPoint( ActiveAttachPoint* p ) { _pAttachedPoint = p; }
+	ActiveAttachPoint* attachedPoint() const { return _pAttachedPoint; }
 	virtual void flip( const QPointF& p1, const QPointF& p2 );
 	virtual bool attached() const { return _pAttachedPoint != NULL; }
 
@@ -14,12 +14,15 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "body.h"
 #include "joint.h"
 #include "b2dqt.h"
 #include "shrapnel.h"
 #include "world.h"
 #include "common.h"
+#include "bodyprovider.h"
 
 #include "physicalobject.h"
 
@@ -49,15 +52,15 @@ void PhysicalObject::render ( QPainter& painter, const QRectF& /*rect*/, const R
 {
 	// draw bodies 
 	
-	foreach( Body* pBody, _bodies[ BodyRendered3 ] )
+	foreach( Body* pBody, _bodies.value( BodyRendered3 ) )
 	{
 		pBody->render( painter, options );
 	}
-	foreach( Body* pBody, _bodies[ BodyRendered2 ] )
+	foreach( Body* pBody, _bodies.value( BodyRendered2 ) )
 	{
 		pBody->render( painter, options );
 	}
-	foreach( Body* pBody, _bodies[ BodyRendered1 ] )
+	foreach( Body* pBody, _bodies.value( BodyRendered1 ) )
 	{
 		pBody->render( painter, options );
 	}
@@ -207,13 +210,14 @@ void PhysicalObject::doBreakJoint( Joint* pJoint )
 	
 	// break joint itself
 	pJoint->breakJoint();
+	updateConnectivity();
 	
 	// check whcih bodies are detached
-	if ( pBody1 && ! pBody1->isConnectedTo( mainBody() ) )
+	if ( pBody1 && ! isAttached( pBody1 ) )
 	{
 		detachBody( pBody1 );
 	}
-	else if ( pBody2 && ! pBody2->isConnectedTo( mainBody() ) )
+	else if ( pBody2 && ! isAttached( pBody2 ) )
 	{
 		detachBody( pBody2 );
 	}
@@ -271,19 +275,148 @@ void PhysicalObject::detachBody( Body* pBody,  CrashEffect effect )
 		}
 		
 		pBody->destroy();
+		world()->objectChanged( this );
 		//qDebug("Body %s detached", qPrintable( pBody->name() ) );
 		
-		// detach connected bodies
+		// find sets of bodies cut off from main body together with this one
+		updateConnectivity();
+		int mainSet = connectivitySet( mainBody() );
+		QList<int> cutSets;
 		foreach( Body* pConnected, connectedBodies )
 		{
-			if ( ! pConnected->isConnectedTo( mainBody() ) )
+			int set = connectivitySet( pConnected );
+			if ( set >= 0 && set != mainSet && ! cutSets.contains( set ) )
+			{
+				cutSets.append( set );
+			}
+		}
+		
+		// detach them, in single pass
+		if ( ! cutSets.isEmpty() )
+		{
+			QList<Body*> cutBodies;
+			foreach( Body* pOther, _allBodies )
+			{
+				if ( cutSets.contains( connectivitySet( pOther ) ) )
+				{
+					cutBodies.append( pOther );
+				}
+			}
+			
+			foreach( Body* pCut, cutBodies )
+			{
+				createShrapnel( pCut );
+				pCut->destroy();
+			}
+			world()->objectChanged( this );
+		}
+	}
+}
+
+// ============================================================================
+/// Rebuilds connectivity of bodies. Each set contains bodies connected to each other
+/// with joints, directly or through other bodies of this object. Bodies without physical
+/// representation are not connected to anything.
+void PhysicalObject::updateConnectivity()
+{
+	const int count = _allBodies.size();
+	_connectivityParents.resize( count );
+	_connectivityRanks.resize( count );
+	_bodyIndices.clear();
+	
+	for( int i = 0; i < count; i++ )
+	{
+		_connectivityParents[i] = i;
+		_connectivityRanks[i] = 0;
+		_bodyIndices.insert( _allBodies[i], i );
+	}
+	
+	for( int i = 0; i < count; i++ )
+	{
+		b2Body* pBody = _allBodies[i]->b2body();
+		if ( ! pBody )
+		{
+			continue;
+		}
+		
+		for( b2JointEdge* pJointEdge = pBody->GetJointList(); pJointEdge; pJointEdge = pJointEdge->next )
+		{
+			const Body* pOther = static_cast<const Body*>( pJointEdge->other->GetUserData() );
+			QHash<const Body*, int>::const_iterator it = _bodyIndices.find( pOther );
+			if ( it != _bodyIndices.end() )
 			{
-				detachBody( pConnected, NoEffect );
+				unite( i, it.value() );
 			}
 		}
 	}
 }
 
+// ============================================================================
+/// Returns id of set of connected bodies which body belongs to, or -1 if body
+/// has no physical representation or doesn't belong to this object.
+int PhysicalObject::connectivitySet( const Body* pBody )
+{
+	if ( ! pBody || ! pBody->b2body() )
+	{
+		return -1;
+	}
+	
+	QHash<const Body*, int>::const_iterator it = _bodyIndices.find( pBody );
+	if ( it == _bodyIndices.end() )
+	{
+		return -1;
+	}
+	
+	return findSet( it.value() );
+}
+
+// ============================================================================
+/// Checks if body is connected to main body. Connectivity has to be up to date.
+bool PhysicalObject::isAttached( const Body* pBody )
+{
+	int set = connectivitySet( pBody );
+	return set >= 0 && set == connectivitySet( mainBody() );
+}
+
+// ============================================================================
+/// Finds representative of body's set. Halves the path on the way.
+int PhysicalObject::findSet( int i )
+{
+	while( _connectivityParents[i] != i )
+	{
+		_connectivityParents[i] = _connectivityParents[ _connectivityParents[i] ];
+		i = _connectivityParents[i];
+	}
+	
+	return i;
+}
+
+// ============================================================================
+/// Merges sets of two bodies, attaching lower-rank tree under higher-rank one.
+void PhysicalObject::unite( int i, int j )
+{
+	int a = findSet( i );
+	int b = findSet( j );
+	if ( a == b )
+	{
+		return;
+	}
+	
+	if ( _connectivityRanks[a] < _connectivityRanks[b] )
+	{
+		_connectivityParents[a] = b;
+	}
+	else if ( _connectivityRanks[a] > _connectivityRanks[b] )
+	{
+		_connectivityParents[b] = a;
+	}
+	else
+	{
+		_connectivityParents[b] = a;
+		_connectivityRanks[a]++;
+	}
+}
+
 // ============================================================================
 /// Creates shrapnell that is almost exact copy of the body.
 void PhysicalObject::createShrapnel( Body* pBody )
@@ -296,60 +429,41 @@ void PhysicalObject::createShrapnel( Body* pBody )
 }
 
 // ============================================================================
-/// Splits body into smaller shrapells.
+/// Splits body into smaller shrapells. Fragments are copied from fracture pattern
+/// precomputed for body's prototype. Bodies not coming from body library are split now.
 void PhysicalObject::createShrapnels( Body* pBody )
 {
 	//qDebug("Creating shrapnels for body %s", qPrintable( pBody->name() ) );
-	QPolygonF bodyShape = pBody->outline();
-	
-	QList<QPolygonF> shrapnelShapes = splitPolygonRandomly( bodyShape );
-	
-	if ( shrapnelShapes.size() < 2 )
+	QList<Body*> fragments;
+	if ( ! BodyProvider::loadFragments( pBody, & fragments ) )
 	{
-		//qDebug("Don't know how to split %s into shrapnels", qPrintable(pBody->name()) );
-		createShrapnel(pBody);
-		return;
-	}
-	// get basic infromation form source body
-	float friction		= pBody->shapes().first().def()->friction;
-	float restitution	= pBody->shapes().first().def()->restitution;
-	float density		= pBody->shapes().first().def()->density;
-	
-	if ( density == 0 )
-	{
-		density = 100; // TODO dome stupid value, calculate it better.
+		QList<QPolygonF> shrapnelShapes = splitPolygonRandomly( pBody->outline() );
+		
+		if ( shrapnelShapes.size() < 2 )
+		{
+			//qDebug("Don't know how to split %s into shrapnels", qPrintable(pBody->name()) );
+			createShrapnel(pBody);
+			return;
+		}
+		
+		fragments = BodyProvider::fragmentBody( pBody, shrapnelShapes );
 	}
 	
 	// ok, create bodies now
-	foreach( const QPolygonF& shape, shrapnelShapes )
+	foreach( Body* pFragment, fragments )
 	{
-		double area = convexPolygonArea( shape );
-		if ( area < 1E-4 )
-		{
-			//qDebug("Shrapnell rejected: to small (area: %g)", area );
-		}
-		else
-		{
-			//qDebug("Shrapnell area accepted (%g), proceeding with creation.", area );
-			
-			QPointF center = shape.boundingRect().center();
-			Shrapnel*	pShrapnel = new Shrapnel( world() );
-			Body* pSrapnellBody = new Body("shrapnell");
-			
-			pSrapnellBody->setTexture( pBody->texture() );
-			pSrapnellBody->setLimitTextureToShape( true );
-			pSrapnellBody->setPosition( pBody->position() ); // TODO translate to shape center, also: translate shape
-			pSrapnellBody->setAngle( pBody->angle() );
-			pSrapnellBody->setLayers( pBody->layers() );
-			pSrapnellBody->setShape( shape, friction, restitution, density );
-			pSrapnellBody->create( world() );
-			// TODO it'd time to add velocities to body interface
-			pSrapnellBody->b2body()->SetLinearVelocity( pBody->velocity() );
-			pSrapnellBody->b2body()->SetAngularVelocity( pBody->angularVelocity() );
-			
-			pShrapnel->addBody( pSrapnellBody );
-			world()->addObject( pShrapnel, World::ObjectSimulated );
-		}
+		Shrapnel*	pShrapnel = new Shrapnel( world() );
+		
+		pFragment->setPosition( pBody->position() ); // TODO translate to shape center, also: translate shape
+		pFragment->setAngle( pBody->angle() );
+		pFragment->setLayers( pBody->layers() );
+		pFragment->create( world() );
+		// TODO it'd time to add velocities to body interface
+		pFragment->b2body()->SetLinearVelocity( pBody->velocity() );
+		pFragment->b2body()->SetAngularVelocity( pBody->angularVelocity() );
+		
+		pShrapnel->addBody( pFragment );
+		world()->addObject( pShrapnel, World::ObjectSimulated );
 	}
 }
 
@@ -421,6 +535,65 @@ void PhysicalObject::bodySleeps( Body* pBody )
 	}
 }
 
+// ============================================================================
+/// Writes orientation and state of all bodies, including bodies already detached.
+void PhysicalObject::saveState( QDataStream& stream, const WorldSnapshot& /*snapshot*/ ) const
+{
+	stream << _orientation << _allBodies.size();
+	foreach( Body* pBody, _allBodies )
+	{
+		bool attached = pBody->b2body() != NULL;
+		stream << pBody->name() << attached;
+		if ( attached )
+		{
+			pBody->saveState( stream );
+		}
+	}
+}
+
+// ============================================================================
+/// Restores orientation and bodies. Bodies are expected in the same order as
+/// when object was saved - object is re-created the same way. Bodies detached
+/// at the time snapshot was taken are destroyed, without leaving shrapnels
+/// (shrapnels are stored in snapshot as separate objects).
+void PhysicalObject::restoreState( QDataStream& stream, const WorldSnapshot& /*snapshot*/ )
+{
+	double orientation;
+	int count;
+	stream >> orientation >> count;
+	
+	if ( orientation != _orientation )
+	{
+		// any horizontal axis will do, body transforms are restored below
+		QPointF p = position();
+		flip( p, p + QPointF( 1.0, 0.0 ) );
+	}
+	
+	for( int i = 0; i < count; i++ )
+	{
+		QString name;
+		bool attached;
+		stream >> name >> attached;
+		
+		Body* pBody = i < _allBodies.size() ? _allBodies[i] : NULL;
+		if ( ! pBody || pBody->name() != name )
+		{
+			qWarning("Snapshot of %s doesn't match, body %s not found", qPrintable( this->name() ), qPrintable( name ) );
+			return;
+		}
+		
+		if ( attached )
+		{
+			pBody->restoreState( stream );
+		}
+		else if ( pBody->b2body() )
+		{
+			pBody->destroy();
+			world()->objectChanged( this );
+		}
+	}
+}
+
 }
 
 // EOF
@@ -22,6 +22,8 @@ class QPainter;
 #include <QList>
 #include <QLinkedList>
 #include <QPair>
+#include <QHash>
+#include <QVector>
 #include <QPointF>
 
 #include "Box2D.h"
@@ -94,6 +96,7 @@ public:
 		
 	void addBody( Body* pBody, int types );
 	void removeBody( Body* pBody );
+	const QList<Body*>& bodies() const { return _allBodies; }	///< Returns all bodies
 	
 	void setMainBody( Body* pBody ) { _pMainBody = pBody; }
 	Body* mainBody() const { return _pMainBody; }
@@ -106,6 +109,11 @@ public:
 	// joints
 	void addJoint( Joint* pJoint );
 	void removeJoint( Joint* pJoint );
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
 
 	
 private:
@@ -119,6 +127,13 @@ private:
 	/// Creates multiple shrapnlls from body fragments
 	void createShrapnels( Body* pBody );
 	
+	// connectivity
+	void updateConnectivity();					///< Rebuilds sets of bodies connected with joints
+	int connectivitySet( const Body* pBody );	///< Returns set of connected bodies body belongs to
+	bool isAttached( const Body* pBody );		///< Checks if body is connected to main body
+	int findSet( int i );						///< Union-find: finds set representative
+	void unite( int i, int j );					///< Union-find: merges sets
+	
 	// bodies
 	QMap<int, QList<Body*> > _bodies;
 	QList<Body*>	_allBodies;
@@ -131,6 +146,11 @@ private:
 	/// the body destroys the object.
 	Body* _pMainBody;
 	
+	// connectivity - union-find forest over _allBodies
+	QHash<const Body*, int>	_bodyIndices;		///< Index of body in connectivity forest
+	QVector<int>	_connectivityParents;		///< Parent of each body in the forest
+	QVector<int>	_connectivityRanks;			///< Rank of each set
+	
 	// joints
 	QList<Joint*>	_allJoints;
 	QLinkedList<Joint*>	_jointsToBreak; ///< Temporary list of joints that are to be break during next sim step
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "pilot.h"
 
 namespace Flyer
@@ -61,4 +63,18 @@ void Pilot::repair()
 	_health = 1.0;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Pilot::saveState( QDataStream& stream ) const
+{
+	stream << _health;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Pilot::restoreState( QDataStream& stream )
+{
+	stream >> _health;
+}
+
 }
@@ -39,6 +39,11 @@ public:
 	virtual void destroy();
 	virtual void repair();
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
+
 private:
 
 	double _health;			///< Pilot's health: 0-1
@@ -0,0 +1,275 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <QPainter>
+#include <QDataStream>
+
+#include "b2dqt.h"
+#include "world.h"
+#include "common.h"
+#include "body.h"
+#include "simulationscheduler.h"
+
+#include "projectilesystem.h"
+
+namespace Flyer
+{
+
+static const double MINIMAL_MOMENTUM	= 1.0;		///< Below this momentum round is removed
+static const double DAMAGE_MULTIPLIER	= 10;		///< Damage multiplier, same as Bullet's
+static const double DRAG				= 0.001;	///< Linear air drag [1/s], same as Bullet's damping
+static const double RESTITUTION			= 0.1;		///< Bounciness used to calculate hit impulse
+static const double TAIL_TIMESPAN		= 0.05;		///< Flame tail lifespan [s]
+static const int	LAYERS				= PhysLayerVehicles | PhysLayerBuildings;	///< Layers hit by rounds
+static const int	MAX_SHAPES			= 64;		///< Max shapes found along single step of a round
+
+// ============================================================================
+// Constructor
+ProjectileSystem::ProjectileSystem( World* pWorld ) : _pWorld( pWorld )
+{
+	Q_ASSERT( pWorld );
+	_shapes.resize( MAX_SHAPES );
+}
+
+// ============================================================================
+// Destructor
+ProjectileSystem::~ProjectileSystem()
+{
+}
+
+// ============================================================================
+/// Fires round from point with velocity.
+void ProjectileSystem::fire( const QPointF& point, const QPointF& velocity, double mass, double lifespan )
+{
+	_positions.append( point2vec( point ) );
+	_velocities.append( point2vec( velocity ) );
+	_masses.append( mass );
+	_ages.append( 0.0 );
+	_lifespans.append( lifespan );
+}
+
+// ============================================================================
+/// Removes all rounds.
+void ProjectileSystem::clear()
+{
+	_positions.clear();
+	_velocities.clear();
+	_masses.clear();
+	_ages.clear();
+	_lifespans.clear();
+}
+
+// ============================================================================
+/// Writes all rounds, for world snapshot.
+void ProjectileSystem::saveState( QDataStream& stream ) const
+{
+	stream << _positions.size();
+	for( int i = 0; i < _positions.size(); i++ )
+	{
+		stream << double( _positions[i].x ) << double( _positions[i].y );
+		stream << double( _velocities[i].x ) << double( _velocities[i].y );
+		stream << _masses[i] << _ages[i] << _lifespans[i];
+	}
+}
+
+// ============================================================================
+/// Removes current rounds and reads rounds written by saveState().
+void ProjectileSystem::restoreState( QDataStream& stream )
+{
+	clear();
+	
+	int count;
+	stream >> count;
+	for( int i = 0; i < count; i++ )
+	{
+		double x, y, vx, vy, mass, age, lifespan;
+		stream >> x >> y >> vx >> vy >> mass >> age >> lifespan;
+		
+		_positions.append( b2Vec2( x, y ) );
+		_velocities.append( b2Vec2( vx, vy ) );
+		_masses.append( mass );
+		_ages.append( age );
+		_lifespans.append( lifespan );
+	}
+}
+
+// ============================================================================
+/// Integrates rounds' motion, and tests path of each round during the step
+/// against world's shapes. Rounds which hit something, are too old or too slow are removed.
+void ProjectileSystem::simulate( double dt )
+{
+	b2Vec2 gravity( 0.0, -9.81 * dt );
+	double drag = qMax( 0.0, 1.0 - DRAG * dt );
+	
+	int i = 0;
+	while( i < _positions.size() )
+	{
+		_ages[i] += dt;
+		
+		b2Vec2& velocity = _velocities[i];
+		velocity += gravity;
+		velocity *= drag;
+		
+		if ( _ages[i] > _lifespans[i] || velocity.Length() * _masses[i] < MINIMAL_MOMENTUM )
+		{
+			remove( i );
+			continue;
+		}
+		
+		b2Vec2 from = _positions[i];
+		b2Vec2 to = from + dt * velocity;
+		
+		if ( hit( i, from, to ) )
+		{
+			remove( i );
+			continue;
+		}
+		
+		_positions[i] = to;
+		i++;
+	}
+}
+
+// ============================================================================
+/// Tests round's path from \b from to \b to. If round hits a shape, applies impulse
+/// to the body and reports contact force. Returns true if round hit something.
+bool ProjectileSystem::hit( int i, const b2Vec2& from, const b2Vec2& to )
+{
+	b2AABB aabb;
+	aabb.lowerBound = b2Min( from, to );
+	aabb.upperBound = b2Max( from, to );
+	
+	int found = _pWorld->b2world()->Query( aabb, _shapes.data(), MAX_SHAPES );
+	if ( found == 0 )
+	{
+		return false;
+	}
+	
+	b2Segment segment;
+	segment.p1 = from;
+	segment.p2 = to;
+	
+	// find closest hit
+	b2Shape* pHitShape = NULL;
+	float32 hitLambda = 1.0f;
+	b2Vec2 hitNormal;
+	for( int s = 0; s < qMin( found, MAX_SHAPES ); s++ )
+	{
+		b2Shape* pShape = _shapes[s];
+		if ( pShape->IsSensor() || ! ( pShape->GetFilterData().categoryBits & LAYERS ) )
+		{
+			continue;
+		}
+		
+		float32 lambda;
+		b2Vec2 normal;
+		if ( pShape->TestSegment( pShape->GetBody()->GetXForm(), & lambda, & normal, segment, hitLambda ) )
+		{
+			pHitShape = pShape;
+			hitLambda = lambda;
+			hitNormal = normal;
+		}
+	}
+	
+	if ( ! pHitShape )
+	{
+		return false;
+	}
+	
+	b2Body* pb2Body = pHitShape->GetBody();
+	b2Vec2 point = from + hitLambda * ( to - from );
+	
+	// impulse along normal, as contact solver would calculate it
+	b2Vec2 relativeVelocity = _velocities[i] - pb2Body->GetLinearVelocityFromWorldPoint( point );
+	double normalImpulse = - _masses[i] * ( 1.0 + RESTITUTION ) * b2Dot( relativeVelocity, hitNormal );
+	if ( normalImpulse <= 0.0 )
+	{
+		return false; // moving away
+	}
+	
+	Body* pBody = static_cast<Body*>( pb2Body->GetUserData() );
+	if ( ! pb2Body->IsStatic() )
+	{
+		pb2Body->ApplyImpulse( float32( - normalImpulse ) * hitNormal, point );
+		if ( pBody )
+		{
+			_pWorld->scheduler()->release( pBody ); // keep the push if body is held
+		}
+	}
+	
+	if ( pBody )
+	{
+		pBody->contact( DAMAGE_MULTIPLIER * normalImpulse / _pWorld->timestep() );
+	}
+	
+	return true;
+}
+
+// ============================================================================
+/// Removes round. Last round is moved in its place, so order of rounds is not preserved.
+void ProjectileSystem::remove( int i )
+{
+	int last = _positions.size() - 1;
+	if ( i != last )
+	{
+		_positions[i] = _positions[last];
+		_velocities[i] = _velocities[last];
+		_masses[i] = _masses[last];
+		_ages[i] = _ages[last];
+		_lifespans[i] = _lifespans[last];
+	}
+	
+	_positions.resize( last );
+	_velocities.resize( last );
+	_masses.resize( last );
+	_ages.resize( last );
+	_lifespans.resize( last );
+}
+
+// ============================================================================
+/// Renders tracers of rounds in rect.
+void ProjectileSystem::render( QPainter& painter, const QRectF& rect )
+{
+	painter.save();
+	
+	for( int i = 0; i < _positions.size(); i++ )
+	{
+		QPointF pos = vec2point( _positions[i] );
+		QPointF tail = vec2point( _positions[i] + TAIL_TIMESPAN * _velocities[i] );
+		if ( ! rect.contains( pos ) && ! rect.contains( tail ) )
+		{
+			continue;
+		}
+		
+		// flicker, w/o touching simulation's random number sequence
+		if ( ( i + int( _ages[i] / TAIL_TIMESPAN ) ) % 2 == 0 )
+		{
+			painter.setPen( Qt::red );
+		}
+		else
+		{
+			painter.setPen( QColor( 255, 128, 0 ) );
+		}
+		painter.drawLine( pos, tail );
+	}
+	
+	painter.restore();
+}
+
+}
+
+// EOF
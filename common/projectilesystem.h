@@ -0,0 +1,82 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERPROJECTILESYSTEM_H
+#define FLYERPROJECTILESYSTEM_H
+
+#include <QVector>
+#include <QPointF>
+
+#include "Box2D.h"
+
+class QPainter;
+class QRectF;
+class QDataStream;
+
+namespace Flyer
+{
+
+class World;
+
+/**
+	Lightweight ballistics for gun rounds. Rounds are not physical objects - they are kept
+	in flat arrays, integrated with gravity and air drag each simulation step, and their paths
+	are tested against world's shapes with segment tests. Round hitting a body applies
+	impulse to it, and reports contact force with bullet's damage multiplier, just like full-body
+	Bullet colliding with the body would.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class ProjectileSystem
+{
+public:
+	ProjectileSystem( World* pWorld );
+	~ProjectileSystem();
+	
+	/// Fires round from point, with velocity
+	void fire( const QPointF& point, const QPointF& velocity, double mass, double lifespan );
+	
+	void simulate( double dt );								///< Moves rounds and resolves hits
+	void render( QPainter& painter, const QRectF& rect );	///< Renders tracers
+	void clear();											///< Removes all rounds
+	
+	void saveState( QDataStream& stream ) const;			///< Writes rounds in flight
+	void restoreState( QDataStream& stream );				///< Replaces rounds with ones written by saveState()
+	
+	int count() const { return _positions.size(); }			///< Number of rounds in flight
+
+private:
+	
+	void remove( int i );		///< Removes round, moving the last one in its place
+	bool hit( int i, const b2Vec2& from, const b2Vec2& to );	///< Tests round path, handles hit
+	
+	World*	_pWorld;				///< World
+	
+	// rounds
+	QVector<b2Vec2>	_positions;		///< Positions [m]
+	QVector<b2Vec2>	_velocities;	///< Velocities [m/s]
+	QVector<double>	_masses;		///< Masses [kg]
+	QVector<double>	_ages;			///< Time since fired [s]
+	QVector<double>	_lifespans;		///< Lifespans [s]
+	
+	QVector<b2Shape*>	_shapes;	///< Buffer for broadphase queries
+};
+
+}
+
+#endif // FLYERPROJECTILESYSTEM_H
+
+// EOF
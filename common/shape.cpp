@@ -27,19 +27,15 @@ namespace Flyer
 // Constructor
 Shape::Shape( b2ShapeDef* pDef ) : Serializable()
 {
-	_pDef = NULL;
+	_d = new ShapeDef( ShapeDef::copyDef( pDef ) );
 	_pShape = NULL;
-	if ( pDef )
-	{
-		_pDef = createDefCopy( pDef );
-	}
 }
 
 // ============================================================================
-// Copy constructor
+// Copy constructor. Definition is shared, not copied.
 Shape::Shape( const Shape& src ) : Serializable( src )
 {
-	_pDef = createDefCopy( src._pDef );
+	_d = src._d;
 	_name = src._name;
 	_pShape = NULL; // TODO created object not copied
 }
@@ -49,24 +45,23 @@ Shape::Shape( const Shape& src ) : Serializable( src )
 // Destructor
 Shape::~Shape()
 {
-	if ( _pDef ) delete _pDef;
 }
 
 // ============================================================================
 /// Creates copy of shape definition. Caller owns created object.
-b2ShapeDef* Shape::createDefCopy( b2ShapeDef* pShapeDef )
+b2ShapeDef* ShapeDef::copyDef( const b2ShapeDef* pShapeDef )
 {
 	if ( ! pShapeDef ) return NULL;
 	
 	// copy shape
 	if ( pShapeDef->type == e_polygonShape )
 	{
-		b2PolygonDef* pPolygonDef = new b2PolygonDef( * ((b2PolygonDef*)pShapeDef) );
+		b2PolygonDef* pPolygonDef = new b2PolygonDef( * ((const b2PolygonDef*)pShapeDef) );
 		return pPolygonDef;
 	}
 	else if ( pShapeDef->type == e_circleShape )
 	{
-		b2CircleDef* pCircleDef = new b2CircleDef( * ((b2CircleDef*)pShapeDef ) );
+		b2CircleDef* pCircleDef = new b2CircleDef( * ((const b2CircleDef*)pShapeDef ) );
 		return pCircleDef;
 	}
 	
@@ -78,10 +73,12 @@ b2ShapeDef* Shape::createDefCopy( b2ShapeDef* pShapeDef )
 /// Flips shape upside-down along the X axis
 void Shape::flip()
 {
+	b2ShapeDef* pDef = def(); // detach
+	
 	// polygon
-	if ( _pDef->type == e_polygonShape )
+	if ( pDef->type == e_polygonShape )
 	{
-		b2PolygonDef* pPoygonDef = (b2PolygonDef*)_pDef;
+		b2PolygonDef* pPoygonDef = (b2PolygonDef*)pDef;
 		
 		// copy vertices to buffer
 		b2Vec2 buffer[ b2_maxPolygonVertices ];
@@ -98,9 +95,9 @@ void Shape::flip()
 		}
 	}
 	// circle
-	else if ( _pDef->type == e_circleShape )
+	else if ( pDef->type == e_circleShape )
 	{
-		b2CircleDef* pCircleDef = (b2CircleDef*)_pDef;
+		b2CircleDef* pCircleDef = (b2CircleDef*)pDef;
 		
 		pCircleDef->localPosition.y = - pCircleDef->localPosition.y;
 	}
@@ -110,18 +107,19 @@ void Shape::flip()
 /// Saves to stream.
 void Shape::toStream( QDataStream& stream ) const
 {
-	if ( _pDef )
+	const b2ShapeDef* pDef = def();
+	if ( pDef )
 	{
 		// common part
-		stream << _pDef->type;
-		stream << _pDef->restitution;
-		stream << _pDef->isSensor;
-		stream << _pDef->friction;
-		stream << _pDef->density;
+		stream << pDef->type;
+		stream << pDef->restitution;
+		stream << pDef->isSensor;
+		stream << pDef->friction;
+		stream << pDef->density;
 		// polygon
-		if ( _pDef->type == e_polygonShape )
+		if ( pDef->type == e_polygonShape )
 		{
-			b2PolygonDef* pPolygonDef = (b2PolygonDef*)_pDef;
+			const b2PolygonDef* pPolygonDef = (const b2PolygonDef*)pDef;
 			stream << int( pPolygonDef->vertexCount );
 			for( int i = 0; i < pPolygonDef->vertexCount; i++ )
 			{
@@ -130,9 +128,9 @@ void Shape::toStream( QDataStream& stream ) const
 			}
 		}
 		// circle
-		else if ( _pDef->type == e_circleShape )
+		else if ( pDef->type == e_circleShape )
 		{
-			b2CircleDef* pCircleDef = (b2CircleDef*)_pDef;
+			const b2CircleDef* pCircleDef = (const b2CircleDef*)pDef;
 			stream << pCircleDef->localPosition.x;
 			stream << pCircleDef->localPosition.y;
 			stream << pCircleDef->radius;
@@ -150,39 +148,36 @@ void Shape::toStream( QDataStream& stream ) const
 /// Loads from stream
 void Shape::fromStream( QDataStream& stream )
 {
-	// delete current definition
-	if ( _pDef )
-	{
-		delete _pDef;
-		_pDef = NULL;
-	}
-	
 	// read type
 	int type;
 	stream >> type;
+	b2ShapeDef* pDef = NULL;
 	if ( type == e_polygonShape )
 	{
-		_pDef = new b2PolygonDef();
+		pDef = new b2PolygonDef();
 	}
 	else if ( type == e_circleShape )
 	{
-		_pDef = new b2CircleDef();
+		pDef = new b2CircleDef();
 	}
 	else
 	{
 		throw GDatasetError("Shape::fromStream: Unknown shape type");
 	}
 	
+	// replace current definition, don't touch copies sharing it
+	_d = new ShapeDef( pDef );
+	
 	// common part
-	stream >> _pDef->restitution;
-	stream >> _pDef->isSensor;
-	stream >> _pDef->friction;
-	stream >> _pDef->density;
+	stream >> pDef->restitution;
+	stream >> pDef->isSensor;
+	stream >> pDef->friction;
+	stream >> pDef->density;
 	
 	// polygon
-	if ( _pDef->type == e_polygonShape )
+	if ( pDef->type == e_polygonShape )
 	{
-		b2PolygonDef* pPolygonDef = (b2PolygonDef*)_pDef;
+		b2PolygonDef* pPolygonDef = (b2PolygonDef*)pDef;
 		stream >> (int&) pPolygonDef->vertexCount;
 		for( int i = 0; i < pPolygonDef->vertexCount; i++ )
 		{
@@ -193,7 +188,7 @@ void Shape::fromStream( QDataStream& stream )
 	// circle
 	else
 	{
-		b2CircleDef* pCircleDef = (b2CircleDef*)_pDef;
+		b2CircleDef* pCircleDef = (b2CircleDef*)pDef;
 		stream >> pCircleDef->localPosition.x;
 		stream >> pCircleDef->localPosition.y;
 		stream >> pCircleDef->radius;
@@ -205,12 +200,35 @@ void Shape::fromStream( QDataStream& stream )
 
 // ============================================================================
 /// Creates b2d shape object using body as context.
+/// Shared definition is not modified - user data and body's collision layers
+/// are set on temporary copy.
 void Shape::create( Body* pBody )
 {
 	Q_ASSERT( pBody );
 	Q_ASSERT( pBody->b2body() );
-	_pDef->userData = this;
-	_pShape = pBody->b2body()->CreateShape( _pDef );
+	
+	const b2ShapeDef* pDef = def();
+	Q_ASSERT( pDef );
+	
+	b2PolygonDef polygonDef;
+	b2CircleDef circleDef;
+	b2ShapeDef* pInstanceDef = NULL;
+	if ( pDef->type == e_polygonShape )
+	{
+		polygonDef = *( (const b2PolygonDef*)pDef );
+		pInstanceDef = & polygonDef;
+	}
+	else
+	{
+		circleDef = *( (const b2CircleDef*)pDef );
+		pInstanceDef = & circleDef;
+	}
+	
+	pInstanceDef->userData = this;
+	pInstanceDef->filter.categoryBits = pBody->layers(); // layer 0 collides with nothing
+	pInstanceDef->filter.maskBits = pBody->layers();
+	
+	_pShape = pBody->b2body()->CreateShape( pInstanceDef );
 }
 
 // ============================================================================
@@ -218,12 +236,12 @@ void Shape::create( Body* pBody )
 /// Approximated with 8-gons.
 QPolygonF Shape::outline() const
 {
-	Q_ASSERT( _pDef );
+	Q_ASSERT( def() );
 	
 	
-	if ( _pDef->type == e_polygonShape )
+	if ( def()->type == e_polygonShape )
 	{
-		b2PolygonDef* pDef = static_cast< b2PolygonDef* >( _pDef );
+		const b2PolygonDef* pDef = static_cast< const b2PolygonDef* >( def() );
 		
 		QPolygonF result( pDef->vertexCount );
 		for( int i = 0; i < pDef->vertexCount; i++ )
@@ -235,7 +253,7 @@ QPolygonF Shape::outline() const
 	}
 	else
 	{
-		b2CircleDef* pDef = static_cast< b2CircleDef* >( _pDef );
+		const b2CircleDef* pDef = static_cast< const b2CircleDef* >( def() );
 		
 		QPolygonF result( 8 );
 		for( int i =0 ; i< 8 ; i++ )
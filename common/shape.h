@@ -18,7 +18,8 @@
 #define FLYERSHAPE_H
 
 #include <QPolygonF>
-
+#include <QSharedData>
+#include <QSharedDataPointer>
 
 #include "Box2D.h"
 
@@ -31,7 +32,24 @@ class DamageManager;
 class Body;
 
 /**
-	Wrapper around b2 shape definition.
+	Shape definition, shared by copies of shape until one of them modifies it.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class ShapeDef : public QSharedData
+{
+public:
+	ShapeDef( b2ShapeDef* pShapeDef = NULL ) : pDef( pShapeDef ) {}
+	ShapeDef( const ShapeDef& src ) : QSharedData( src ), pDef( copyDef( src.pDef ) ) {}
+	~ShapeDef() { delete pDef; }
+	
+	/// Creates copy of shape definition. Caller owns created object.
+	static b2ShapeDef* copyDef( const b2ShapeDef* pDef );
+	
+	b2ShapeDef*	pDef;	///< B2 shape definition [owned]
+};
+
+/**
+	Wrapper around b2 shape definition. Definition is implicitly shared between copies.
 	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
 class Shape : public Serializable
@@ -43,7 +61,10 @@ public:
 	virtual ~Shape();
 	
 	/// Returns associated definition	
-	b2ShapeDef* def() const{ return _pDef; }
+	const b2ShapeDef* def() const{ return _d->pDef; }
+	
+	/// Returns associated definition for modification. Detaches shared definition.
+	b2ShapeDef* def() { return _d->pDef; }
 	
 	/// Creates shape
 	void create( Body* pBody );
@@ -74,9 +95,7 @@ protected:
 
 private:
 
-	static b2ShapeDef* createDefCopy( b2ShapeDef* );
-
-	b2ShapeDef*	_pDef;		///< B2 shape definition
+	QSharedDataPointer<ShapeDef>	_d;		///< B2 shape definition
 	QString		_name;		///< Name
 	b2Shape*	_pShape;	///< B2D object
 };
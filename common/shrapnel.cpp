@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "body.h"
 #include "world.h"
 #include "common.h"
@@ -61,4 +63,32 @@ void Shrapnel::addBody( Body* pBody )
 	}
 }
 
+// ============================================================================
+/// Writes lifespan, layers and bodies. Bodies are written with their shapes, shrapnel
+/// is not re-created from library like machines are.
+void Shrapnel::saveParams( QDataStream& stream ) const
+{
+	stream << _lifespan << layers() << bodies().size();
+	foreach( Body* pBody, bodies() )
+	{
+		pBody->saveParams( stream );
+	}
+}
+
+// ============================================================================
+/// Writes bodies' state and age.
+void Shrapnel::saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const
+{
+	PhysicalObject::saveState( stream, snapshot );
+	stream << _age;
+}
+
+// ============================================================================
+/// Restores bodies' state and age.
+void Shrapnel::restoreState( QDataStream& stream, const WorldSnapshot& snapshot )
+{
+	PhysicalObject::restoreState( stream, snapshot );
+	stream >> _age;
+}
+
 }
@@ -43,6 +43,14 @@ public:
 	
 	void setLifespan( double l ) { _lifespan = l; }
 	void addBody( Body* pBody );
+	
+	// snapshots
+	
+	virtual QString snapshotClass() const { return "Shrapnel"; }
+	virtual bool transient() const { return true; }
+	virtual void saveParams( QDataStream& stream ) const;
+	virtual void saveState( QDataStream& stream, const WorldSnapshot& snapshot ) const;
+	virtual void restoreState( QDataStream& stream, const WorldSnapshot& snapshot );
 
 private:
 
@@ -0,0 +1,333 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <math.h>
+
+#include <QtAlgorithms>
+
+#include "world.h"
+#include "plane.h"
+#include "body.h"
+#include "b2dqt.h"
+
+#include "simulationscheduler.h"
+
+namespace Flyer
+{
+
+static const double LOD_DISTANCES[] = { 2000, 6000 };	///< Max distance from viewer of near and mid bucket [m]
+static const int LOD_INTERVALS[] = { 1, 4, 16 };		///< Simulation interval of each bucket [steps]
+static const double LOD_HYSTERESIS = 200;	///< Distance inside bucket required to promote object to it [m]
+static const double GRAVITY = -9.81;		///< World's gravity [m/s^2]
+
+// ============================================================================
+// Constructor
+SimulationScheduler::SimulationScheduler( World* pWorld ) : _pWorld( pWorld )
+{
+	Q_ASSERT( pWorld );
+	_enabled = true;
+	_steps = 0;
+	_objectsAdded = 0;
+}
+
+// ============================================================================
+// Destructor
+SimulationScheduler::~SimulationScheduler()
+{
+}
+
+// ============================================================================
+/// Enables or disables LOD. Objects are promoted to full simulation during next step.
+void SimulationScheduler::setEnabled( bool enabled )
+{
+	_enabled = enabled;
+}
+
+// ============================================================================
+/// Sets velocities of bodies in kinematic mode to held ones. Gravity is compensated,
+/// so after physics step integrates it, bodies move with held velocity. Objects simulated
+/// before this step, and bodies with contacts, are left to the physics engine.
+void SimulationScheduler::prepareStep( double dt )
+{
+	b2Vec2 gravityCompensation( 0.0, - GRAVITY * dt );
+	
+	QHash<WorldObject*, State>::iterator it;
+	for( it = _states.begin(); it != _states.end(); ++it )
+	{
+		const State& state = it.value();
+		if ( state.extrapolation > 0 )
+		{
+			continue; // step integrates forces registered by object
+		}
+		for( int i = 0; i < state.held.size(); i++ )
+		{
+			b2Body* pb2Body = state.held[i].pBody->b2body();
+			if ( pb2Body && ! pb2Body->IsSleeping() && ! state.held[i].released )
+			{
+				pb2Body->SetLinearVelocity( state.held[i].linear + gravityCompensation );
+				pb2Body->SetAngularVelocity( state.held[i].angular );
+			}
+		}
+	}
+}
+
+// ============================================================================
+/// Simulates simulated objects of the world. Near objects are simulated each step,
+/// farther ones every few steps, with time accumulated since their last simulation.
+/// @param touching bodies which had contacts during last step, sorted
+void SimulationScheduler::simulate( double dt, const QVector<Body*>& touching )
+{
+	_steps++;
+	
+	QList<QPointF> viewers;
+	if ( _enabled )
+	{
+		viewers = _viewers;
+		Plane* pPlane = _pWorld->playerPlane();
+		if ( pPlane )
+		{
+			viewers.append( pPlane->position() );
+		}
+	}
+	
+	QList<WorldObject*> objects = _pWorld->_objects[ World::ObjectSimulated ];
+	foreach( WorldObject* pObject, objects )
+	{
+		// removed by previously simulated object?
+		int objectClass = _pWorld->objectClass( pObject );
+		if ( ! ( objectClass & World::ObjectSimulated ) )
+		{
+			continue;
+		}
+		
+		QHash<WorldObject*, State>::iterator it = _states.find( pObject );
+		if ( it == _states.end() )
+		{
+			State state;
+			state.pPhysical = dynamic_cast<PhysicalObject*>( pObject );
+			state.kinematic = state.pPhysical && ( objectClass & World::ObjectPlane );
+			state.phase = _objectsAdded++;
+			state.lod = LodNear;
+			state.time = 0.0;
+			state.extrapolation = 0.0;
+			it = _states.insert( pObject, state );
+		}
+		
+		State& state = it.value();
+		state.time += dt;
+		
+		// velocities after last step
+		if ( ! state.held.isEmpty() )
+		{
+			capture( state, touching );
+		}
+		
+		// promotion/demotion
+		Lod newLod = lod( state, viewers );
+		if ( newLod != state.lod )
+		{
+			state.lod = newLod;
+			if ( newLod == LodNear )
+			{
+				state.held.clear(); // back to full simulation, with velocities it has now
+				state.extrapolation = 0.0;
+			}
+			else if ( state.kinematic && state.held.isEmpty() )
+			{
+				capture( state, touching );
+			}
+		}
+		
+		if ( ( _steps + state.phase ) % LOD_INTERVALS[ state.lod ] != 0 )
+		{
+			continue;
+		}
+		
+		double time = state.time;
+		state.time = 0.0;
+		pObject->simulate( time );
+		
+		// object could remove itself, state reference is not valid any more.
+		// Forces it registered are integrated during next step, velocities are captured after it.
+		it = _states.find( pObject );
+		if ( it != _states.end() && it.value().lod != LodNear && it.value().kinematic )
+		{
+			it.value().extrapolation = time / dt;
+		}
+	}
+}
+
+// ============================================================================
+/// Forgets object removed from the world
+void SimulationScheduler::removeObject( WorldObject* pObject )
+{
+	_states.remove( pObject );
+}
+
+// ============================================================================
+/// Releases held body for next physics step, and captures its velocity after it. Called
+/// by code which applies impulses outside of contact solver (rounds, shockwaves), so
+/// the push isn't overwritten by held velocity. Does nothing for bodies not held.
+void SimulationScheduler::release( Body* pBody )
+{
+	QHash<WorldObject*, State>::iterator it = _states.find( pBody->parent() );
+	if ( it == _states.end() )
+	{
+		return;
+	}
+	
+	QVector<HeldVelocity>& held = it.value().held;
+	for( int i = 0; i < held.size(); i++ )
+	{
+		if ( held[i].pBody == pBody )
+		{
+			held[i].released = true;
+			break;
+		}
+	}
+}
+
+// ============================================================================
+/// Returns number of objects in LOD bucket.
+int SimulationScheduler::objects( Lod lod ) const
+{
+	int count = 0;
+	QHash<WorldObject*, State>::const_iterator it;
+	for( it = _states.begin(); it != _states.end(); ++it )
+	{
+		if ( it.value().lod == lod )
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+// ============================================================================
+/// Returns object's LOD, or LodCount if object is not simulated. Object is not dereferenced.
+SimulationScheduler::Lod SimulationScheduler::objectLod( const WorldObject* pObject ) const
+{
+	QHash<WorldObject*, State>::const_iterator it = _states.find( const_cast<WorldObject*>( pObject ) );
+	if ( it == _states.end() )
+	{
+		return LodCount;
+	}
+	return it.value().lod;
+}
+
+// ============================================================================
+/// Calculates object's LOD from distance to nearest viewer. Objects w/o position,
+/// and all objects when there are no viewers, are near. Object is promoted only when it's
+/// LOD_HYSTERESIS inside bucket's distance, so it doesn't flicker between buckets.
+SimulationScheduler::Lod SimulationScheduler::lod( const State& state, const QList<QPointF>& viewers ) const
+{
+	if ( viewers.isEmpty() || ! state.pPhysical || ! state.pPhysical->mainBody() || ! state.pPhysical->mainBody()->b2body() )
+	{
+		return LodNear;
+	}
+	
+	QPointF position = state.pPhysical->position();
+	double distance = -1;
+	foreach( const QPointF& viewer, viewers )
+	{
+		QPointF diff = viewer - position;
+		double d = sqrt( diff.x()*diff.x() + diff.y()*diff.y() );
+		if ( distance < 0 || d < distance )
+		{
+			distance = d;
+		}
+	}
+	
+	int lod = LodNear;
+	while( lod < LodFar )
+	{
+		double limit = LOD_DISTANCES[ lod ];
+		if ( state.lod > lod )
+		{
+			limit -= LOD_HYSTERESIS; // promote only when clearly inside
+		}
+		if ( distance < limit )
+		{
+			break;
+		}
+		lod++;
+	}
+	
+	return Lod( lod );
+}
+
+// ============================================================================
+/// Captures velocities of object's bodies after physics step, to be held until next simulation.
+/// If the object was simulated before the step, velocity change caused by its forces is
+/// extrapolated over its simulation interval. Held velocities of other bodies don't change.
+/// Released bodies keep velocities they have now. Bodies with contacts keep velocities
+/// resulting from collision response and are not held during next step.
+void SimulationScheduler::capture( State& state, const QVector<Body*>& touching )
+{
+	QVector<HeldVelocity> held;
+	held.reserve( state.held.size() );
+	
+	foreach( Body* pBody, state.pPhysical->bodies() )
+	{
+		b2Body* pb2Body = pBody->b2body();
+		if ( ! pb2Body )
+		{
+			continue;
+		}
+		
+		HeldVelocity captured;
+		captured.pBody = pBody;
+		captured.linear = pb2Body->GetLinearVelocity();
+		captured.angular = pb2Body->GetAngularVelocity();
+		captured.released = qBinaryFind( touching.begin(), touching.end(), pBody ) != touching.end();
+		
+		// previously held velocity. Bodies destroyed since then are only compared, not dereferenced
+		const HeldVelocity* pPrevious = NULL;
+		for( int i = 0; i < state.held.size(); i++ )
+		{
+			if ( state.held[i].pBody == pBody )
+			{
+				pPrevious = & state.held[i];
+				break;
+			}
+		}
+		
+		if ( pPrevious && ! pPrevious->released && ! captured.released )
+		{
+			if ( state.extrapolation > 0 )
+			{
+				float32 multiplier = state.extrapolation;
+				captured.linear = pPrevious->linear + multiplier * ( captured.linear - pPrevious->linear );
+				captured.angular = pPrevious->angular + multiplier * ( captured.angular - pPrevious->angular );
+			}
+			else
+			{
+				captured.linear = pPrevious->linear;
+				captured.angular = pPrevious->angular;
+			}
+		}
+		
+		held.append( captured );
+	}
+	
+	state.held = held;
+	state.extrapolation = 0.0;
+}
+
+}
+
+// EOF
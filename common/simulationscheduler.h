@@ -0,0 +1,118 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERSIMULATIONSCHEDULER_H
+#define FLYERSIMULATIONSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QPointF>
+
+#include "Box2D.h"
+
+namespace Flyer
+{
+
+class World;
+class WorldObject;
+class PhysicalObject;
+class Body;
+
+/**
+	Simulates world objects with level of detail depending on distance from viewers:
+	player's plane and optional additional points. Objects are bucketed by distance;
+	near objects are simulated each step, objects in far buckets are simulated every few
+	steps, with time accumulated since last simulation.
+	Planes in far buckets are also switched to simplified kinematic mode: between updates
+	their bodies keep held velocities, so they fly straight without aerodynamic forces.
+	Physics step following an update is not held; velocity change caused by forces the
+	object registered is captured after it, and extrapolated over the object's interval.
+	Bodies with contacts, and bodies pushed by impulses outside of the contact solver
+	(see release()), are not held either, so collision response is preserved.
+	Velocities are continuous, so promotion back to full simulation is seamless.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class SimulationScheduler
+{
+public:
+	
+	/// Simulation level of detail
+	enum Lod
+	{
+		LodNear,		///< Simulated each step
+		LodMid,			///< Simulated every few steps
+		LodFar,			///< Simulated rarely
+		LodCount
+	};
+	
+	SimulationScheduler( World* pWorld );
+	~SimulationScheduler();
+	
+	void setEnabled( bool enabled );			///< Enables/disables LOD. Disabled scheduler simulates everything each step
+	bool enabled() const { return _enabled; }	///< If LOD is enabled
+	
+	/// Sets viewers in addition to player's plane
+	void setViewers( const QList<QPointF>& viewers ) { _viewers = viewers; }
+	
+	void prepareStep( double dt );				///< Holds velocities of kinematic bodies, called before physics step
+	void simulate( double dt, const QVector<Body*>& touching );	///< Simulates objects, called after physics step
+	void removeObject( WorldObject* pObject );	///< Forgets object removed from the world
+	void release( Body* pBody );				///< Doesn't hold body during next step, keeps impulse applied to it
+	
+	int objects( Lod lod ) const;				///< Number of objects in LOD bucket
+	Lod objectLod( const WorldObject* pObject ) const;	///< Object's LOD, LodCount if object is not simulated
+
+private:
+	
+	/// Velocity held by body in kinematic mode
+	struct HeldVelocity
+	{
+		Body*	pBody;		///< Body
+		b2Vec2	linear;		///< Linear velocity [m/s]
+		float32	angular;	///< Angular velocity [rad/s]
+		bool	released;	///< Body had contacts or was pushed, it's not held during next step
+	};
+	
+	/// Scheduling state of single object
+	struct State
+	{
+		PhysicalObject*	pPhysical;	///< Object as physical object, NULL if it's not
+		bool			kinematic;	///< If object may be simulated kinematically when far
+		int				phase;		///< Step offset, spreads far objects across steps
+		Lod				lod;		///< Current LOD
+		double			time;		///< Time accumulated since last simulation [s]
+		double			extrapolation;	///< Object was simulated before last step: multiplier of velocity change, 0 otherwise
+		QVector<HeldVelocity>	held;	///< Held velocities, in kinematic mode
+	};
+	
+	Lod lod( const State& state, const QList<QPointF>& viewers ) const;	///< Calculates object's LOD
+	void capture( State& state, const QVector<Body*>& touching );	///< Captures velocities of object's bodies after physics step
+	
+	World*		_pWorld;				///< World
+	bool		_enabled;				///< LOD enabled
+	QList<QPointF>	_viewers;			///< Additional viewers
+	QHash<WorldObject*, State>	_states;	///< Scheduling state of simulated objects
+	int			_steps;					///< Steps simulated
+	int			_objectsAdded;			///< Objects seen so far, used to assign phases
+};
+
+}
+
+#endif // FLYERSIMULATIONSCHEDULER_H
+
+// EOF
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPainter>
 
 #include "spotlight.h"
@@ -107,4 +109,18 @@ void Spotlight::setRange( double r )
 	_currentRange = r;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Spotlight::saveState( QDataStream& stream ) const
+{
+	stream << _currentRange << _on;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Spotlight::restoreState( QDataStream& stream )
+{
+	stream >> _currentRange >> _on;
+}
+
 }
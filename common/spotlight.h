@@ -51,6 +51,11 @@ public:
 	bool on() const { return _on; }
 	
 	double currentRange() const { return _currentRange; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 private:
 
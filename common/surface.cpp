@@ -14,12 +14,15 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include <QPainter>
 
 #include "surface.h"
 #include "body.h"
 #include "b2dqt.h"
 #include "plane.h"
+#include "world.h"
 
 namespace Flyer {
 
@@ -72,11 +75,21 @@ void Surface::simulate( double /*dt*/ )
 {
 	if ( body() && body()->b2body() )
 	{
-		QPointF force = aerodynamicForce();
 		b2Body* pBody = body()->b2body();
+		AeroKernel* pKernel = parent()->world()->aeroKernel();
 		
-		b2Vec2 pos = pBody->GetWorldPoint( point2vec( _position ) );
-		pBody->ApplyForce( point2vec( force ), pos );
+		// force is calculated and applied by kernel, together with other surfaces
+		if ( pKernel->enabled() )
+		{
+			pKernel->addSurface( pBody, point2vec( _position ), coefficients() );
+		}
+		else
+		{
+			QPointF force = aerodynamicForce();
+			
+			b2Vec2 pos = pBody->GetWorldPoint( point2vec( _position ) );
+			pBody->ApplyForce( point2vec( force ), pos );
+		}
 	}
 }
 
@@ -90,7 +103,9 @@ QPointF Surface::aerodynamicForce() const
 		b2Body* pBody = body()->b2body();
 		double angle = pBody->GetAngle(); // body angle
 	
-		b2Vec2 velocity = pBody->GetLinearVelocity();
+		// airspeed
+		QPointF wind = parent()->world()->environment()->wind( vec2point( pBody->GetPosition() ) );
+		b2Vec2 velocity = pBody->GetLinearVelocity() - point2vec( wind );
 		double v = velocity.Length();
 		double velAngle = atan2( velocity.y, velocity.x );
 	
@@ -134,4 +149,18 @@ void Surface::setDragCoeffH( double drag )
 	_currentDragH = drag;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Surface::saveState( QDataStream& stream ) const
+{
+	stream << _currentDragH << _currentDragV << _currentLift;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Surface::restoreState( QDataStream& stream )
+{
+	stream >> _currentDragH >> _currentDragV >> _currentLift;
+}
+
 }
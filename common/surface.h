@@ -20,6 +20,7 @@
 #include <QPointF>
 
 #include "system.h"
+#include "aerokernel.h"
 
 namespace Flyer {
 
@@ -47,6 +48,11 @@ public:
 	void setWidth( double w ) { _width = w; }
 	void setInclination( double i ) { _inclination = i; }
 	void setPosition( const QPointF& pos ) { _position = pos; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 protected:
 
@@ -57,6 +63,9 @@ protected:
 	
 	/// Calculates aerodynamic force
 	virtual QPointF calculateForce( double velocity, double sinAttack ) const = 0;
+	
+	/// Returns current coefficients, used by world's aerodynamic kernel. Must match calculateForce().
+	virtual AeroKernel::Coefficients coefficients() const = 0;
 
 	// config
 	
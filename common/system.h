@@ -21,6 +21,7 @@
 
 class QPainter;
 class QRectF;
+class QDataStream;
 
 
 
@@ -68,6 +69,11 @@ public:
 	virtual void repair() {}						///< Repairs system
 	virtual void destroy() {}						///< Destroys system.
 	
+	// snapshots
+	
+	virtual void saveState( QDataStream& /*stream*/ ) const {}	///< Writes dynamic state
+	virtual void restoreState( QDataStream& /*stream*/ ) {}		///< Restores dynamic state
+	
 
 protected:
 
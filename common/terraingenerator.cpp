@@ -0,0 +1,180 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <QStack>
+
+#include "terraingenerator.h"
+
+namespace Flyer
+{
+
+// ============================================================================
+// Constructor
+TerrainGenerator::TerrainGenerator( const QList<Ground::Section>& sections, uint seed )
+	: _sections( sections ), _seed( seed )
+{
+	Q_ASSERT( ! sections.isEmpty() );
+}
+
+// ============================================================================
+/// X of first terrain point
+double TerrainGenerator::start() const
+{
+	return _sections.first().x;
+}
+
+// ============================================================================
+/// X of last terrain point
+double TerrainGenerator::end() const
+{
+	return _sections.last().x;
+}
+
+// ============================================================================
+/// Generates whole terrain.
+QPolygonF TerrainGenerator::generate() const
+{
+	// range is open at the right, so include the last seed point
+	return generate( start(), end() + 1.0 );
+}
+
+// ============================================================================
+/// Generates terrain points with x in range [from, to), ordered by x.
+/// Doesn't modify generator and doesn't use qrand(), so may be called
+/// concurrently from many threads.
+QPolygonF TerrainGenerator::generate( double from, double to ) const
+{
+	QPolygonF result;
+	QStack<Interval> stack;
+	
+	int sections = _sections.size();
+	for( int i = 0; i < sections; i++ )
+	{
+		const Ground::Section& section = _sections[i];
+		
+		// last section, or section which shouldn't be divided, contributes only its point
+		if ( i == sections - 1 || ! section.canBeDividedRight )
+		{
+			if ( section.x >= from && section.x < to )
+			{
+				result.append( QPointF( section.x, section.y ) );
+			}
+			continue;
+		}
+		
+		Interval root;
+		root.x1 = section.x;
+		root.y1 = section.y;
+		root.x2 = _sections[i+1].x;
+		root.y2 = _sections[i+1].y;
+		root.key = hash( _seed, i );
+		stack.push( root );
+		
+		// depth-first, left piece first, so points are generated in order
+		while( ! stack.isEmpty() )
+		{
+			Interval interval = stack.pop();
+			
+			// piece contributes its left point and points inside - none of them in range
+			if ( interval.x2 <= from || interval.x1 >= to )
+			{
+				continue;
+			}
+			
+			double width = interval.x2 - interval.x1;
+			if ( width < section.minSectionSize * 2 )
+			{
+				if ( interval.x1 >= from )
+				{
+					result.append( QPointF( interval.x1, interval.y1 ) );
+				}
+				continue; // STOP
+			}
+			
+			quint32 state = interval.key;
+			
+			// find x of new point
+			double newX = random( state, interval.x1 + section.minSectionSize, interval.x2 - section.minSectionSize );
+			
+			double widthLeft = newX - interval.x1;
+			double widthRight = interval.x2 - newX;
+			
+			// now find y
+			double maxY = qMin( interval.y1 + widthLeft * section.maxSlope,
+				interval.y2 + widthRight * section.maxSlope );
+			double minY = qMax( interval.y1 - widthLeft * section.maxSlope,
+				interval.y2 - widthRight * section.maxSlope );
+			
+			double newY = random( state, qMax( section.minHeight, minY ), qMin( section.maxHeight, maxY ) );
+			
+			Interval right;
+			right.x1 = newX;
+			right.y1 = newY;
+			right.x2 = interval.x2;
+			right.y2 = interval.y2;
+			right.key = hash( interval.key, 2 );
+			
+			Interval left;
+			left.x1 = interval.x1;
+			left.y1 = interval.y1;
+			left.x2 = newX;
+			left.y2 = newY;
+			left.key = hash( interval.key, 1 );
+			
+			stack.push( right );
+			stack.push( left );
+		}
+	}
+	
+	return result;
+}
+
+// ============================================================================
+/// Mixes two numbers into well-distributed 32-bit key.
+quint32 TerrainGenerator::hash( quint32 a, quint32 b )
+{
+	quint32 h = ( a * 0x9E3779B1u ) ^ ( b + 0x7F4A7C15u + ( a << 6 ) + ( a >> 2 ) );
+	
+	// murmur3 finalizer
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	
+	return h;
+}
+
+// ============================================================================
+/// Generates random number from range [start, end], advancing xorshift state.
+double TerrainGenerator::random( quint32& state, double start, double end )
+{
+	if ( state == 0 )
+	{
+		state = 1; // xorshift can't leave zero
+	}
+	
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	
+	return start + ( end - start ) * ( state / 4294967295.0 );
+}
+
+}
+
+// EOF
@@ -0,0 +1,73 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERTERRAINGENERATOR_H
+#define FLYERTERRAINGENERATOR_H
+
+#include <QList>
+#include <QPolygonF>
+
+#include "ground.h"
+
+namespace Flyer
+{
+
+/**
+	Generates random terrain from list of seed sections. Seed sections are
+	subdivided, like Ground used to do recursively, until pieces are shorter than
+	twice the section's minimal size. Each new point is placed within the section's height
+	limits and slope constraints from both neighbours.
+	Every random number is derived from generator seed and point's position in
+	subdivision tree, so the terrain doesn't depend on the order of generation.
+	Any x-range can be generated separately, on any thread, and ranges generated
+	separately join into the same heightmap as the whole terrain generated at once.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class TerrainGenerator
+{
+public:
+	TerrainGenerator( const QList<Ground::Section>& sections, uint seed );
+	
+	QPolygonF generate() const;							///< Generates whole terrain
+	QPolygonF generate( double from, double to ) const;	///< Generates points with x in [from, to)
+	
+	double start() const;					///< X of first terrain point
+	double end() const;						///< X of last terrain point
+	uint seed() const { return _seed; }		///< Random seed
+
+private:
+	
+	/// Piece of section, between two generated points
+	struct Interval
+	{
+		double	x1, y1;		///< Left point
+		double	x2, y2;		///< Right point
+		quint32	key;		///< Random key of piece, derived from position in subdivision tree
+	};
+	
+	static quint32 hash( quint32 a, quint32 b );
+	static double random( quint32& state, double start, double end );
+	
+	QList<Ground::Section>	_sections;		///< Seed sections
+	uint					_seed;			///< Random seed
+};
+
+}
+
+#endif // FLYERTERRAINGENERATOR_H
+
+// EOF
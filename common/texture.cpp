@@ -18,6 +18,7 @@
 
 #include <QPainter>
 #include <QGLWidget>
+#include <QMutexLocker>
 
 #include "texture.h"
 
@@ -25,6 +26,72 @@ namespace Flyer
 {
 
 static const double DEFAULT_RESOLUTION = 0.05; // 5 cm per pixel
+static const QColor PLACEHOLDER_COLOR( 128, 128, 128, 96 ); ///< Color used to draw textures not loaded yet
+static const int MAX_CLIPS = 256; ///< Max clips cached per texture
+static const double MIN_TEXEL_SIZE = 0.5; ///< Texel size below which smaller mip level is used [px]
+
+// ============================================================================
+/// Draws baked image in polygon coordinates.
+void TextureClip::render( QPainter& painter, const RenderingOptions& o ) const
+{
+	if ( images.isEmpty() )
+	{
+		return;
+	}
+	
+	int style = o.textureStyle;
+	if ( style < 0 || style >= images.size() )
+	{
+		style = Texture::Normal;
+	}
+	
+	// image pixels -> polygon coordinates (y axis goes up)
+	QTransform old = painter.transform();
+	painter.setTransform( QTransform( resolution, 0, 0, -resolution, origin.x(), origin.y() ), true );
+	
+	painter.drawImage( 0, 0, images[ style ] );
+	
+	painter.setTransform( old );
+}
+
+// ============================================================================
+// Constructor
+TextureData::TextureData()
+{
+	_ready = 0;
+}
+
+// ============================================================================
+/// Delivers images. Marks data as ready.
+void TextureData::setImages( const QMap< int, QImage >& newImages, const QMap< int, QList<QImage> >& newMipmaps )
+{
+	QMutexLocker locker( & mutex );
+	
+	images = newImages;
+	mipmaps = newMipmaps;
+	if ( images.contains( Texture::Normal ) )
+	{
+		size = images[ Texture::Normal ].size();
+	}
+	_ready = 1;
+	_readyCondition.wakeAll();
+}
+
+// ============================================================================
+/// Waits until images are delivered.
+void TextureData::waitForReady()
+{
+	if ( isReady() )
+	{
+		return;
+	}
+	
+	QMutexLocker locker( & mutex );
+	while( ! isReady() )
+	{
+		_readyCondition.wait( & mutex );
+	}
+}
 
 // ============================================================================
 // Default (and hopefully not used) constructor.
@@ -38,7 +105,10 @@ Texture::Texture()
 /// Constructor - creates texture using supplied basic image
 Texture::Texture( const QImage& baseImage, double resolution )
 {
-	_images.insert( Normal, baseImage );
+	QMap< int, QImage > images;
+	images.insert( Normal, baseImage );
+	_d = new TextureData();
+	_d->setImages( images );
 	
 	if ( resolution > 0 ) _resolution = resolution;
 	else _resolution = DEFAULT_RESOLUTION; // TODO read resolution form image
@@ -57,7 +127,22 @@ Texture::Texture( double width, double height, double resolution )
 	
 	QImage base( pixelsWidth, pixelsHeight, QImage::Format_ARGB32_Premultiplied );
 	base.fill( 0x00000000 ); // fill with transparency
-	_images.insert( Normal, base  );
+	
+	QMap< int, QImage > images;
+	images.insert( Normal, base );
+	_d = new TextureData();
+	_d->setImages( images );
+	_isSprite = false;
+}
+
+// ============================================================================
+/// Creates texture with shared data. Data can be delivered later.
+Texture::Texture( TextureData* pData, double resolution )
+{
+	_d = pData;
+	
+	if ( resolution > 0 ) _resolution = resolution;
+	else _resolution = DEFAULT_RESOLUTION;
 	_isSprite = false;
 }
 
@@ -68,16 +153,44 @@ Texture::~Texture()
 }
 
 // ============================================================================
-/// Returns image in specified version
+/// Checks if texture is null. Texture which is still loading is not null.
+bool Texture::isNull() const
+{
+	if ( ! _d )
+	{
+		return true;
+	}
+	if ( ! _d->isReady() )
+	{
+		return false;
+	}
+	
+	QMutexLocker locker( & _d->mutex );
+	return _d->images.isEmpty();
+}
+
+// ============================================================================
+/// Returns image in specified version. If texture is still being loaded, waits for it.
+/// Styles not prepared by loader are created here.
 QImage& Texture::image( int style )
 {
-	if ( _images.contains( style ) )
+	if ( ! _d )
+	{
+		_d = new TextureData();
+		_d->setImages( QMap< int, QImage >() );
+	}
+	_d->waitForReady();
+	
+	// rendering may be done from multiple threads
+	QMutexLocker locker( & _d->mutex );
+	
+	if ( _d->images.contains( style ) )
 	{
-		return _images[ style ];
+		return _d->images[ style ];
 	}
 	
-	_images.insert( style, applyStyle( _images[ int(Normal) ], style ) );
-	return _images[ style ];
+	_d->images.insert( style, applyStyle( _d->images[ int(Normal) ], style ) );
+	return _d->images[ style ];
 }
 
 // ============================================================================
@@ -86,6 +199,9 @@ QImage Texture::applyStyle( const QImage& src, int style )
 {
 	switch( style )
 	{
+		case Normal:
+			return src;
+		
 		case Background:
 		{
 			QImage dst( src );
@@ -107,14 +223,14 @@ QImage Texture::applyStyle( const QImage& src, int style )
 /// Returns texture width [in meters]
 double Texture::width() const
 {
-	return _images[Normal].width() * _resolution;
+	return _d ? _d->size.width() * _resolution : 0.0;
 }
 
 // ============================================================================
 /// Returns texture height [in meters]
 double Texture::height() const
 {
-	return _images[Normal].height() * _resolution;
+	return _d ? _d->size.height() * _resolution : 0.0;
 }
 
 // ============================================================================
@@ -147,19 +263,28 @@ void Texture::render( QPainter& painter, const QPointF& pos, const RenderingOpti
 	// normal rendering
 	else
 	*/
+	// texture not loaded yet - draw placeholder
+	if ( ! isReady() )
 	{
+		painter.fillRect( QRectF( pos.x(), pos.y() - height(), width(), height() ), PLACEHOLDER_COLOR );
+	}
+	else
+	{
+		double resolution = _resolution;
+		const QImage& img = mipmap( painter, o.textureStyle, resolution );
+		
 		QTransform old = painter.transform();
 		QTransform t = old;
-		t.scale( _resolution, - _resolution );
+		t.scale( resolution, - resolution );
 		painter.setTransform( t, false );
 		
 		QPointF position( pos.x(), - pos.y() );
 		
 		// debug
-		//QPointF p = position/_resolution;
+		//QPointF p = position/resolution;
 		//QPointF pixelPos = painter.transform().map( p );
 		
-		painter.drawImage( position/_resolution, image( o.textureStyle ) );
+		painter.drawImage( position/resolution, img );
 		
 		// restore previous trransform
 		painter.setTransform( old );
@@ -170,14 +295,24 @@ void Texture::render( QPainter& painter, const QPointF& pos, const RenderingOpti
 /// Fills supplied painter path with texture.
 void Texture::fill( QPainter& painter, const QPointF& pos, const QPolygonF& shape, const RenderingOptions o )
 {
-	QTransform old = painter.transform();
+	// texture not loaded yet - fill with placeholder color
+	if ( ! isReady() )
+	{
+		painter.setBrush( PLACEHOLDER_COLOR );
+		painter.setPen( Qt::NoPen );
+		painter.drawPolygon( shape );
+		return;
+	}
+	
+	double resolution = _resolution;
+	const QImage& img = mipmap( painter, o.textureStyle, resolution );
 	
 	QTransform t;
 	t.translate(  pos.x(), pos.y() ); // TODO test
-	t.scale( _resolution, -_resolution );
+	t.scale( resolution, -resolution );
 	
 	QBrush brush;
-	brush.setTextureImage( image( o.textureStyle ) );
+	brush.setTextureImage( img );
 	brush.setTransform( t );
 	
 	painter.setBrush( brush );
@@ -188,6 +323,116 @@ void Texture::fill( QPainter& painter, const QPointF& pos, const QPolygonF& shap
 	painter.drawPolygon( shape );
 }
 
+// ============================================================================
+/// Fills shape with texture once, into transparent image. Resulting clip can be
+/// rendered repeatedly, w/o creating texture brush each time.
+/// Clips are cached, so bodies with identical shapes share images.
+TextureClip Texture::clip( const QPointF& pos, const QPolygonF& shape )
+{
+	if ( shape.isEmpty() )
+	{
+		return TextureClip();
+	}
+	
+	image( Normal ); // wait for data
+	
+	// key - raw shape vertices, texture position and resolution
+	QByteArray key( reinterpret_cast<const char*>( shape.constData() ), shape.size() * sizeof( QPointF ) );
+	key.append( reinterpret_cast<const char*>( & pos ), sizeof( QPointF ) );
+	key.append( reinterpret_cast<const char*>( & _resolution ), sizeof( double ) );
+	
+	{
+		QMutexLocker locker( & _d->mutex );
+		if ( _d->clips.contains( key ) )
+		{
+			return _d->clips.value( key );
+		}
+	}
+	
+	// bake
+	QRectF rect = shape.boundingRect();
+	int w = qMax( 1, int( ceil( rect.width() / _resolution ) ) );
+	int h = qMax( 1, int( ceil( rect.height() / _resolution ) ) );
+	
+	TextureClip clip;
+	clip.origin = QPointF( rect.left(), rect.bottom() );
+	clip.resolution = _resolution;
+	
+	// polygon coordinates -> image pixels
+	QTransform toPixels( 1.0 / _resolution, 0, 0, -1.0 / _resolution, - rect.left() / _resolution, rect.bottom() / _resolution );
+	
+	QTransform brushTransform;
+	brushTransform.translate( pos.x(), pos.y() );
+	brushTransform.scale( _resolution, -_resolution );
+	
+	for( int style = Normal; style < StyleCount; style++ )
+	{
+		QImage baked( w, h, QImage::Format_ARGB32_Premultiplied );
+		baked.fill( 0 ); // transparent
+		
+		QPainter painter( & baked );
+		painter.setRenderHint( QPainter::Antialiasing, true );
+		painter.setTransform( toPixels );
+		
+		QBrush brush;
+		brush.setTextureImage( image( style ) );
+		brush.setTransform( brushTransform );
+		
+		painter.setBrush( brush );
+		painter.setPen( Qt::NoPen );
+		painter.drawPolygon( shape );
+		painter.end();
+		
+		clip.images.append( baked );
+	}
+	
+	QMutexLocker locker( & _d->mutex );
+	if ( _d->clips.size() >= MAX_CLIPS )
+	{
+		_d->clips.clear(); // users keep their copies
+	}
+	_d->clips.insert( key, clip );
+	
+	return clip;
+}
+
+// ============================================================================
+/// Selects image for painter scale. When texels would be smaller than MIN_TEXEL_SIZE device pixels,
+/// smaller mip level is used. \b resolution is set to resolution of returned image [meters per pixel].
+const QImage& Texture::mipmap( const QPainter& painter, int style, double& resolution )
+{
+	const QImage& base = image( style );
+	resolution = _resolution;
+	
+	// mipmaps are not modified once data is ready, no need to lock
+	const QMap< int, QList<QImage> >& mipmaps = _d->mipmaps;
+	QMap< int, QList<QImage> >::const_iterator it = mipmaps.find( style );
+	if ( it == mipmaps.end() )
+	{
+		return base;
+	}
+	const QList<QImage>& levels = it.value();
+	
+	const QTransform& t = painter.transform();
+	double texelSize = sqrt( qAbs( t.det() ) ) * _resolution; // device pixels per texel
+	
+	int level = 0;
+	while( level < levels.size() && texelSize < MIN_TEXEL_SIZE )
+	{
+		texelSize *= 2;
+		level++;
+	}
+	
+	if ( level == 0 )
+	{
+		return base;
+	}
+	
+	const QImage& selected = levels[ level - 1 ];
+	resolution = _resolution * base.width() / selected.width();
+	return selected;
+}
+
 // ============================================================================
 /// Makes texture a sprite. Sprites are draw using glDrawPixels, which is deadly fast.
 void Texture::setIsSprite( bool sprite )
@@ -202,16 +447,17 @@ void Texture::setIsSprite( bool sprite )
 /// Returns image converted to OpenGL format
 QImage& Texture::sprite( int style )
 {
-	if (  ! _sprites.contains( style ) )
-	{
+	QImage& src = image( style );
 	
-		QImage& src = image( style );
+	QMutexLocker locker( & _d->mutex );
+	if (  ! _d->sprites.contains( style ) )
+	{
 		QImage converted = QGLWidget::convertToGLFormat( src );
 		
-		_sprites.insert( style, converted );
+		_d->sprites.insert( style, converted );
 	}
 	
-	return _sprites[ style ];
+	return _d->sprites[ style ];
 }
 
 }
@@ -18,15 +18,79 @@
 #define FLYERTEXTURE_H
 
 #include <QMap>
+#include <QList>
+#include <QHash>
+#include <QVector>
 #include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QSharedData>
+#include <QExplicitlySharedDataPointer>
 
 #include "renderingoptions.h"
 
+class QPainter;
+
 namespace Flyer
 {
 
+/**
+Texture clipped to a polygon and baked into alpha-masked images, one per texture style.
+Image's top-left pixel corner is at \b origin, in polygon coordinates.
+@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class TextureClip
+{
+public:
+	TextureClip() : resolution( 0.0 ) {}
+	
+	/// Draws clip on painter. Painter should be in polygon coordinates
+	void render( QPainter& painter, const RenderingOptions& o ) const;
+	
+	/// Checks if clip is null
+	bool isNull() const { return images.isEmpty(); }
+	
+	QVector< QImage >	images;		///< Baked images, indexed by style
+	QPointF				origin;		///< Position of image's top-left corner [m]
+	double				resolution;	///< Image resolution [meters per pixel]
+};
+
+/**
+Texture images, shared between all copies of the texture. Images may be
+delivered later by the loader thread - until then the data is not ready.
+@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class TextureData : public QSharedData
+{
+public:
+	TextureData();
+	
+	/// Sets images, marks data as ready and wakes up waiting threads
+	void setImages( const QMap< int, QImage >& images, const QMap< int, QList<QImage> >& mipmaps = QMap< int, QList<QImage> >() );
+	
+	/// Blocks until data is ready
+	void waitForReady();
+	
+	/// Checks if data is ready. Doesn't block
+	bool isReady() const { return int( _ready ) != 0; }
+	
+	QMutex				mutex;			///< Guards images
+	QMap< int, QImage >	images;			///< Cached converted images
+	QMap< int, QImage >	sprites;		///< Cached sprite images
+	QMap< int, QList<QImage> >	mipmaps;	///< Smaller versions of images, by style. Not modified once ready.
+	QSize				size;			///< Image size, known before image is loaded [px]
+	QHash< QByteArray, TextureClip >	clips;	///< Clips baked so far, by polygon
+
+private:
+
+	QWaitCondition		_readyCondition;	///< Signalled when data becomes ready
+	QAtomicInt			_ready;				///< If images were delivered
+};
+
 /**
 Texture class. Holds image in different version.
+Texture images may be loaded in background. Until then, texture renders placeholder.
 
 @author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
@@ -38,6 +102,7 @@ public:
 	enum Style {
 		Normal,				///< Normal texture, unchanged
 		Background,			///< Dimmed texture for objects moved to background
+		StyleCount			///< Number of styles
 	};
 
 	Texture();
@@ -55,6 +120,9 @@ public:
 	/// Fills shape with texture
 	void fill( QPainter& p, const QPointF& pos, const QPolygonF& shape, const RenderingOptions o );
 	
+	/// Bakes texture clipped to shape into sprite. Identical shapes share the sprite.
+	TextureClip clip( const QPointF& pos, const QPolygonF& shape );
+	
 	double width() const;		///< Texture width [m]
 	double height() const;		///< Texture height [m]
 	
@@ -64,7 +132,7 @@ public:
 	void setIsSprite( bool sprite );
 	bool isSprite() const { return _isSprite; }
 	
-	/// Provides texture image in specified version.
+	/// Provides texture image in specified version. Blocks until texture is loaded.
 	///@obsolete Use render() instead.
 	QImage& image( int style );
 	
@@ -72,11 +140,19 @@ public:
 	QImage& baseImage() { return image( Normal ); }
 	
 	/// Checks if texture is null
-	bool isNull() const { return _images.isEmpty(); }
+	bool isNull() const;
+	
+	/// Checks if texture images are loaded
+	bool isReady() const { return _d && _d->isReady(); }
 	
 private:
 
-	QMap< int, QImage >	_images;		///< Cached converted images
+	friend class TextureProvider;
+	
+	/// Creates texture using shared data, which may be not ready yet
+	Texture( TextureData* pData, double resolution = 0.0 );
+
+	QExplicitlySharedDataPointer<TextureData>	_d;	///< Images
 	double				_resolution;	///< Texture resolution [meters per pixel]
 	
 	// sprite support
@@ -84,8 +160,10 @@ private:
 	/// Returns sprite-version of image
 	QImage& sprite( int style );
 	
+	/// Selects mip level for painter, returns image and its resolution
+	const QImage& mipmap( const QPainter& painter, int style, double& resolution );
+	
 	bool				_isSprite;		///< If texture is sprite. Sprite is painted using glDrawPixles. Deadly fast.
-	QMap< int, QImage >	_sprites;		///< Cached converted images
 };
 
 }
@@ -0,0 +1,315 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "texturecache.h"
+
+namespace Flyer
+{
+
+static const char MAGIC[] = "FLYRTEXC";	///< Cache file magic, 8 bytes
+static const quint32 VERSION = 1;		///< Cache file format version
+static const int DATA_ALIGNMENT = 16;	///< Alignment of image data
+static const int MIN_MIP_SIZE = 16;		///< Smallest mip level dimension [px]
+static const int MAX_MIP_LEVELS = 4;	///< Max number of mip levels (not counting base image)
+
+/// Single image in cache file
+struct CacheEntry
+{
+	qint32	style;
+	qint32	level;
+	qint32	width;
+	qint32	height;
+	qint32	bytesPerLine;
+	quint32	format;
+	quint64	offset;
+};
+
+/// Mapped cache files. Never unmapped, as images created from them may be alive until exit.
+static QList<QFile*>	mappedFiles;
+static QMutex			mappedFilesMutex;
+
+// ============================================================================
+/// Writes cache entry
+static QDataStream& operator << ( QDataStream& stream, const CacheEntry& e )
+{
+	return stream << e.style << e.level << e.width << e.height << e.bytesPerLine << e.format << e.offset;
+}
+
+// ============================================================================
+/// Reads cache entry
+static QDataStream& operator >> ( QDataStream& stream, CacheEntry& e )
+{
+	return stream >> e.style >> e.level >> e.width >> e.height >> e.bytesPerLine >> e.format >> e.offset;
+}
+
+// ============================================================================
+/// Calculates MD5 of source image file.
+QByteArray TextureCache::sourceHash( const QString& sourcePath )
+{
+	QFile source( sourcePath );
+	if ( ! source.open( QIODevice::ReadOnly ) )
+	{
+		return QByteArray();
+	}
+	
+	return QCryptographicHash::hash( source.readAll(), QCryptographicHash::Md5 );
+}
+
+// ============================================================================
+/// Returns directory where cache files are stored
+QString TextureCache::cachePath()
+{
+	QDir dir( QCoreApplication::applicationDirPath() );
+	dir.cdUp();
+	return dir.absoluteFilePath( "cache/textures" );
+}
+
+// ============================================================================
+/// Returns cache file path for named texture
+QString TextureCache::cacheFile( const QString& name )
+{
+	return cachePath() + "/" + name + ".cache";
+}
+
+// ============================================================================
+/// Creates mip levels: each level is half the size of previous one.
+TextureCache::MipmapMap TextureCache::createMipmaps( const ImageMap& images )
+{
+	MipmapMap mipmaps;
+	
+	foreach( int style, images.keys() )
+	{
+		QList<QImage> levels;
+		QImage level = images.value( style );
+		while( levels.size() < MAX_MIP_LEVELS && level.width() >= MIN_MIP_SIZE*2 && level.height() >= MIN_MIP_SIZE*2 )
+		{
+			level = level.scaled( level.width() / 2, level.height() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+			levels.append( level );
+		}
+		mipmaps.insert( style, levels );
+	}
+	
+	return mipmaps;
+}
+
+// ============================================================================
+/// Loads texture from cache file. Images use mapped file memory.
+bool TextureCache::load( const QString& name, const QByteArray& hash, ImageMap& images, MipmapMap& mipmaps )
+{
+	if ( hash.isEmpty() )
+	{
+		return false;
+	}
+	
+	QFile* pFile = new QFile( cacheFile( name ) );
+	if ( ! pFile->open( QIODevice::ReadOnly ) )
+	{
+		delete pFile;
+		return false;
+	}
+	
+	qint64 size = pFile->size();
+	uchar* pData = pFile->map( 0, size );
+	if ( ! pData )
+	{
+		delete pFile;
+		return false;
+	}
+	
+	// header
+	QByteArray content = QByteArray::fromRawData( reinterpret_cast<const char*>( pData ), size );
+	QDataStream stream( content );
+	
+	char magic[ 8 ];
+	quint32 version = 0;
+	QByteArray fileHash;
+	quint32 count = 0;
+	
+	if ( stream.readRawData( magic, 8 ) != 8 || qstrncmp( magic, MAGIC, 8 ) != 0 )
+	{
+		delete pFile;
+		return false;
+	}
+	stream >> version >> fileHash >> count;
+	
+	if ( stream.status() != QDataStream::Ok || version != VERSION || fileHash != hash )
+	{
+		delete pFile; // stale
+		return false;
+	}
+	
+	ImageMap loadedImages;
+	QMap< int, QMap< int, QImage > > loadedLevels;
+	for( quint32 i = 0; i < count; i++ )
+	{
+		CacheEntry entry;
+		stream >> entry;
+		
+		quint64 bytes = quint64( entry.bytesPerLine ) * entry.height;
+		if ( stream.status() != QDataStream::Ok || entry.offset + bytes > quint64( size ) )
+		{
+			qWarning("Texture cache file for %s is corrupted", qPrintable( name ) );
+			delete pFile;
+			return false;
+		}
+		
+		QImage image( const_cast<const uchar*>( pData ) + entry.offset, entry.width, entry.height
+			, entry.bytesPerLine, QImage::Format( entry.format ) );
+		
+		if ( entry.level == 0 )
+		{
+			loadedImages.insert( entry.style, image );
+		}
+		else
+		{
+			loadedLevels[ entry.style ].insert( entry.level, image );
+		}
+	}
+	
+	images = loadedImages;
+	mipmaps.clear();
+	foreach( int style, loadedLevels.keys() )
+	{
+		mipmaps.insert( style, loadedLevels[ style ].values() ); // ordered by level
+	}
+	
+	QMutexLocker locker( & mappedFilesMutex );
+	mappedFiles.append( pFile );
+	
+	return true;
+}
+
+// ============================================================================
+/// Saves texture into cache. File is written under temporary name, and then renamed,
+/// so other instance will never see incomplete file.
+bool TextureCache::save( const QString& name, const QByteArray& hash, const ImageMap& images, const MipmapMap& mipmaps )
+{
+	if ( hash.isEmpty() )
+	{
+		return false;
+	}
+	
+	QString path = cacheFile( name );
+	QDir().mkpath( QFileInfo( path ).absolutePath() );
+	
+	// collect images
+	QList<CacheEntry> entries;
+	QList<QImage> data;
+	foreach( int style, images.keys() )
+	{
+		QList<QImage> levels;
+		levels.append( images.value( style ) );
+		levels += mipmaps.value( style );
+		
+		for( int level = 0; level < levels.size(); level++ )
+		{
+			QImage image = levels[ level ];
+			if ( image.format() != QImage::Format_ARGB32_Premultiplied )
+			{
+				image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+			}
+			
+			CacheEntry entry;
+			entry.style			= style;
+			entry.level			= level;
+			entry.width			= image.width();
+			entry.height		= image.height();
+			entry.bytesPerLine	= image.bytesPerLine();
+			entry.format		= image.format();
+			entry.offset		= 0;
+			
+			entries.append( entry );
+			data.append( image );
+		}
+	}
+	
+	// header size - entries have fixed size, so offsets don't change it
+	QByteArray header;
+	{
+		QDataStream stream( & header, QIODevice::WriteOnly );
+		stream.writeRawData( MAGIC, 8 );
+		stream << VERSION << hash << quint32( entries.size() );
+		foreach( const CacheEntry& entry, entries )
+		{
+			stream << entry;
+		}
+	}
+	
+	// calculate offsets
+	quint64 offset = header.size();
+	for( int i = 0; i < entries.size(); i++ )
+	{
+		offset = ( offset + DATA_ALIGNMENT - 1 ) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+		entries[i].offset = offset;
+		offset += data[i].numBytes();
+	}
+	
+	// write
+	QString tmpPath = path + ".tmp";
+	QFile file( tmpPath );
+	if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+	{
+		qWarning("Can't write texture cache %s: %s", qPrintable( tmpPath ), qPrintable( file.errorString() ) );
+		return false;
+	}
+	
+	QDataStream stream( & file );
+	stream.writeRawData( MAGIC, 8 );
+	stream << VERSION << hash << quint32( entries.size() );
+	foreach( const CacheEntry& entry, entries )
+	{
+		stream << entry;
+	}
+	
+	for( int i = 0; i < entries.size(); i++ )
+	{
+		qint64 padding = entries[i].offset - file.pos();
+		if ( padding > 0 )
+		{
+			file.write( QByteArray( int( padding ), '\0' ) );
+		}
+		const QImage& image = data.at( i );
+		file.write( reinterpret_cast<const char*>( image.bits() ), image.numBytes() );
+	}
+	
+	bool ok = file.error() == QFile::NoError;
+	file.close();
+	
+	if ( ok )
+	{
+		QFile::remove( path );
+		ok = QFile::rename( tmpPath, path );
+	}
+	if ( ! ok )
+	{
+		QFile::remove( tmpPath );
+	}
+	
+	return ok;
+}
+
+}
+
+// EOF
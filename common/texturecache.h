@@ -0,0 +1,73 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERTEXTURECACHE_H
+#define FLYERTEXTURECACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QList>
+#include <QImage>
+
+namespace Flyer
+{
+
+/**
+	On-disk cache of decoded textures. For each texture, cache file holds raw premultiplied
+	pixels of all styles and their mip levels, so texture can be used without decoding.
+	Cache file is validated with MD5 hash of source image file.
+	Cache files are memory-mapped; images use mapped memory directly.
+	
+	File layout (numbers written with QDataStream):
+	- header: magic (8 bytes), version, source hash, number of images, and for each image:
+	  style, mip level, width, height, bytes per line, format, data offset
+	- pixel data, each image aligned to DATA_ALIGNMENT bytes
+	
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class TextureCache
+{
+public:
+
+	typedef QMap< int, QImage >			ImageMap;	///< Images, by style
+	typedef QMap< int, QList<QImage> >	MipmapMap;	///< Mip levels 1..n, by style
+	
+	/// Calculates hash of source file
+	static QByteArray sourceHash( const QString& sourcePath );
+	
+	/// Loads texture from cache. Returns \b false if there is no valid cache file for this source.
+	static bool load( const QString& name, const QByteArray& hash, ImageMap& images, MipmapMap& mipmaps );
+	
+	/// Saves texture to cache. Returns \b false on error.
+	static bool save( const QString& name, const QByteArray& hash, const ImageMap& images, const MipmapMap& mipmaps );
+	
+	/// Creates mip levels of all images
+	static MipmapMap createMipmaps( const ImageMap& images );
+	
+	/// Returns cache directory
+	static QString cachePath();
+
+private:
+
+	static QString cacheFile( const QString& name );	///< Returns cache file path for texture
+};
+
+}
+
+#endif // FLYERTEXTURECACHE_H
+
+// EOF
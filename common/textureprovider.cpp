@@ -15,9 +15,18 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include <QDir>
+#include <QDirIterator>
 #include <QCoreApplication>
 #include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QImageReader>
 
+#include "common.h"
+#include "assetpack.h"
+#include "texturecache.h"
 
 #include "textureprovider.h"
 
@@ -29,26 +38,200 @@ static QString _libraryPathCache; ///< Library path cache
 /// Texture cache
 static QHash< QString, Texture > _textures;
 
+static QMutex		_texturesMutex;			///< Guards texture cache and loader statistics
+static QThreadPool*	_pLoaderPool = NULL;	///< Texture loading threads
+static int			_pendingTextures = 0;	///< Textures scheduled but not loaded yet
+static int			_loadedTextures = 0;	///< Textures loaded so far
+static double		_totalLoadTime = 0.0;	///< Total time spent loading textures [ms]
+
+/// Background job loading single texture. Maps decoded texture from disk cache, or
+/// decodes image, converts it into format best suitable for painting, prepares all
+/// texture styles and mip levels, and stores them in the cache.
+class TextureLoadJob : public QRunnable
+{
+public:
+	TextureLoadJob( const QString& name, const QString& path, TextureData* pData, const QImage& image = QImage() )
+		: _name( name ), _path( path ), _pData( pData ), _image( image )
+	{
+		setAutoDelete( true );
+	}
+	
+	virtual void run()
+	{
+		double start = getms();
+		
+		TextureCache::ImageMap images;
+		TextureCache::MipmapMap mipmaps;
+		
+		// disk cache is used for loose files only, image from asset pack is already decoded
+		QByteArray hash;
+		if ( _image.isNull() )
+		{
+			hash = TextureCache::sourceHash( _path );
+			if ( TextureCache::load( _name, hash, images, mipmaps ) )
+			{
+				_pData->setImages( images, mipmaps );
+				
+				double loaded = getms();
+				qDebug("Texture %-40s %4dx%-4d mapped from cache in %6.1f ms"
+					, qPrintable( _name ), _pData->size.width(), _pData->size.height(), loaded - start );
+				finished( loaded - start );
+				return;
+			}
+		}
+		
+		QImage image = _image;
+		if ( image.isNull() )
+		{
+			image = QImage( _path );
+			if ( image.isNull() )
+			{
+				qWarning("Can't load texture %s", qPrintable( _path ) );
+			}
+		}
+		if ( ! image.isNull() && image.format() != QImage::Format_ARGB32_Premultiplied )
+		{
+			image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+		}
+		double decoded = getms();
+		
+		images.insert( Texture::Normal, image );
+		for( int style = Texture::Normal + 1; style < Texture::StyleCount; style++ )
+		{
+			images.insert( style, Texture::applyStyle( image, style ) );
+		}
+		mipmaps = TextureCache::createMipmaps( images );
+		double styled = getms();
+		
+		_pData->setImages( images, mipmaps );
+		
+		qDebug("Texture %-40s %4dx%-4d decoded in %6.1f ms, styles and mipmaps in %6.1f ms"
+			, qPrintable( _name ), image.width(), image.height(), decoded - start, styled - decoded );
+		
+		if ( ! hash.isEmpty() && ! image.isNull() )
+		{
+			TextureCache::save( _name, hash, images, mipmaps );
+		}
+		
+		finished( styled - start );
+	}
+
+private:
+
+	/// Updates loader statistics
+	void finished( double time )
+	{
+		QMutexLocker locker( & _texturesMutex );
+		_loadedTextures ++;
+		_totalLoadTime += time;
+		_pendingTextures --;
+		if ( _pendingTextures == 0 )
+		{
+			qDebug("Texture loader idle. %d textures loaded in %.1f ms total"
+				, _loadedTextures, _totalLoadTime );
+		}
+	}
+	
+	QString		_name;
+	QString		_path;
+	QExplicitlySharedDataPointer<TextureData>	_pData;
+	QImage		_image;		///< Pre-decoded image [optional]
+};
+
 // ============================================================================
-///Loads texture.
+///Loads texture. If texture is not in cache, it is scheduled for loading in background,
+/// and texture which is not ready yet is returned.
 Texture TextureProvider::loadTexture( const QString& name )
 {
+	QMutexLocker locker( & _texturesMutex );
+	
 	// texture in cache
 	if ( _textures.contains( name ) )
 	{
 		return _textures[ name ];
 	}
 	
-	// teture not in cache, load 
+	// teture not in cache, schedule loading
 	QString path = libraryPath() + "/" + name; // TODO stupid and unreliable
-	QImage baseImage( path );
-
-	Texture t( baseImage );
+	
+	TextureData* pData = new TextureData();
+	
+	// use decoded image from asset pack, if available
+	QImage packed;
+	AssetPack* pPack = AssetPack::instance();
+	if ( pPack && pPack->contains( AssetPack::AssetTexture, name ) )
+	{
+		packed = pPack->image( name );
+		pData->size = packed.size();
+	}
+	else
+	{
+		pData->size = QImageReader( path ).size(); // reads only header, used to draw placeholder
+	}
+	
+	Texture t( pData );
 	_textures.insert( name, t );
 	
+	if ( ! _pLoaderPool )
+	{
+		_pLoaderPool = new QThreadPool();
+	}
+	_pendingTextures ++;
+	_pLoaderPool->start( new TextureLoadJob( name, path, pData, packed ) );
+	
 	return t;
 }
 
+// ============================================================================
+/// Schedules all textures found in the library (or in asset pack) for loading.
+void TextureProvider::preloadLibrary()
+{
+	AssetPack* pPack = AssetPack::instance();
+	if ( pPack )
+	{
+		foreach( const QString& name, pPack->names( AssetPack::AssetTexture ) )
+		{
+			loadTexture( name );
+		}
+		return;
+	}
+	
+	QDir library( libraryPath() );
+	QStringList filters;
+	filters << "*.png";
+	
+	QDirIterator it( library.absolutePath(), filters, QDir::Files, QDirIterator::Subdirectories );
+	while( it.hasNext() )
+	{
+		loadTexture( library.relativeFilePath( it.next() ) );
+	}
+}
+
+// ============================================================================
+/// Waits until all scheduled textures are loaded.
+void TextureProvider::waitForLoaded()
+{
+	QThreadPool* pPool = NULL;
+	{
+		QMutexLocker locker( & _texturesMutex );
+		pPool = _pLoaderPool;
+	}
+	
+	if ( pPool )
+	{
+		pPool->waitForDone();
+	}
+}
+
+// ============================================================================
+/// Returns number of textures loaded so far, or -1 if some scheduled textures are not loaded yet.
+int TextureProvider::loadedTextures()
+{
+	QMutexLocker locker( & _texturesMutex );
+	
+	return _pendingTextures > 0 ? -1 : _loadedTextures;
+}
+
 // ============================================================================
 ///Returns path to the library.
 QString TextureProvider::libraryPath()
@@ -27,6 +27,7 @@ namespace Flyer
 /**
 TextureProvider is a utility which provides textures for rendering. Textures are identified
 as file names (relative path). The provider knows where to look for them.
+Textures are decoded, and all their styles prepared, by the background loader pool.
 @author Maciek Gajewski <maciej.gajewski0@gmail.com>
 */
 
@@ -34,9 +35,18 @@ class TextureProvider
 {
 public:
 
-	/// Loads named texture from texture library
+	/// Loads named texture from texture library. Texture is decoded in background.
 	static Texture loadTexture( const QString& texture );
 	
+	/// Schedules loading of all textures in library
+	static void preloadLibrary();
+	
+	/// Blocks until all scheduled textures are loaded
+	static void waitForLoaded();
+	
+	/// Returns number of textures loaded so far, or -1 if some are still being loaded
+	static int loadedTextures();
+	
 	/// Returns disk path (may be resource path) to texture library.
 	static QString libraryPath();
 	
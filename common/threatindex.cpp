@@ -0,0 +1,167 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <math.h>
+
+#include "world.h"
+#include "machine.h"
+#include "body.h"
+
+#include "threatindex.h"
+
+namespace Flyer
+{
+
+static const double CELL_WIDTH = 500;	///< Grid cell width [m], about gunners' sight range
+static const int SIDES = World::ObjectSide1 | World::ObjectSide2;	///< Side bits of object class
+
+// ============================================================================
+// Constructor
+ThreatIndex::ThreatIndex( World* pWorld ) : _pWorld( pWorld )
+{
+	Q_ASSERT( pWorld );
+	
+	QRectF boundary = pWorld->boundary();
+	_origin = boundary.left();
+	_cells = int( boundary.width() / CELL_WIDTH ) + 1;
+	_cellStart.fill( 0, _cells + 1 );
+}
+
+// ============================================================================
+// Destructor
+ThreatIndex::~ThreatIndex()
+{
+}
+
+// ============================================================================
+/// Rebuilds index from machines which were added to the world with a side.
+void ThreatIndex::update()
+{
+	clear();
+	
+	int sides[] = { World::ObjectSide1, World::ObjectSide2 };
+	for( int s = 0; s < 2; s++ )
+	{
+		foreach( WorldObject* pObject, _pWorld->_objects[ sides[s] ] )
+		{
+			Machine* pMachine = dynamic_cast<Machine*>( pObject );
+			if ( pMachine && pMachine->mainBody() && pMachine->mainBody()->b2body() )
+			{
+				Target target;
+				target.pMachine = pMachine;
+				target.position = pMachine->mainBody()->b2body()->GetPosition();
+				target.velocity = pMachine->mainBody()->b2body()->GetLinearVelocity();
+				target.objectClass = _pWorld->objectClass( pMachine );
+				addTarget( target );
+			}
+		}
+	}
+	
+	build();
+}
+
+// ============================================================================
+/// Removes all targets. Memory is kept for next build.
+void ThreatIndex::clear()
+{
+	_added.resize( 0 );
+	_targets.resize( 0 );
+	_cellStart.fill( 0 );
+}
+
+// ============================================================================
+/// Adds target. Target is not found by queries until build() is called.
+void ThreatIndex::addTarget( const Target& target )
+{
+	_added.append( target );
+}
+
+// ============================================================================
+/// Sorts added targets into grid cells (counting sort, keeps order within cell).
+void ThreatIndex::build()
+{
+	// count targets in each cell
+	_cellStart.fill( 0 );
+	for( int i = 0; i < _added.size(); i++ )
+	{
+		_cellStart[ cell( _added[i].position.x ) + 1 ]++;
+	}
+	
+	// first index of each cell
+	for( int c = 0; c < _cells; c++ )
+	{
+		_cellStart[ c + 1 ] += _cellStart[ c ];
+	}
+	
+	// place targets, using cell starts as insertion points, then restore them
+	_targets.resize( _added.size() );
+	for( int i = 0; i < _added.size(); i++ )
+	{
+		int c = cell( _added[i].position.x );
+		_targets[ _cellStart[ c ]++ ] = _added[i];
+	}
+	for( int c = _cells; c > 0; c-- )
+	{
+		_cellStart[ c ] = _cellStart[ c - 1 ];
+	}
+	_cellStart[ 0 ] = 0;
+	
+	_added.resize( 0 );
+}
+
+// ============================================================================
+/// Finds target nearest to \b point, within \b range, which was added to the world with class
+/// matching \b types and side different from \b side. Objects w/o side are neutral - never hostile.
+/// Returned pointer is valid until next update().
+const ThreatIndex::Target* ThreatIndex::nearestHostile( const b2Vec2& point, int side, double range, int types ) const
+{
+	const Target* pNearest = NULL;
+	double nearestDistance2 = range * range;
+	
+	int firstCell = cell( point.x - range );
+	int lastCell = cell( point.x + range );
+	
+	for( int i = _cellStart[ firstCell ]; i < _cellStart[ lastCell + 1 ]; i++ )
+	{
+		const Target& target = _targets[i];
+		int targetSide = target.objectClass & SIDES;
+		if ( ! ( target.objectClass & types ) || ! targetSide || targetSide == ( side & SIDES ) )
+		{
+			continue;
+		}
+		
+		double distance2 = ( target.position - point ).LengthSquared();
+		if ( distance2 <= nearestDistance2 && ( ! pNearest || distance2 < nearestDistance2 ) )
+		{
+			nearestDistance2 = distance2;
+			pNearest = & target;
+		}
+	}
+	
+	return pNearest;
+}
+
+// ============================================================================
+/// Returns cell containing x. Positions outside world are clamped to first or last cell.
+int ThreatIndex::cell( double x ) const
+{
+	return qBound( 0, int( floor( ( x - _origin ) / CELL_WIDTH ) ), _cells - 1 );
+}
+
+}
+
+// EOF
@@ -0,0 +1,85 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERTHREATINDEX_H
+#define FLYERTHREATINDEX_H
+
+#include <QVector>
+
+#include "Box2D.h"
+
+namespace Flyer
+{
+
+class World;
+class Machine;
+
+/**
+	Per-step index of targetable machines: their positions, velocities and sides, sorted
+	into uniform grid of cells along X axis. Index is rebuilt by the world once per simulation
+	step, and gunners query it for nearest hostile machine in range, instead of each of them
+	checking all machines on its own.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class ThreatIndex
+{
+public:
+	
+	/// Targetable machine
+	struct Target
+	{
+		Machine*	pMachine;		///< Machine
+		b2Vec2		position;		///< Position [m]
+		b2Vec2		velocity;		///< Velocity [m/s]
+		int			objectClass;	///< Class machine was added to the world with, including side
+	};
+	
+	ThreatIndex( World* pWorld );
+	~ThreatIndex();
+	
+	void update();							///< Rebuilds index from world's machines
+	
+	// manual construction
+	
+	void clear();							///< Removes all targets
+	void addTarget( const Target& target );	///< Adds target
+	void build();							///< Sorts targets into grid
+	
+	// queries
+	
+	/// Finds nearest target of \b types, hostile to \b side, within \b range from \b point. Returns NULL if not found
+	const Target* nearestHostile( const b2Vec2& point, int side, double range, int types ) const;
+	
+	const QVector<Target>& targets() const { return _targets; }	///< Targets, ordered by cell
+
+private:
+	
+	int cell( double x ) const;			///< Cell containing x, clamped to grid
+	
+	World*			_pWorld;			///< World
+	double			_origin;			///< X of first cell [m]
+	int				_cells;				///< Number of cells
+	QVector<Target>	_targets;			///< Targets, sorted by cell
+	QVector<Target>	_added;				///< Targets added since last build
+	QVector<int>	_cellStart;			///< Index of first target in each cell, and total count at the end
+};
+
+}
+
+#endif // FLYERTHREATINDEX_H
+
+// EOF
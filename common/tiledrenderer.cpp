@@ -0,0 +1,183 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <QPainter>
+#include <QPaintDevice>
+#include <QRunnable>
+#include <QThread>
+
+#include "world.h"
+#include "worldobject.h"
+
+#include "tiledrenderer.h"
+
+namespace Flyer
+{
+
+static const int DEFAULT_TILE_SIZE = 256;	///< Default tile size [px]
+static const int CULL_MARGIN = 4;			///< Margin added to tile when culling objects [px]
+
+/// Job rendering single tile
+class TileJob : public QRunnable
+{
+public:
+	TileJob( World* pWorld, TiledRenderer::Tile* pTile, const QTransform& transform, QPainter::RenderHints hints )
+		: _pWorld( pWorld ), _pTile( pTile ), _transform( transform ), _hints( hints )
+	{
+		setAutoDelete( true );
+	}
+
+	virtual void run()
+	{
+		_pTile->image.fill( 0 ); // transparent
+
+		QPainter painter( & _pTile->image );
+		painter.setRenderHints( _hints );
+
+		// move tile's top-left corner to image origin
+		QTransform t = _transform * QTransform( 1, 0, 0, 1, -_pTile->rect.x(), -_pTile->rect.y() );
+		painter.setTransform( t );
+
+		_pWorld->renderObjects( painter, _pTile->worldRect, _pTile->objects );
+	}
+
+private:
+	World*					_pWorld;
+	TiledRenderer::Tile*	_pTile;
+	QTransform				_transform;
+	QPainter::RenderHints	_hints;
+};
+
+// ============================================================================
+// Constructor
+TiledRenderer::TiledRenderer( World* pWorld ) : _pWorld( pWorld )
+{
+	Q_ASSERT( pWorld );
+	_tileSize = DEFAULT_TILE_SIZE;
+	_threads = 0;
+	setThreads( QThread::idealThreadCount() );
+}
+
+// ============================================================================
+// Destructor
+TiledRenderer::~TiledRenderer()
+{
+	_pool.waitForDone();
+}
+
+// ============================================================================
+/// Sets number of rendering threads.
+void TiledRenderer::setThreads( int threads )
+{
+	_threads = qMax( 1, threads );
+	_pool.setMaxThreadCount( _threads );
+}
+
+// ============================================================================
+/// Sets tile size. Tile images are re-created during next render.
+void TiledRenderer::setTileSize( int size )
+{
+	if ( size != _tileSize )
+	{
+		_tileSize = qMax( 16, size );
+		_tiles.clear();
+	}
+}
+
+// ============================================================================
+/// Renders objects. \b rect is area in world coordinates, painter's transformation
+/// is used to map it to device pixels. Objects are expected to be ordered by layer.
+void TiledRenderer::render( QPainter& painter, const QRectF& rect, const QList<WorldObject*>& objects )
+{
+	QPaintDevice* pDevice = painter.device();
+	Q_ASSERT( pDevice );
+
+	QTransform transform = painter.transform();
+	QTransform inverted = transform.inverted();
+
+	QRect deviceRect = transform.mapRect( rect ).toAlignedRect() & QRect( 0, 0, pDevice->width(), pDevice->height() );
+	if ( deviceRect.isEmpty() )
+	{
+		return;
+	}
+
+	// layout tiles
+	int cols = ( deviceRect.width() + _tileSize - 1 ) / _tileSize;
+	int rows = ( deviceRect.height() + _tileSize - 1 ) / _tileSize;
+	_tiles.resize( cols * rows );
+
+	// collect objects for each tile
+	QVector<QRectF> boundingRects( objects.size() );
+	for( int i = 0; i < objects.size(); i++ )
+	{
+		boundingRects[i] = objects[i]->boundingRect();
+	}
+
+	for( int row = 0; row < rows; row++ )
+	{
+		for( int col = 0; col < cols; col++ )
+		{
+			Tile& tile = _tiles[ row*cols + col ];
+			tile.rect = QRect( deviceRect.left() + col*_tileSize, deviceRect.top() + row*_tileSize, _tileSize, _tileSize ) & deviceRect;
+			tile.worldRect = inverted.mapRect( QRectF( tile.rect ) );
+
+			// few pixels of margin for pens and antialiasing
+			QRectF cullRect = inverted.mapRect( QRectF( tile.rect.adjusted( -CULL_MARGIN, -CULL_MARGIN, CULL_MARGIN, CULL_MARGIN ) ) );
+
+			tile.objects.clear();
+			for( int i = 0; i < objects.size(); i++ )
+			{
+				// objects w/o bounding rect are always rendered
+				if ( boundingRects[i].isNull() || boundingRects[i].intersects( cullRect ) )
+				{
+					tile.objects.append( objects[i] );
+				}
+			}
+
+			if ( tile.objects.isEmpty() )
+			{
+				continue;
+			}
+
+			if ( tile.image.size() != tile.rect.size() )
+			{
+				tile.image = QImage( tile.rect.size(), QImage::Format_ARGB32_Premultiplied );
+			}
+
+			_pool.start( new TileJob( _pWorld, & tile, transform, painter.renderHints() ) );
+		}
+	}
+
+	_pool.waitForDone();
+
+	// composite
+	painter.save();
+		painter.resetTransform();
+		foreach( const Tile& tile, _tiles )
+		{
+			if ( ! tile.objects.isEmpty() )
+			{
+				painter.drawImage( tile.rect.topLeft(), tile.image );
+			}
+		}
+	painter.restore();
+}
+
+}
+
+// EOF
+
+
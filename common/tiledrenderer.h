@@ -0,0 +1,84 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef FLYERTILEDRENDERER_H
+#define FLYERTILEDRENDERER_H
+
+#include <QList>
+#include <QVector>
+#include <QImage>
+#include <QRect>
+#include <QThreadPool>
+
+class QPainter;
+
+namespace Flyer
+{
+
+class World;
+class WorldObject;
+
+/**
+	Software renderer which splits viewport into screen tiles and renders
+	each tile on separate thread, into separate image. Tiles are then composited
+	onto target painter.
+	Used only with raster painters - OpenGL painter renders on the caller's thread.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class TiledRenderer
+{
+public:
+	TiledRenderer( World* pWorld );
+	~TiledRenderer();
+
+	/// Sets number of rendering threads
+	void setThreads( int threads );
+	/// Returns number of rendering threads
+	int threads() const { return _threads; }
+
+	/// Sets tile size [px]
+	void setTileSize( int size );
+	/// Returns tile size [px]
+	int tileSize() const { return _tileSize; }
+
+	/// Renders list of objects (ordered by render layer) on painter
+	void render( QPainter& painter, const QRectF& rect, const QList<WorldObject*>& objects );
+
+	/// Single screen tile
+	struct Tile
+	{
+		QRect	rect;					///< Tile rect, in device pixels
+		QRectF	worldRect;				///< Tile rect in world coordinates
+		QImage	image;					///< Tile image
+		QList<WorldObject*>	objects;	///< Objects intersecting the tile
+	};
+
+private:
+
+	World*			_pWorld;		///< Rendered world
+	QThreadPool		_pool;			///< Rendering threads
+	int				_threads;		///< Number of threads
+	int				_tileSize;		///< Tile size [px]
+	QVector<Tile>	_tiles;			///< Tiles, reused between frames
+};
+
+}
+
+#endif // FLYERTILEDRENDERER_H
+
+// EOF
+
+
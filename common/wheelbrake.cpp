@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "wheelbrake.h"
 #include "joint.h"
 
@@ -76,4 +78,18 @@ double WheelBrake::status() const
 	return _currentTorque / _brakingTorque;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void WheelBrake::saveState( QDataStream& stream ) const
+{
+	stream << _on << _currentTorque;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void WheelBrake::restoreState( QDataStream& stream )
+{
+	stream >> _on >> _currentTorque;
+}
+
 }
@@ -45,6 +45,11 @@ public:
 	
 	void setBrakingTorque( double t ) { _brakingTorque = t; _currentTorque = t; }
 	void setJoint( Joint* pJoint ) { _pJoint = pJoint; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 private:
 
@@ -14,6 +14,8 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QDataStream>
+
 #include "wing.h"
 #include "plane.h"
 #include "world.h"
@@ -64,6 +66,20 @@ QPointF Wing::calculateForce ( double velocity, double sinAttack ) const
 	return QPointF( drag, lift );	
 }
 
+// ============================================================================
+/// Returns current coefficients, including flaps.
+AeroKernel::Coefficients Wing::coefficients() const
+{
+	AeroKernel::Coefficients c;
+	c.inclination = _inclination*parent()->orientation();
+	c.lift = _currentLift + _flapsLift*_flaps;
+	c.dragH = _currentDragH + _flapsDrag*_flaps;
+	c.dragV = _currentDragV;
+	c.densityFactor = 1.0;
+	
+	return c;
+}
+
 // ============================================================================
 // Renders wing
 void Wing::render( QPainter& painter, const QRectF& /*rect*/, const RenderingOptions& /*options*/ )
@@ -176,4 +192,20 @@ void Wing::destroy()
 	_currentDragV = _dragCoeffV * DAMAGED_DRAGV;
 }
 
+// ============================================================================
+/// Writes dynamic state to snapshot stream
+void Wing::saveState( QDataStream& stream ) const
+{
+	Surface::saveState( stream );
+	stream << _flaps << _currentFlapsMax << _currentFlapsMin;
+}
+
+// ============================================================================
+/// Restores dynamic state from snapshot stream
+void Wing::restoreState( QDataStream& stream )
+{
+	Surface::restoreState( stream );
+	stream >> _flaps >> _currentFlapsMax >> _currentFlapsMin;
+}
+
 }
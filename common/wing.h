@@ -44,9 +44,15 @@ public:
 	
 	void setFlaps( double f );
 	double flaps() const { return _flaps; }
+	
+	// snapshots
+	
+	virtual void saveState( QDataStream& stream ) const;
+	virtual void restoreState( QDataStream& stream );
 
 protected:
 	virtual QPointF calculateForce ( double velocity, double sinAttack ) const;
+	virtual AeroKernel::Coefficients coefficients() const;
 	
 	// config
 	double	_flapsDrag;			///< Extra drag when flaps are at max
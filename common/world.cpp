@@ -14,6 +14,9 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
+#include <QVector>
+#include <QtAlgorithms>
+
 #include "Box2D.h"
 
 #include "ground.h"
@@ -25,6 +28,16 @@
 #include "machine.h"
 #include "pilot.h"
 #include "plane.h"
+#include "tiledrenderer.h"
+#include "layercache.h"
+#include "worldstreamer.h"
+#include "projectilesystem.h"
+#include "threatindex.h"
+#include "simulationscheduler.h"
+#include "aerokernel.h"
+#include "physicalobject.h"
+#include "body.h"
+#include "textureprovider.h"
 
 #include "world.h"
 
@@ -35,18 +48,29 @@ namespace Flyer {
 
 static const double	TIMESTEP = 1.0/60.0; 	// [s]
 static const int	ITERATIONS = 10;		// solver iterations
+static const int	SKY_MARGIN = 256;		///< Vertical margin of cached sky image [px]
+static const int	CONTACT_EVENTS_RESERVE = 256;	///< Initial capacity of contact event buffers
 
 
 
 
 /// Contact listener. Internal class which implements listenrr interface and 
-/// propagates contact information to system.
+/// propagates contact information to system. Contact results are only collected during
+/// the step, damage is applied after the step by process(), once per body.
 class WorldContactListener : public b2ContactListener
 {
+public:
+	WorldContactListener()
+	{
+		_events.reserve( CONTACT_EVENTS_RESERVE );
+		_batch.reserve( CONTACT_EVENTS_RESERVE );
+		_touching.reserve( CONTACT_EVENTS_RESERVE );
+	}
+	
 	/// Contact callback
 	virtual void Result(const b2ContactResult* pPoint )
 	{
-		// apply damage to directly involved shapes
+		// collect damage of directly involved shapes
 		void *pData1 = pPoint->shape1->GetBody()->GetUserData();
 		void *pData2 = pPoint->shape2->GetBody()->GetUserData();
 		double force = pPoint->normalImpulse / TIMESTEP;
@@ -62,14 +86,84 @@ class WorldContactListener : public b2ContactListener
 		
 		if ( pBody1 )
 		{
-			pBody1->contact( multiplier2 * force );
+			addEvent( pBody1, multiplier2 * force );
 		}
 		if ( pBody2 )
 		{
-			pBody2->contact(multiplier1 * force );
+			addEvent( pBody2, multiplier1 * force );
+		}
+	}
+	
+	/// Bodies which had contacts during last step, sorted. Bodies destroyed by damage may be included.
+	const QVector<Body*>& touching() const { return _touching; }
+	
+	/// Applies forces collected during the step. Each body receives only its strongest
+	/// contact, so damage doesn't depend on number of contact points. Bodies are processed
+	/// in order of their first contact, so results don't depend on body addresses.
+	void process()
+	{
+		_touching.resize( 0 );
+		if ( _events.isEmpty() )
+		{
+			return;
+		}
+		
+		// group by body, strongest contact of each body goes to batch
+		qSort( _events.begin(), _events.end() );
+		_batch.resize( 0 );
+		int i = 0;
+		while( i < _events.size() )
+		{
+			Event strongest = _events[i];
+			for( i++; i < _events.size() && _events[i].pBody == strongest.pBody; i++ )
+			{
+				strongest.force = qMax( strongest.force, _events[i].force );
+			}
+			_batch.append( strongest );
+		}
+		_events.resize( 0 );
+		
+		// batch is sorted by body now
+		for( int b = 0; b < _batch.size(); b++ )
+		{
+			_touching.append( _batch[b].pBody );
+		}
+		
+		qSort( _batch.begin(), _batch.end(), Event::earlier );
+		for( int b = 0; b < _batch.size(); b++ )
+		{
+			_batch[b].pBody->contact( _batch[b].force );
+		}
+	}
+	
+private:
+	
+	/// Contact force received by body
+	struct Event
+	{
+		Body*	pBody;	///< Body
+		double	force;	///< Contact force
+		int		order;	///< Order of arrival during the step
+		
+		bool operator < ( const Event& other ) const
+		{
+			return pBody < other.pBody || ( pBody == other.pBody && order < other.order );
 		}
+		static bool earlier( const Event& a, const Event& b ) { return a.order < b.order; }
+	};
+	
+	void addEvent( Body* pBody, double force )
+	{
+		Event event;
+		event.pBody = pBody;
+		event.force = force;
+		event.order = _events.size();
+		_events.append( event );
 	}
 	
+	QVector<Event>	_events;	///< Contacts collected during the step
+	QVector<Event>	_batch;		///< Strongest contact of each body, in order of first contact
+	QVector<Body*>	_touching;	///< Bodies which had contacts during last step, sorted
 };
 	
 /// Destruction listener class.
@@ -112,10 +206,12 @@ public:
 	{
 		lastRenderedIn = -1;
 		proxyId = -1;
+		objectClass = 0;
 	}
 	
-	int lastRenderedIn;	///< No of step when the body was last renderd. Used ot prevent multiple rendering
+	int lastRenderedIn;	///< No of render query in which object was last found. Used ot prevent multiple rendering
 	int proxyId;		///< Id of proxy in decorations broadphase
+	int objectClass;	///< Object class, as passed to addObject()
 };
 
 // ============================================================================
@@ -129,6 +225,7 @@ World::World( const QRectF& boundary )
 	_lastKnownHealth = 1.0;
 	
 	_boundary = boundary;
+	_environment.setBoundary( _boundary );
 	// create world
 	b2AABB worldAABB = rect2aabb( _boundary );
 	
@@ -139,7 +236,8 @@ World::World( const QRectF& boundary )
 	_pDecorationBroadPhase = new b2BroadPhase( worldAABB, new NullPairCallback() );
 	
 	// add contact listener to detect damage
-	_pb2World->SetContactListener( new WorldContactListener() );
+	_pContactListener = new WorldContactListener();
+	_pb2World->SetContactListener( _pContactListener );
 	
 	// add destruction listener
 	_pb2World->SetDestructionListener( new DestructionListener() );
@@ -147,7 +245,20 @@ World::World( const QRectF& boundary )
 	
 	// init pointers
 	_pGround		= NULL;
+	_pStreamer		= NULL;
 	_pPlayer		= NULL;
+	_pTiledRenderer	= NULL;
+	
+	_pProjectiles = new ProjectileSystem( this );
+	_pThreats = new ThreatIndex( this );
+	_pScheduler = new SimulationScheduler( this );
+	_pAeroKernel = new AeroKernel();
+	
+	// layer caching
+	_pBackgroundCache = new LayerCache( this );
+	_layerCaching = true;
+	_renderQueries = 0;
+	_bakedTextures = 0;
 	
 	// sky gradient
 	_skyGradient.setStart( _boundary.left() + _boundary.width()/ 2, _boundary.top() );
@@ -162,6 +273,14 @@ World::World( const QRectF& boundary )
 // Destructor
 World::~World()
 {
+	delete _pStreamer;
+	delete _pProjectiles;
+	delete _pThreats;
+	delete _pScheduler;
+	delete _pAeroKernel;
+	delete _pContactListener;
+	delete _pTiledRenderer;
+	delete _pBackgroundCache;
 }
 
 // ============================================================================
@@ -175,16 +294,83 @@ void World::render( QPainter& painter, const QRectF& rect )
 		return;
 	}
 	
+	// bake textures of bodies created while textures were loading. Done here, on main thread,
+	// as objects may be rendered by many threads. Background cache could contain
+	// objects drawn with placeholders, redraw it.
+	int loadedTextures = TextureProvider::loadedTextures();
+	if ( loadedTextures >= 0 && loadedTextures != _bakedTextures )
+	{
+		foreach( WorldObject* pObject, _allObjects )
+		{
+			bakeTextures( pObject );
+		}
+		_pBackgroundCache->invalidate();
+		_bakedTextures = loadedTextures;
+	}
+	
 	// render athmosphere
 	renderAthmosphere( painter, rect );
 	
 	// bug workartound ?  first pait something with vcectors
 	painter.drawLine( QPointF( 1, 1 ), QPointF( 2, 2 ) );
-	RenderingOptions options;
 	
-	options.viewportSize = rect.size().toSize(); // NOTE this may be inaccurate
+	// render cached static background
+	RenderFilter filter = FilterNone;
+	if ( _layerCaching && _pBackgroundCache->render( painter, rect ) )
+	{
+		filter = FilterUncached;
+	}
+	
+	QList<WorldObject*> objectsToRender = findObjectsToRender( rect, filter );
+	
+	// TODO debug
+	//qDebug("Rendering %d of %d renderable objects"
+	//	, objectsToRender.size(), _objects[ObjectRendered].size() );
+	
+	// render objects. OpenGL painter can't be used from other threads
+	if ( _pTiledRenderer && ! isOpenGL( & painter ) )
+	{
+		_pTiledRenderer->render( painter, rect, objectsToRender );
+	}
+	else
+	{
+		renderObjects( painter, rect, objectsToRender );
+	}
+	
+	// gun rounds, above all objects
+	_pProjectiles->render( painter, rect );
+	
+	// redner pilot's health blindshield
+	if( _pPlayer )
+	{
+		_lastKnownHealth = _pPlayer->status();
+	}
+	
+	{
+		double alpha = 0.0;
+		if ( _lastKnownHealth < 0.75 )
+		{
+			alpha = 0.5 * ( 1 - ( _lastKnownHealth / 0.75 ) );
+			if ( alpha > 0.02 )
+			{
+				QColor color( 192, 0, 0, 255*alpha );
+				painter.fillRect( _boundary, color );
+			}
+		}
+	}
+	
+	_renders ++;
+}
+
+// ============================================================================
+/// Finds objects visible in rect, using both Box2D and decoration broadphases.
+/// Returned list is ordered by render layer. \b filter selects objects depending
+/// on whether they are rendered by the layer cache.
+QList<WorldObject*> World::findObjectsToRender( const QRectF& rect, RenderFilter filter )
+{
+	_renderQueries ++;
 	
-	// get objects to be rendered in this bounding rect (TODO: use broadphase here)
+	// get objects to be rendered in this bounding rect
 	QMultiMap<int, WorldObject* > objectsToRender;
 	{
 		const int MAX_SHAPES = 2048; // max shapes in visible area. wild guess
@@ -205,10 +391,13 @@ void World::render( QPainter& painter, const QRectF& rect )
 				Q_ASSERT( pObject );
 				
 				ObjectPrivateData* pPrivate = static_cast<ObjectPrivateData*>( pObject->worldPrivateData );
-				if ( pPrivate && pPrivate->lastRenderedIn != _renders ) // NOTE body may be alredy destroye and thus not have private data attached
+				if ( pPrivate && pPrivate->lastRenderedIn != _renderQueries ) // NOTE body may be alredy destroye and thus not have private data attached
 				{
-					pPrivate->lastRenderedIn = _renders;
-					objectsToRender.insert( pObject->renderLayer(), pObject );
+					pPrivate->lastRenderedIn = _renderQueries;
+					if ( filter == FilterNone || ( filter == FilterCached ) == isCached( pObject ) )
+					{
+						objectsToRender.insert( pObject->renderLayer(), pObject );
+					}
 				}
 			}
 		}
@@ -228,23 +417,30 @@ void World::render( QPainter& painter, const QRectF& rect )
 			WorldObject* pObject = ojects[i];
 			
 			ObjectPrivateData* pPrivate = static_cast<ObjectPrivateData*>( pObject->worldPrivateData );
-			if ( pPrivate && pPrivate->lastRenderedIn != _renders ) // NOTE object may be alredy destroye and thus not have private data attached
+			if ( pPrivate && pPrivate->lastRenderedIn != _renderQueries ) // NOTE object may be alredy destroye and thus not have private data attached
 			{
-				pPrivate->lastRenderedIn = _renders;
-				objectsToRender.insert( pObject->renderLayer(), pObject );
+				pPrivate->lastRenderedIn = _renderQueries;
+				if ( filter == FilterNone || ( filter == FilterCached ) == isCached( pObject ) )
+				{
+					objectsToRender.insert( pObject->renderLayer(), pObject );
+				}
 			}
 		}
 	}
 	
+	return objectsToRender.values();
+}
+
+// ============================================================================
+/// Renders objects on painter. Objects are rendered in list order. Doesn't modify
+/// the world, so can be called from multiple threads, each with it's own painter.
+void World::renderObjects( QPainter& painter, const QRectF& rect, const QList<WorldObject*>& objects ) const
+{
+	RenderingOptions options;
 	
+	options.viewportSize = rect.size().toSize(); // NOTE this may be inaccurate
 	
-	// TODO debug
-	//qDebug("Rendering %d of %d renderable objects"
-	//	, objectsToRender.size(), _objects[ObjectRendered].size() );
-	
-	
-	// render objects
-	foreach( WorldObject* pObject, objectsToRender.values() )
+	foreach( WorldObject* pObject, objects )
 	{
 		// TODO looks ugly
 		int layer = pObject->renderLayer();
@@ -260,34 +456,90 @@ void World::render( QPainter& painter, const QRectF& rect )
 		pObject->render( painter, rect, options );
 		//qDebug("Rendering item %s on layer %d", qPrintable( pObject->name() ), pObject->renderLayer() );
 	}
-	
-	// redner pilot's health blindshield
-	if( _pPlayer )
-	{
-		_lastKnownHealth = _pPlayer->status();
-	}
-	
+}
+
+// ============================================================================
+/// Sets number of threads used to render the world. When set to non-zero, and
+/// the painter is not OpenGL, viewport is split into tiles rendered in parallel.
+void World::setRenderThreads( int threads )
+{
+	if ( threads > 0 )
 	{
-		double alpha = 0.0;
-		if ( _lastKnownHealth < 0.75 )
+		if ( ! _pTiledRenderer )
 		{
-			alpha = 0.5 * ( 1 - ( _lastKnownHealth / 0.75 ) );
-			if ( alpha > 0.02 )
-			{
-				QColor color( 192, 0, 0, 255*alpha );
-				painter.fillRect( _boundary, color );
-			}
+			_pTiledRenderer = new TiledRenderer( this );
 		}
+		_pTiledRenderer->setThreads( threads );
+	}
+	else
+	{
+		delete _pTiledRenderer;
+		_pTiledRenderer = NULL;
 	}
+}
+
+// ============================================================================
+/// Returns number of rendering threads. 0 means rendering on caller's thread.
+int World::renderThreads() const
+{
+	return _pTiledRenderer ? _pTiledRenderer->threads() : 0;
+}
+
+// ============================================================================
+/// Checks if object is rendered by layer cache. Cached are static objects from background layer.
+bool World::isCached( WorldObject* pObject ) const
+{
+	ObjectPrivateData* pPrivate = static_cast<ObjectPrivateData*>( pObject->worldPrivateData );
 	
-	_renders ++;
+	return pObject->renderLayer() == LayerBackground
+		&& pPrivate && ! ( pPrivate->objectClass & ObjectSimulated );
 }
 
 // ============================================================================
-/// Renders world's athmosphere
+/// Enables or disables caching of sky and static background objects.
+void World::setLayerCaching( bool enabled )
+{
+	_layerCaching = enabled;
+	_pBackgroundCache->invalidate();
+	_skyImage = QImage();
+}
+
+// ============================================================================
+/// Renders world's athmosphere. Sky gradient is vertical, so it is cached as device-sized
+/// image, with some vertical margin. The image is re-rendered only when device is resized,
+/// zoom changes or camera moves vertically beyond the margin.
 void World::renderAthmosphere( QPainter& painter, const QRectF& )
 {
-	painter.fillRect( _boundary, _skyGradient );
+	QTransform t = painter.transform();
+	QPaintDevice* pDevice = painter.device();
+	
+	// boundary has to cover whole device width for cached image to be valid
+	QRectF deviceBoundary = t.mapRect( _boundary );
+	if ( ! _layerCaching || t.type() > QTransform::TxScale || ! pDevice
+		|| deviceBoundary.left() > 0 || deviceBoundary.right() < pDevice->width() )
+	{
+		painter.fillRect( _boundary, _skyGradient );
+		return;
+	}
+	
+	if ( _skyImage.width() != pDevice->width()
+		|| _skyImage.height() != pDevice->height() + 2*SKY_MARGIN
+		|| t.m22() != _skyTransform.m22()
+		|| qAbs( t.dy() - _skyTransform.dy() ) > SKY_MARGIN )
+	{
+		_skyTransform = t;
+		_skyImage = QImage( pDevice->width(), pDevice->height() + 2*SKY_MARGIN, QImage::Format_ARGB32_Premultiplied );
+		_skyImage.fill( 0 );
+		
+		QPainter skyPainter( & _skyImage );
+		skyPainter.setTransform( t * QTransform( 1, 0, 0, 1, 0, SKY_MARGIN ) );
+		skyPainter.fillRect( _boundary, _skyGradient );
+	}
+	
+	painter.save();
+		painter.resetTransform();
+		painter.drawImage( QPointF( 0, t.dy() - _skyTransform.dy() - SKY_MARGIN ), _skyImage );
+	painter.restore();
 }
 
 // ============================================================================
@@ -306,13 +558,39 @@ void World::renderMap( QPainter& painter, const QRectF& rect )
 // ============================================================================
 // Initializes random ground
 void World::initRandomGround( const QList<Ground::Section>& seed )
+{
+	Ground* pGround = new Ground( this );
+	pGround->random( seed );
+	setGround( pGround );
+}
+
+// ============================================================================
+/// Sets ground, initialized by caller, and adds it to the world.
+void World::setGround( Ground* pGround )
 {
 	Q_ASSERT( ! _pGround );
-	_pGround = new Ground( this );
-	_pGround->random( seed );
+	_pGround = pGround;
 	addObject( _pGround, ObjectRenderedMap );
 }
 
+// ============================================================================
+/// Enables streaming. World takes ownership of the streamer. Ground's terrain is
+/// released, and only chunks around the player are created. Should be called
+/// after ground is set.
+void World::setStreamer( WorldStreamer* pStreamer )
+{
+	Q_ASSERT( ! _pStreamer && pStreamer );
+	_pStreamer = pStreamer;
+	
+	if ( _pGround )
+	{
+		_pGround->releaseTerrain();
+	}
+	
+	Plane* pPlane = playerPlane();
+	_pStreamer->update( pPlane ? pPlane->position().x() : _pStreamer->center() );
+}
+
 // ============================================================================
 // Sets player planme
 void World::setPlayer( Pilot* pPilot )
@@ -495,14 +773,18 @@ void World::simulate( double dt )
 	qDeleteAll( _objectsToDestroy );
 	_objectsToDestroy.clear();
 	
+	_environment.simulate( dt );
+	
 	int iters = dt/TIMESTEP; // sub iterations here
 	for( int i = 0; i < iters; i++ )
 	{
+		_pScheduler->prepareStep( dt/iters );
 		_pb2World->Step( dt/iters, ITERATIONS );
-		foreach ( WorldObject* pObject, _objects[ ObjectSimulated] )
-		{
-			pObject->simulate( dt/iters );
-		}
+		_pContactListener->process();
+		_pThreats->update();
+		_pProjectiles->simulate( dt/iters );
+		_pScheduler->simulate( dt/iters, _pContactListener->touching() );
+		_pAeroKernel->apply( &_environment ); // forces registered by objects
 	}
 	// call 1-second timer, if it is it's time
 	if ( _timer1Time >= 1.0 )
@@ -512,6 +794,13 @@ void World::simulate( double dt )
 		{
 			pObject->timer1();
 		}
+		
+		// follow the player with active chunks
+		if ( _pStreamer )
+		{
+			Plane* pPlane = playerPlane();
+			_pStreamer->update( pPlane ? pPlane->position().x() : _pStreamer->center() );
+		}
 	}
 	_timer1Time += dt;
 	
@@ -553,6 +842,26 @@ void World::addObject( WorldObject* pObject, int objectClass )
 	{
 		pObject->worldPrivateData = new ObjectPrivateData();
 	}
+	static_cast<ObjectPrivateData*>( pObject->worldPrivateData )->objectClass = objectClass;
+	
+	// object could be created before its textures were loaded
+	bakeTextures( pObject );
+	
+	objectChanged( pObject );
+}
+
+// ============================================================================
+/// Bakes textures limited to shape of object's bodies, if they are not baked yet.
+void World::bakeTextures( WorldObject* pObject )
+{
+	PhysicalObject* pPhysical = dynamic_cast<PhysicalObject*>( pObject );
+	if ( pPhysical )
+	{
+		foreach( Body* pBody, pPhysical->bodies() )
+		{
+			pBody->bakeTexture();
+		}
+	}
 }
 
 // ============================================================================
@@ -568,6 +877,7 @@ void World::removeObject( WorldObject* pObject, bool destroy )
 		int bit = 1 << i;
 		_objects[bit].removeAll( pObject );
 	}
+	_pScheduler->removeObject( pObject );
 	
 	// add to destruction queue, if desired
 	if ( destroy )
@@ -575,6 +885,9 @@ void World::removeObject( WorldObject* pObject, bool destroy )
 		_objectsToDestroy.append( pObject );
 	}
 	
+	// remove from layer cache
+	objectChanged( pObject );
+	
 	// remove private data
 	ObjectPrivateData* pPrivate = static_cast<ObjectPrivateData*>( pObject->worldPrivateData );
 	if ( pPrivate )
@@ -597,6 +910,29 @@ void World::removeObject( WorldObject* pObject, bool destroy )
 	}
 }
 
+// ============================================================================
+/// Returns object class, as passed to addObject(). Returns 0 if object is not in the world.
+int World::objectClass( const WorldObject* pObject ) const
+{
+	const ObjectPrivateData* pPrivate = static_cast<const ObjectPrivateData*>( pObject->worldPrivateData );
+	if ( pPrivate )
+	{
+		return pPrivate->objectClass;
+	}
+	
+	return 0;
+}
+
+// ============================================================================
+/// Notifies world that object was changed in way which affects its cached rendering.
+void World::objectChanged( WorldObject* pObject )
+{
+	if ( pObject->worldPrivateData && isCached( pObject ) )
+	{
+		_pBackgroundCache->invalidate();
+	}
+}
+
 // ============================================================================
 // Returns timestep
 double World::timestep() const
@@ -22,6 +22,8 @@
 #include <QMap>
 #include <QLinkedList>
 #include <QLinearGradient>
+#include <QImage>
+#include <QTransform>
 
 #include "worldobject.h"
 #include "environment.h"
@@ -37,6 +39,15 @@ class Plane;
 class Ground;
 class Machine;
 class Pilot;
+class TiledRenderer;
+class LayerCache;
+class WorldSnapshot;
+class WorldStreamer;
+class ProjectileSystem;
+class WorldContactListener;
+class ThreatIndex;
+class SimulationScheduler;
+class AeroKernel;
 
 /**
 	Main world object. Holds Box2d world, and controls simulation.
@@ -68,13 +79,22 @@ public:
 	};
 	
 
+	/// Render list filters
+	enum RenderFilter {
+		FilterNone,					///< All visible objects
+		FilterUncached,				///< Objects not rendered by layer cache
+		FilterCached				///< Only objects rendered by layer cache
+	};
+
 	World( const QRectF& boundary );
 	virtual ~World();
 
 	// initialization
 	
 	void initRandomGround( const QList<Ground::Section>& seed );
+	void setGround( Ground* pGround );
 	void setPlayer( Pilot* pPilot );
+	void setStreamer( WorldStreamer* pStreamer );
 	
 	// other
 
@@ -84,6 +104,24 @@ public:
 	/// Renders map of the world
 	void renderMap( QPainter& painter, const QRectF& rect );
 	
+	/// Renders list of objects. Used by renderers, may be called from multiple threads.
+	void renderObjects( QPainter& painter, const QRectF& rect, const QList<WorldObject*>& objects ) const;
+	
+	/// Finds objects to be rendered in rect, ordered by render layer
+	QList<WorldObject*> findObjectsToRender( const QRectF& rect, RenderFilter filter = FilterNone );
+	
+	/// Enables/disables caching of sky and static background layer
+	void setLayerCaching( bool enabled );
+	
+	/// Returns if sky and background layer are cached
+	bool layerCaching() const { return _layerCaching; }
+	
+	/// Sets number of rendering threads. 0 renders on caller's thread.
+	void setRenderThreads( int threads );
+	
+	/// Returns number of rendering threads
+	int renderThreads() const;
+	
 	/// Simlation step
 	void simulate( double dt );
 	
@@ -101,16 +139,36 @@ public:
 	
 	/// Return environment
 	const Environment* environment() const { return & _environment; }
+	/// Return environment, for setting up weather
+	Environment* environment() { return & _environment; }
 	
 	/// Returns ground object
 	const Ground* ground() const { return _pGround; }
 	
+	/// Returns streamer, or NULL if world is not streamed
+	WorldStreamer* streamer() const { return _pStreamer; }
+	
+	/// Returns lightweight gun rounds
+	ProjectileSystem* projectiles() const { return _pProjectiles; }
+	
+	/// Returns index of targetable machines, rebuilt each simulation step
+	const ThreatIndex* threats() const { return _pThreats; }
+	
+	/// Returns scheduler, which simulates objects with distance-dependent level of detail
+	SimulationScheduler* scheduler() const { return _pScheduler; }
+	
+	/// Returns kernel calculating aerodynamic forces of all surfaces and engines
+	AeroKernel* aeroKernel() const { return _pAeroKernel; }
+	
 	/// Adds object to the world
 	void addObject( WorldObject* pObject, int objectClass );
 	
 	/// Removes object from world
 	void removeObject( WorldObject* pObject, bool destroy = true );
 	
+	/// Notifies world that object's appearance has changed
+	void objectChanged( WorldObject* pObject );
+	
 	/// Returns timestep used in simulation
 	double timestep() const;
 	
@@ -125,6 +183,9 @@ public:
 	/// Finds machines in specified area
 	QList<Machine*> findMachines( const QRectF& area, int types ) const;
 	
+	/// Returns side (ObjectSide1 or ObjectSide2 bit) object was added with, 0 if neutral
+	int objectSide( const WorldObject* pObject ) const { return objectClass( pObject ) & ( ObjectSide1 | ObjectSide2 ); }
+	
 	
 	// decoration
 	
@@ -139,7 +200,14 @@ public:
 	
 private:
 	
+	friend class WorldSnapshot;
+	friend class WorldStreamer;
+	friend class ThreatIndex;
+	friend class SimulationScheduler;
+	
 	void initWorld();
+	
+	int objectClass( const WorldObject* pObject ) const;	///< Returns class object was added with
 
 	QList<WorldObject*> _allObjects;	///< List of objects
 	QList<WorldObject*> _timer1Objects;	///< Objects connected to 1-second timer.
@@ -148,8 +216,14 @@ private:
 	QMap< int, QList<WorldObject*> >	_objects;
 	
 	b2World*	_pb2World;			///< Box2d world
+	WorldContactListener*	_pContactListener;	///< Collects contact damage during the step
 	Pilot*	_pPlayer;				///< Player
 	Ground*	_pGround;				///< Ground body
+	WorldStreamer*	_pStreamer;		///< Chunk streamer [optional]
+	ProjectileSystem*	_pProjectiles;	///< Gun rounds
+	ThreatIndex*		_pThreats;		///< Targetable machines
+	SimulationScheduler*	_pScheduler;	///< Simulates objects
+	AeroKernel*		_pAeroKernel;	///< Aerodynamic forces
 	QRectF	_boundary;				///< World boundary
 	Environment	_environment;		///< Environment data
 	b2BroadPhase*	_pDecorationBroadPhase;	///< Spatal database of non-physical objects
@@ -160,6 +234,17 @@ private:
 	
 	void renderAthmosphere( QPainter& painter, const QRectF& rect );
 	QLinearGradient	_skyGradient;	///< sky gradient (experimental)
+	QImage			_skyImage;		///< Cached sky, in device pixels
+	QTransform		_skyTransform;	///< Transformation used to render cached sky
+	
+	bool isCached( WorldObject* pObject ) const;	///< Checks if object is rendered by layer cache
+	void bakeTextures( WorldObject* pObject );		///< Bakes textures of object's bodies, if not baked yet
+	
+	TiledRenderer*	_pTiledRenderer;	///< Multi-threaded renderer [optional]
+	LayerCache*		_pBackgroundCache;	///< Cache of static background objects
+	bool			_layerCaching;		///< If layer caching is enabled
+	int				_renderQueries;		///< Render queries so far. Used to remove duplicates from query results
+	int				_bakedTextures;		///< Textures loaded when bodies' textures were last baked
 	
 	int		_steps;					///< Simulation steps so far
 	int		_renders;				///< Renders so far
@@ -20,10 +20,13 @@
 #include <QList>
 #include <QPainter>
 
+class QDataStream;
+
 namespace Flyer {
 
 class World;
 class RenderingOptions;
+class WorldSnapshot;
 
 /**
 	Common base class for objects managed by world.
@@ -73,6 +76,23 @@ public:
 	
 	QList<WorldObject*> children() const { return _children; }
 	
+	// snapshots
+	
+	/// Returns class name used in world snapshots. Objects with empty class are not stored.
+	virtual QString snapshotClass() const { return QString(); }
+	
+	/// Checks if object is short-lived effect. Transient objects are stored in snapshots, but never parked by streamer.
+	virtual bool transient() const { return false; }
+	
+	/// Writes parameters required to re-create the object
+	virtual void saveParams( QDataStream& /*stream*/ ) const {}
+	
+	/// Writes dynamic state
+	virtual void saveState( QDataStream& /*stream*/, const WorldSnapshot& /*snapshot*/ ) const {}
+	
+	/// Restores dynamic state, written by saveState()
+	virtual void restoreState( QDataStream& /*stream*/, const WorldSnapshot& /*snapshot*/ ) {}
+	
 	// other
 	
 	void* worldPrivateData;		///< The world can use it to it's sinister practices.
@@ -0,0 +1,522 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <QDataStream>
+
+#include "world.h"
+#include "ground.h"
+#include "building.h"
+#include "airfield.h"
+#include "landinglight.h"
+#include "hangar.h"
+#include "antiairbattery.h"
+#include "planebumblebee.h"
+#include "ironbomb.h"
+#include "shrapnel.h"
+#include "explosion.h"
+#include "particlesystem.h"
+#include "projectilesystem.h"
+#include "pilot.h"
+#include "worldstreamer.h"
+
+#include "worldsnapshot.h"
+
+namespace Flyer
+{
+
+static const char MAGIC[] = "FLYRSNAP";				///< Snapshot magic
+static const int MAGIC_SIZE = 8;					///< Magic size, w/o terminating zero
+static const quint32 VERSION = 4;					///< Snapshot format version
+
+/// Creates object from parameters written by WorldObject::saveParams()
+typedef WorldObject* (*ObjectFactory)( World* pWorld, QDataStream& params );
+
+// ============================================================================
+/// Creates ground, with body and decorations. Textures are read from snapshot, not assembled.
+static WorldObject* createGround( World* pWorld, QDataStream& params )
+{
+	QPolygonF heightmap;
+	bool chunked;
+	params >> heightmap >> chunked;
+	
+	Ground* pGround = new Ground( pWorld );
+	pGround->setHeightmap( heightmap );
+	pGround->restoreTextures( params );
+	if ( chunked )
+	{
+		// terrain will be created by world streamer
+		pGround->releaseTerrain();
+	}
+	else
+	{
+		pGround->createBody();
+		pGround->createDecorations();
+	}
+	
+	return pGround;
+}
+
+// ============================================================================
+/// Creates small building
+static WorldObject* createBuilding( World* pWorld, QDataStream& params )
+{
+	double location;
+	bool background;
+	int type;
+	params >> location >> background >> type;
+	
+	Building* pBuilding = new Building( pWorld );
+	pBuilding->initSmallBuilding( location, background, type );
+	
+	return pBuilding;
+}
+
+// ============================================================================
+/// Creates airfield
+static WorldObject* createAirfield( World* pWorld, QDataStream& params )
+{
+	double x1, x2;
+	params >> x1 >> x2;
+	
+	return new Airfield( pWorld, x1, x2 );
+}
+
+// ============================================================================
+/// Creates landing light
+static WorldObject* createLandingLight( World* pWorld, QDataStream& params )
+{
+	double x, angle;
+	params >> x >> angle;
+	
+	return new LandingLight( pWorld, x, angle );
+}
+
+// ============================================================================
+/// Creates AA battery
+static WorldObject* createAntiAirBattery( World* pWorld, QDataStream& params )
+{
+	double location, angle;
+	params >> location >> angle;
+	
+	return new AntiAirBattery( pWorld, location, angle );
+}
+
+// ============================================================================
+/// Creates hangar
+static WorldObject* createHangar( World* pWorld, QDataStream& params )
+{
+	double location;
+	params >> location;
+	
+	return new Hangar( pWorld, location );
+}
+
+// ============================================================================
+/// Creates Bumblebee plane
+static WorldObject* createPlaneBumblebee( World* pWorld, QDataStream& params )
+{
+	QPointF pos;
+	double angle;
+	params >> pos >> angle;
+	
+	return new PlaneBumblebee( pWorld, pos, angle );
+}
+
+// ============================================================================
+/// Creates iron bomb
+static WorldObject* createIronBomb( World* pWorld, QDataStream& params )
+{
+	QPointF pos;
+	double angle;
+	params >> pos >> angle;
+	
+	IronBomb* pBomb = new IronBomb( pWorld );
+	pBomb->init( pos, angle );
+	
+	return pBomb;
+}
+
+// ============================================================================
+/// Creates shrapnel, with its bodies
+static WorldObject* createShrapnel( World* pWorld, QDataStream& params )
+{
+	double lifespan;
+	int layers, count;
+	params >> lifespan >> layers >> count;
+	
+	Shrapnel* pShrapnel = new Shrapnel( pWorld );
+	pShrapnel->setLifespan( lifespan );
+	pShrapnel->setLayers( layers );
+	for( int i = 0; i < count; i++ )
+	{
+		Body* pBody = new Body();
+		pBody->restoreParams( params );
+		pBody->create( pWorld );
+		pShrapnel->addBody( pBody );
+	}
+	
+	return pShrapnel;
+}
+
+// ============================================================================
+/// Creates explosion, w/o fire and shockwave emitters
+static WorldObject* createExplosion( World* pWorld, QDataStream& params )
+{
+	double x, y, energy;
+	params >> x >> y >> energy;
+	
+	Explosion* pExplosion = new Explosion( pWorld );
+	pExplosion->setEnergy( energy );
+	pExplosion->setCenter( b2Vec2( x, y ) );
+	
+	return pExplosion;
+}
+
+// ============================================================================
+/// Creates particle emitter, w/o particles
+static WorldObject* createParticleSystem( World* pWorld, QDataStream& params )
+{
+	QString name;
+	QColor color;
+	int sprite;
+	double expansion, maxRadius;
+	float fadeOut;
+	params >> name >> color >> sprite >> expansion >> maxRadius >> fadeOut;
+	
+	ParticleSystem* pSystem = new ParticleSystem( pWorld );
+	pSystem->setName( name );
+	pSystem->setColor( color );
+	pSystem->setSprite( ParticleSystem::Sprite( sprite ) );
+	pSystem->setExpansion( expansion );
+	pSystem->setMaxRadius( maxRadius );
+	pSystem->setFadeOut( fadeOut != 0.0f );
+	
+	return pSystem;
+}
+
+/// Object factory, by snapshot class
+struct FactoryEntry
+{
+	const char*		className;
+	ObjectFactory	factory;
+};
+
+/// Known object classes
+static const FactoryEntry FACTORIES[] =
+{
+	{ "Ground",				createGround },
+	{ "Building",			createBuilding },
+	{ "Airfield",			createAirfield },
+	{ "LandingLight",		createLandingLight },
+	{ "AntiAirBattery",		createAntiAirBattery },
+	{ "Hangar",				createHangar },
+	{ "PlaneBumblebee",		createPlaneBumblebee },
+	{ "IronBomb",			createIronBomb },
+	{ "Shrapnel",			createShrapnel },
+	{ "Explosion",			createExplosion },
+	{ "ParticleSystem",		createParticleSystem },
+	{ NULL, NULL }
+};
+
+// ============================================================================
+/// Finds factory for snapshot class. Returns NULL if class is unknown.
+static ObjectFactory findFactory( const QString& className )
+{
+	for( int i = 0; FACTORIES[i].className; i++ )
+	{
+		if ( className == FACTORIES[i].className )
+		{
+			return FACTORIES[i].factory;
+		}
+	}
+	
+	return NULL;
+}
+
+// ============================================================================
+/// Adds object to snapshot, assigning next id.
+void WorldSnapshot::addObject( WorldObject* pObject )
+{
+	if ( pObject )
+	{
+		_ids.insert( pObject, _objects.size() );
+	}
+	_objects.append( pObject );
+}
+
+// ============================================================================
+/// Returns object's id in snapshot
+int WorldSnapshot::objectId( const WorldObject* pObject ) const
+{
+	return _ids.value( pObject, -1 );
+}
+
+// ============================================================================
+/// Returns object by id
+WorldObject* WorldSnapshot::object( int id ) const
+{
+	if ( id >= 0 && id < _objects.size() )
+	{
+		return _objects[ id ];
+	}
+	
+	return NULL;
+}
+
+// ============================================================================
+/// Returns number of object ids, including objects which couldn't be restored
+int WorldSnapshot::objectCount() const
+{
+	return _objects.size();
+}
+
+// ============================================================================
+/// Writes objects: class, parameters and state of each.
+void WorldSnapshot::writeObjects( QDataStream& stream, const World* pWorld ) const
+{
+	stream << _objects.size();
+	foreach( WorldObject* pObject, _objects )
+	{
+		QByteArray params;
+		QDataStream paramsStream( & params, QIODevice::WriteOnly );
+		paramsStream.setVersion( QDataStream::Qt_4_4 );
+		pObject->saveParams( paramsStream );
+		
+		QByteArray state;
+		QDataStream stateStream( & state, QIODevice::WriteOnly );
+		stateStream.setVersion( QDataStream::Qt_4_4 );
+		pObject->saveState( stateStream, *this );
+		
+		stream << pObject->snapshotClass() << pWorld->objectClass( pObject ) << params << state;
+	}
+}
+
+// ============================================================================
+/// Reads objects written by writeObjects(). Objects are created first, then their
+/// state is restored, in the order they were saved.
+void WorldSnapshot::readObjects( QDataStream& stream, World* pWorld )
+{
+	int count;
+	stream >> count;
+	
+	// create objects
+	QList<QByteArray> states;
+	for( int i = 0; i < count; i++ )
+	{
+		QString className;
+		int objectClass;
+		QByteArray params;
+		QByteArray state;
+		stream >> className >> objectClass >> params >> state;
+		
+		ObjectFactory factory = findFactory( className );
+		if ( ! factory )
+		{
+			qWarning("Unknown object class in world snapshot: %s", qPrintable( className ) );
+			addObject( NULL );
+			states.append( QByteArray() );
+			continue;
+		}
+		
+		QDataStream paramsStream( params );
+		paramsStream.setVersion( QDataStream::Qt_4_4 );
+		WorldObject* pObject = factory( pWorld, paramsStream );
+		
+		Ground* pGround = dynamic_cast<Ground*>( pObject );
+		if ( pGround )
+		{
+			pWorld->setGround( pGround );
+		}
+		else
+		{
+			pWorld->addObject( pObject, objectClass );
+		}
+		
+		addObject( pObject );
+		states.append( state );
+	}
+	
+	// restore state
+	for( int i = 0; i < count; i++ )
+	{
+		WorldObject* pObject = object( i );
+		if ( pObject )
+		{
+			QDataStream stateStream( states[i] );
+			stateStream.setVersion( QDataStream::Qt_4_4 );
+			pObject->restoreState( stateStream, *this );
+		}
+	}
+}
+
+// ============================================================================
+/// Saves world into single byte array.
+QByteArray WorldSnapshot::save( const World* pWorld )
+{
+	Q_ASSERT( pWorld );
+	
+	WorldSnapshot snapshot;
+	foreach( WorldObject* pObject, pWorld->_allObjects )
+	{
+		if ( ! pObject->snapshotClass().isEmpty() )
+		{
+			snapshot.addObject( pObject );
+		}
+	}
+	
+	// qrand() state can't be read, so start new sequence here
+	uint randomSeed = qrand();
+	qsrand( randomSeed );
+	
+	QByteArray data;
+	QDataStream stream( & data, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	
+	stream.writeRawData( MAGIC, MAGIC_SIZE );
+	stream << VERSION;
+	stream << pWorld->_boundary << pWorld->_steps << pWorld->_timer1Time << randomSeed;
+	pWorld->_environment.saveState( stream );
+	pWorld->_pProjectiles->saveState( stream );
+	
+	snapshot.writeObjects( stream, pWorld );
+	
+	// player
+	int playerId = -1;
+	if ( pWorld->_pPlayer )
+	{
+		playerId = snapshot.objectId( pWorld->_pPlayer->parent() );
+	}
+	stream << playerId;
+	
+	// parked chunks
+	stream << bool( pWorld->_pStreamer );
+	if ( pWorld->_pStreamer )
+	{
+		pWorld->_pStreamer->save( stream );
+	}
+	
+	return data;
+}
+
+// ============================================================================
+/// Creates new world from snapshot.
+World* WorldSnapshot::restore( const QByteArray& data )
+{
+	QDataStream stream( data );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	
+	char magic[ MAGIC_SIZE ];
+	quint32 version = 0;
+	if ( stream.readRawData( magic, MAGIC_SIZE ) != MAGIC_SIZE || qstrncmp( magic, MAGIC, MAGIC_SIZE ) != 0 )
+	{
+		qWarning("Not a world snapshot");
+		return NULL;
+	}
+	stream >> version;
+	if ( version != VERSION )
+	{
+		qWarning("Unsupported world snapshot version: %u", version );
+		return NULL;
+	}
+	
+	QRectF boundary;
+	int steps;
+	double timer1Time;
+	uint randomSeed;
+	stream >> boundary >> steps >> timer1Time >> randomSeed;
+	
+	World* pWorld = new World( boundary );
+	pWorld->_steps = steps;
+	pWorld->_timer1Time = timer1Time;
+	pWorld->_environment.restoreState( stream );
+	pWorld->_pProjectiles->restoreState( stream );
+	
+	WorldSnapshot snapshot;
+	snapshot.readObjects( stream, pWorld );
+	
+	// player
+	int playerId;
+	stream >> playerId;
+	Machine* pPlayerMachine = dynamic_cast<Machine*>( snapshot.object( playerId ) );
+	if ( pPlayerMachine && pPlayerMachine->pilot() )
+	{
+		pWorld->setPlayer( pPlayerMachine->pilot() );
+	}
+	
+	// parked chunks
+	bool streaming;
+	stream >> streaming;
+	if ( streaming )
+	{
+		WorldStreamer* pStreamer = new WorldStreamer( pWorld );
+		pStreamer->restore( stream );
+		pWorld->setStreamer( pStreamer );
+	}
+	
+	qsrand( randomSeed );
+	
+	return pWorld;
+}
+
+// ============================================================================
+/// Saves group of objects, without world data. References to objects outside
+/// the group are not stored.
+QByteArray WorldSnapshot::saveObjects( const World* pWorld, const QList<WorldObject*>& objects )
+{
+	Q_ASSERT( pWorld );
+	
+	WorldSnapshot snapshot;
+	foreach( WorldObject* pObject, objects )
+	{
+		snapshot.addObject( pObject );
+	}
+	
+	QByteArray data;
+	QDataStream stream( & data, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	snapshot.writeObjects( stream, pWorld );
+	
+	return data;
+}
+
+// ============================================================================
+/// Re-creates objects saved by saveObjects() and adds them to the world.
+QList<WorldObject*> WorldSnapshot::restoreObjects( World* pWorld, const QByteArray& data )
+{
+	Q_ASSERT( pWorld );
+	
+	QDataStream stream( data );
+	stream.setVersion( QDataStream::Qt_4_4 );
+	
+	WorldSnapshot snapshot;
+	snapshot.readObjects( stream, pWorld );
+	
+	QList<WorldObject*> objects;
+	foreach( WorldObject* pObject, snapshot._objects )
+	{
+		if ( pObject )
+		{
+			objects.append( pObject );
+		}
+	}
+	
+	return objects;
+}
+
+}
+
+// EOF
@@ -0,0 +1,92 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERWORLDSNAPSHOT_H
+#define FLYERWORLDSNAPSHOT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+
+class QDataStream;
+
+namespace Flyer
+{
+
+class World;
+class WorldObject;
+
+/**
+	Binary snapshot of whole world: simulation time, timer, random generator seed,
+	gun rounds in flight, and all objects with their bodies, systems and attachments,
+	including transient ones - shrapnels, explosions and particle emitters.
+	Snapshot is a single contiguous byte array. Restoring it creates new world,
+	without generating terrain, assembling ground textures or parsing assets again.
+	Chunks parked by world streamer are stored as well.
+	
+	Each object stores parameters it needs to be re-created (snapshotClass(), saveParams())
+	and its dynamic state (saveState()). Emitters restored from snapshot are released,
+	objects which owned them create new ones.
+	
+	Taking snapshot re-seeds random generator, so simulation continued after save
+	and after restore uses the same random sequence.
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class WorldSnapshot
+{
+public:
+	
+	/// Creates snapshot of the world
+	static QByteArray save( const World* pWorld );
+	
+	/// Creates new world from snapshot. Returns NULL if data is not a valid snapshot
+	static World* restore( const QByteArray& data );
+	
+	/// Saves group of objects
+	static QByteArray saveObjects( const World* pWorld, const QList<WorldObject*>& objects );
+	
+	/// Re-creates group of objects in the world
+	static QList<WorldObject*> restoreObjects( World* pWorld, const QByteArray& data );
+	
+	// used by objects to store references to other objects
+	
+	/// Returns id of object in snapshot, or -1 if object is not stored
+	int objectId( const WorldObject* pObject ) const;
+	
+	/// Returns object with specified id, or NULL
+	WorldObject* object( int id ) const;
+	
+	/// Returns number of object ids, valid ids are 0 - objectCount()-1
+	int objectCount() const;
+
+private:
+	
+	WorldSnapshot() {}
+	
+	void addObject( WorldObject* pObject );
+	void writeObjects( QDataStream& stream, const World* pWorld ) const;	///< Writes objects
+	void readObjects( QDataStream& stream, World* pWorld );				///< Creates objects
+	
+	QList<WorldObject*>					_objects;	///< Stored objects, by id
+	QHash<const WorldObject*, int>		_ids;		///< Object ids
+};
+
+}
+
+#endif // FLYERWORLDSNAPSHOT_H
+
+// EOF
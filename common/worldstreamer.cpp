@@ -0,0 +1,434 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#include <math.h>
+
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include "world.h"
+#include "ground.h"
+#include "pilot.h"
+#include "physicalobject.h"
+#include "worldsnapshot.h"
+
+#include "worldstreamer.h"
+
+namespace Flyer
+{
+
+static const int PREFETCH_RADIUS = 1;	///< Chunks beyond active range decompressed ahead [chunks]
+static const int TERRAIN_MARGIN = 1;	///< Chunks beyond active range with terrain [chunks]
+
+/// Background job which compresses or decompresses parked objects of a chunk
+class StreamerJob : public QRunnable
+{
+public:
+	StreamerJob( WorldStreamer* pStreamer, WorldStreamer::Chunk* pChunk, bool compress )
+		: _pStreamer( pStreamer ), _pChunk( pChunk ), _compress( compress )
+	{
+		setAutoDelete( true );
+	}
+	
+	virtual void run()
+	{
+		QList<WorldStreamer::Group> groups;
+		int generation;
+		{
+			QMutexLocker locker( & _pStreamer->_mutex );
+			groups = _pChunk->groups;
+			generation = _pChunk->generation;
+		}
+		
+		for( int i = 0; i < groups.size(); i++ )
+		{
+			WorldStreamer::Group& group = groups[i];
+			if ( group.compressed != _compress )
+			{
+				group.data = _compress ? qCompress( group.data ) : qUncompress( group.data );
+				group.compressed = _compress;
+			}
+		}
+		
+		QMutexLocker locker( & _pStreamer->_mutex );
+		// discard result if chunk was changed in the meantime
+		if ( _pChunk->generation == generation )
+		{
+			_pChunk->groups = groups;
+		}
+		_pChunk->busy = false;
+	}
+	
+private:
+	WorldStreamer*			_pStreamer;
+	WorldStreamer::Chunk*	_pChunk;
+	bool					_compress;	///< Compress or decompress
+};
+
+// ============================================================================
+/// Constructor. Creates inactive chunks covering whole world. Attach streamer
+/// to the world with World::setStreamer().
+WorldStreamer::WorldStreamer( World* pWorld, double chunkWidth, int activeRadius )
+{
+	Q_ASSERT( pWorld );
+	
+	_pWorld = pWorld;
+	_pGenerator = NULL;
+	_chunkWidth = chunkWidth;
+	_activeRadius = qMax( 0, activeRadius );
+	_center = pWorld->boundary().center().x();
+	
+	createChunks();
+}
+
+// ============================================================================
+/// Destructor. Waits for background jobs.
+WorldStreamer::~WorldStreamer()
+{
+	_pool.waitForDone();
+	qDeleteAll( _chunks );
+}
+
+// ============================================================================
+/// Creates inactive chunks covering world boundary.
+void WorldStreamer::createChunks()
+{
+	_pool.waitForDone();
+	qDeleteAll( _chunks );
+	_chunks.clear();
+	
+	int first = chunkIndex( _pWorld->boundary().left() );
+	int last = chunkIndex( _pWorld->boundary().right() );
+	for( int i = first; i <= last; i++ )
+	{
+		Chunk* pChunk = new Chunk;
+		pChunk->index = i;
+		pChunk->active = false;
+		pChunk->terrain = false;
+		pChunk->generated = false;
+		pChunk->busy = false;
+		pChunk->generation = 0;
+		_chunks.insert( i, pChunk );
+	}
+}
+
+// ============================================================================
+/// Returns index of chunk containing x. Chunk \b i spans [ i*width, (i+1)*width ).
+int WorldStreamer::chunkIndex( double x ) const
+{
+	return int( floor( x / _chunkWidth ) );
+}
+
+// ============================================================================
+/// Activates chunks in active radius around chunk containing x, and deactivates
+/// all other. Persistent objects found in inactive chunks are parked.
+/// Called by the world every second, with player's position.
+void WorldStreamer::update( double x )
+{
+	_center = x;
+	int center = chunkIndex( x );
+	
+	// leave chunks out of range. Objects are parked below
+	int terrainRadius = _activeRadius + TERRAIN_MARGIN;
+	foreach( Chunk* pChunk, _chunks )
+	{
+		int distance = qAbs( pChunk->index - center );
+		if ( distance > _activeRadius )
+		{
+			pChunk->active = false;
+		}
+		if ( pChunk->terrain && distance > terrainRadius )
+		{
+			destroyTerrain( pChunk );
+		}
+	}
+	
+	// enter chunks in range, terrain first
+	for( int i = center - terrainRadius; i <= center + terrainRadius; i++ )
+	{
+		Chunk* pChunk = _chunks.value( i );
+		if ( pChunk && ! pChunk->terrain )
+		{
+			createTerrain( pChunk );
+		}
+	}
+	for( int i = center - _activeRadius; i <= center + _activeRadius; i++ )
+	{
+		Chunk* pChunk = _chunks.value( i );
+		if ( pChunk && ! pChunk->active )
+		{
+			activate( pChunk );
+		}
+	}
+	
+	// park objects in inactive chunks. This also catches objects which moved out of active range
+	QMap<int, QList<WorldObject*> > objectsToPark;
+	foreach( WorldObject* pObject, _pWorld->_allObjects )
+	{
+		if ( isParkable( pObject ) )
+		{
+			Chunk* pChunk = _chunks.value( chunkIndex( objectX( pObject ) ) );
+			if ( pChunk && ! pChunk->active )
+			{
+				objectsToPark[ pChunk->index ].append( pObject );
+			}
+		}
+	}
+	foreach( int index, objectsToPark.keys() )
+	{
+		park( _chunks.value( index ), objectsToPark[ index ] );
+	}
+	
+	// decompress chunks approaching active range, compress the rest
+	QMutexLocker locker( & _mutex );
+	foreach( Chunk* pChunk, _chunks )
+	{
+		if ( pChunk->active || pChunk->busy )
+		{
+			continue;
+		}
+		
+		bool compress = qAbs( pChunk->index - center ) > _activeRadius + PREFETCH_RADIUS;
+		foreach( const Group& group, pChunk->groups )
+		{
+			if ( group.compressed != compress )
+			{
+				startJob( pChunk, compress );
+				break;
+			}
+		}
+	}
+}
+
+// ============================================================================
+/// Activates chunk: runs generator if chunk is visited for the first time, and re-creates
+/// parked objects. Terrain of chunk and its neighbours is already created.
+void WorldStreamer::activate( Chunk* pChunk )
+{
+	double from = pChunk->index * _chunkWidth;
+	double to = from + _chunkWidth;
+	
+	if ( ! pChunk->generated )
+	{
+		pChunk->generated = true;
+		if ( _pGenerator )
+		{
+			_pGenerator->generateChunk( _pWorld, pChunk->index, from, to );
+		}
+	}
+	
+	QList<Group> groups;
+	{
+		QMutexLocker locker( & _mutex );
+		groups = pChunk->groups;
+		pChunk->groups.clear();
+		pChunk->generation++;
+	}
+	
+	foreach( const Group& group, groups )
+	{
+		WorldSnapshot::restoreObjects( _pWorld, group.compressed ? qUncompress( group.data ) : group.data );
+	}
+	
+	pChunk->active = true;
+}
+
+// ============================================================================
+/// Creates chunk's terrain: ground body and decorations of segments starting in the chunk.
+void WorldStreamer::createTerrain( Chunk* pChunk )
+{
+	if ( _pWorld->_pGround )
+	{
+		double from = pChunk->index * _chunkWidth;
+		_pWorld->_pGround->createChunk( pChunk->index, from, from + _chunkWidth );
+	}
+	
+	pChunk->terrain = true;
+}
+
+// ============================================================================
+/// Destroys chunk's terrain.
+void WorldStreamer::destroyTerrain( Chunk* pChunk )
+{
+	if ( _pWorld->_pGround )
+	{
+		_pWorld->_pGround->destroyChunk( pChunk->index );
+	}
+	
+	pChunk->terrain = false;
+}
+
+// ============================================================================
+/// Stores objects as new group in chunk, and removes them from the world.
+/// Group is compressed later, on background thread.
+void WorldStreamer::park( Chunk* pChunk, const QList<WorldObject*>& objects )
+{
+	Group group;
+	group.data = WorldSnapshot::saveObjects( _pWorld, objects );
+	group.compressed = false;
+	
+	foreach( WorldObject* pObject, objects )
+	{
+		_pWorld->removeObject( pObject );
+	}
+	
+	QMutexLocker locker( & _mutex );
+	pChunk->groups.append( group );
+	pChunk->generation++;
+}
+
+// ============================================================================
+/// Starts background job (de)compressing chunk groups. Called with mutex locked.
+void WorldStreamer::startJob( Chunk* pChunk, bool compress )
+{
+	pChunk->busy = true;
+	_pool.start( new StreamerJob( this, pChunk, compress ) );
+}
+
+// ============================================================================
+/// Checks if object can be parked. Ground, player's plane and transient objects are never parked.
+bool WorldStreamer::isParkable( WorldObject* pObject ) const
+{
+	if ( pObject->snapshotClass().isEmpty() || pObject->transient() || pObject == _pWorld->_pGround )
+	{
+		return false;
+	}
+	
+	if ( _pWorld->_pPlayer && pObject == _pWorld->_pPlayer->parent() )
+	{
+		return false;
+	}
+	
+	return true;
+}
+
+// ============================================================================
+/// Returns x-position of object, used to assign it to chunk
+double WorldStreamer::objectX( WorldObject* pObject ) const
+{
+	PhysicalObject* pPhysical = dynamic_cast<PhysicalObject*>( pObject );
+	if ( pPhysical && pPhysical->mainBody() )
+	{
+		return pPhysical->position().x();
+	}
+	
+	return pObject->boundingRect().center().x();
+}
+
+// ============================================================================
+/// Returns number of active chunks
+int WorldStreamer::activeChunks() const
+{
+	int count = 0;
+	foreach( const Chunk* pChunk, _chunks )
+	{
+		if ( pChunk->active ) count++;
+	}
+	
+	return count;
+}
+
+// ============================================================================
+/// Returns number of chunks with parked objects
+int WorldStreamer::parkedChunks() const
+{
+	QMutexLocker locker( & _mutex );
+	int count = 0;
+	foreach( const Chunk* pChunk, _chunks )
+	{
+		if ( ! pChunk->groups.isEmpty() ) count++;
+	}
+	
+	return count;
+}
+
+// ============================================================================
+/// Returns memory used by parked objects [bytes]
+int WorldStreamer::parkedBytes() const
+{
+	QMutexLocker locker( & _mutex );
+	int bytes = 0;
+	foreach( const Chunk* pChunk, _chunks )
+	{
+		foreach( const Group& group, pChunk->groups )
+		{
+			bytes += group.data.size();
+		}
+	}
+	
+	return bytes;
+}
+
+// ============================================================================
+/// Writes streamer settings and parked objects. Groups are stored compressed.
+void WorldStreamer::save( QDataStream& stream ) const
+{
+	QMutexLocker locker( & _mutex );
+	
+	stream << _chunkWidth << _activeRadius << _center;
+	stream << _chunks.size();
+	foreach( const Chunk* pChunk, _chunks )
+	{
+		stream << pChunk->index << pChunk->generated << pChunk->groups.size();
+		foreach( const Group& group, pChunk->groups )
+		{
+			stream << ( group.compressed ? group.data : qCompress( group.data ) );
+		}
+	}
+}
+
+// ============================================================================
+/// Reads data written by save(). All chunks are inactive, they are activated when
+/// streamer is attached to the world.
+void WorldStreamer::restore( QDataStream& stream )
+{
+	int count;
+	stream >> _chunkWidth >> _activeRadius >> _center >> count;
+	
+	createChunks();
+	
+	for( int i = 0; i < count; i++ )
+	{
+		int index, groups;
+		bool generated;
+		stream >> index >> generated >> groups;
+		
+		Chunk* pChunk = _chunks.value( index );
+		if ( pChunk )
+		{
+			pChunk->generated = generated;
+		}
+		
+		for( int g = 0; g < groups; g++ )
+		{
+			Group group;
+			stream >> group.data;
+			group.compressed = true;
+			if ( pChunk )
+			{
+				pChunk->groups.append( group );
+			}
+		}
+	}
+}
+
+}
+
+// EOF
+
+
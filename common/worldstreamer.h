@@ -0,0 +1,150 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+
+#ifndef FLYERWORLDSTREAMER_H
+#define FLYERWORLDSTREAMER_H
+
+#include <QMap>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+#include <QThreadPool>
+
+class QDataStream;
+
+namespace Flyer
+{
+
+class World;
+class WorldObject;
+class StreamerJob;
+
+/**
+	Divides world into chunks along X axis, and keeps only chunks around
+	the player alive. Terrain - ground body and decorations - is kept one chunk
+	beyond active chunks, as chunk's terrain covers only segments starting in it,
+	and objects at the edge of active range may stand on segment of the neighbour.
+	Persistent objects found in inactive chunks are parked: stored using
+	WorldSnapshot::saveObjects() and removed from the world, then re-created
+	when chunk is activated again. Parked objects are frozen.
+	
+	Parked data is compressed on background thread, and chunks approaching
+	active range are decompressed ahead, also on background thread. Objects
+	themselves are created on simulation thread.
+	
+	Content of chunk activated for the first time may be created by generator,
+	so large worlds don't have to be populated up front. Generator is not
+	stored in world snapshot, and has to be set again after restore.
+	
+	Streamer is owned by the world, see World::setStreamer().
+	@author Maciek Gajewski <maciej.gajewski0@gmail.com>
+*/
+class WorldStreamer
+{
+public:
+	
+	/// Creates content of chunk activated for the first time
+	class Generator
+	{
+	public:
+		virtual ~Generator() {}
+		/// Creates objects in x-range [from, to)
+		virtual void generateChunk( World* pWorld, int index, double from, double to ) = 0;
+	};
+	
+	WorldStreamer( World* pWorld, double chunkWidth = 2000.0, int activeRadius = 2 );
+	~WorldStreamer();
+	
+	/// Sets content generator. Generator is not owned by streamer.
+	void setGenerator( Generator* pGenerator ) { _pGenerator = pGenerator; }
+	
+	/// Activates chunks around x, parks objects outside them
+	void update( double x );
+	
+	/// Returns x around which chunks are active
+	double center() const { return _center; }
+	
+	/// Returns index of chunk containing x
+	int chunkIndex( double x ) const;
+	
+	double chunkWidth() const { return _chunkWidth; }	///< Chunk width [m]
+	int activeRadius() const { return _activeRadius; }	///< Active chunks on each side of the center one
+	
+	// statistics
+	
+	int activeChunks() const;		///< Number of active chunks
+	int parkedChunks() const;		///< Number of chunks with parked objects
+	int parkedBytes() const;		///< Memory used by parked objects
+	
+	// snapshots
+	
+	/// Writes parked chunks
+	void save( QDataStream& stream ) const;
+	/// Reads parked chunks. Should be called before streamer is attached to the world.
+	void restore( QDataStream& stream );
+
+private:
+	
+	friend class StreamerJob;
+	
+	/// Group of objects parked together
+	struct Group
+	{
+		QByteArray	data;			///< Serialized objects
+		bool		compressed;		///< If data is compressed
+	};
+	
+	/// Single chunk
+	struct Chunk
+	{
+		int		index;				///< Chunk index
+		bool	active;				///< Chunk is active: objects are alive
+		bool	terrain;			///< Chunk's terrain is created
+		bool	generated;			///< Generator was already run for this chunk
+		bool	busy;				///< Background job is running for this chunk
+		int		generation;			///< Incremented on each change. Used to discard stale job results
+		QList<Group> groups;		///< Parked objects
+	};
+	
+	void createChunks();				///< Creates chunks covering world
+	void activate( Chunk* pChunk );		///< Activates chunk
+	void createTerrain( Chunk* pChunk );	///< Creates chunk terrain
+	void destroyTerrain( Chunk* pChunk );	///< Destroys chunk terrain
+	void park( Chunk* pChunk, const QList<WorldObject*>& objects );	///< Parks objects
+	void startJob( Chunk* pChunk, bool compress );	///< Starts background (de)compression
+	
+	bool isParkable( WorldObject* pObject ) const;	///< If object may be parked
+	double objectX( WorldObject* pObject ) const;	///< Object x-position
+	
+	World*			_pWorld;			///< World
+	Generator*		_pGenerator;		///< Content generator
+	double			_chunkWidth;		///< Chunk width [m]
+	int				_activeRadius;		///< Active radius [chunks]
+	double			_center;			///< Last update center
+	QMap<int, Chunk*>	_chunks;		///< All chunks, by index
+	
+	mutable QMutex	_mutex;				///< Guards chunk groups, accessed by background jobs
+	QThreadPool		_pool;				///< Background jobs
+};
+
+}
+
+#endif // FLYERWORLDSTREAMER_H
+
+// EOF
+
+
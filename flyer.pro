@@ -1,6 +1,8 @@
 TEMPLATE = subdirs
 
 SUBDIRS = Box2D QPropertyEditor gpc common flyer editor \
- tests
+ flyerpack \
+ tests \
+ benchmark
 CONFIG += ordered
 
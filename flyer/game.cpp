@@ -30,6 +30,11 @@
 #include "common.h"
 #include "hangar.h"
 #include "b2dqt.h"
+#include "jobgraph.h"
+#include "worldsnapshot.h"
+#include "worldstreamer.h"
+#include "terraingenerator.h"
+#include "bodyprovider.h"
 
 #include "game.h"
 
@@ -64,6 +69,235 @@ void Game::restart()
 	_messages.clear();
 }
 
+static const int TERRAIN_JOBS = 4;	///< Number of parallel terrain generation jobs
+
+/// Job generating x-range of terrain
+class TerrainJob : public JobGraph::Job
+{
+public:
+	TerrainJob( const TerrainGenerator* pGenerator, double from, double to, QPolygonF* pResult )
+		: _pGenerator( pGenerator ), _from( from ), _to( to ), _pResult( pResult ) {}
+	
+	virtual void run() { *_pResult = _pGenerator->generate( _from, _to ); }
+
+private:
+	const TerrainGenerator*	_pGenerator;
+	double					_from;
+	double					_to;
+	QPolygonF*				_pResult;
+};
+
+/**
+	Builds standard game world. Construction is split into jobs, run by JobGraph:
+	terrain generation, ground texture assembly, body prototype loading and building
+	placement run in parallel on thread pool. Everything which creates physical bodies
+	or adds objects to the world is serialized on the main thread, at the end.
+	Terrain is generated in few x-ranges in parallel, and joined when ground body is created.
+	Each worker job has its own random seed, drawn on main thread, so the world
+	doesn't depend on job scheduling.
+*/
+class WorldBuilder
+{
+public:
+	WorldBuilder( World* pWorld, const QList<Ground::Section>& seed )
+		: _pWorld( pWorld ), _terrain( seed, qrand() )
+	{
+		_pGround = new Ground( pWorld );
+		_texturesSeed = qrand();
+		_townsSeed = qrand();
+		_decorationsSeed = qrand();
+	}
+	
+	void build();
+
+private:
+	
+	// worker jobs
+	void assembleTextures();
+	void preloadBodies();
+	void placeBuildings();
+	
+	// main thread jobs
+	void createGround();
+	void createDecorations();
+	void createInstallations();
+	void createBuildings();
+	
+	World*					_pWorld;
+	Ground*					_pGround;
+	TerrainGenerator		_terrain;		///< Terrain generator
+	QPolygonF				_terrainParts[ TERRAIN_JOBS ];	///< Generated terrain ranges
+	QList<Building::Placement>	_buildings;	///< Planned buildings
+	
+	uint	_texturesSeed;		///< Random seed for textures job
+	uint	_townsSeed;			///< Random seed for building placement job
+	uint	_decorationsSeed;	///< Random seed for ground decorations
+};
+
+// ============================================================================
+/// Builds the world. Prints startup timeline, and exports it to CSV file if
+/// FLYER_STARTUP_TIMELINE environment variable contains file path.
+void WorldBuilder::build()
+{
+	JobGraph graph;
+	
+	double terrainLength = ( _terrain.end() - _terrain.start() ) / TERRAIN_JOBS;
+	int terrain[ TERRAIN_JOBS ];
+	for( int i = 0; i < TERRAIN_JOBS; i++ )
+	{
+		double from = _terrain.start() + i * terrainLength;
+		// last range is open at the right, include last terrain point
+		double to = ( i == TERRAIN_JOBS - 1 ) ? _terrain.end() + 1.0 : from + terrainLength;
+		terrain[i] = graph.addJob( QString("terrain %1").arg( i + 1 ), new TerrainJob( & _terrain, from, to, & _terrainParts[i] ) );
+	}
+	int textures = graph.addJob( "ground textures", this, & WorldBuilder::assembleTextures );
+	int bodies = graph.addJob( "body prototypes", this, & WorldBuilder::preloadBodies );
+	int placement = graph.addJob( "building placement", this, & WorldBuilder::placeBuildings );
+	
+	int ground = graph.addJob( "ground body", this, & WorldBuilder::createGround, JobGraph::MainThread );
+	int decorations = graph.addJob( "ground decorations", this, & WorldBuilder::createDecorations, JobGraph::MainThread );
+	int installations = graph.addJob( "installations", this, & WorldBuilder::createInstallations, JobGraph::MainThread );
+	int buildings = graph.addJob( "buildings", this, & WorldBuilder::createBuildings, JobGraph::MainThread );
+	
+	for( int i = 0; i < TERRAIN_JOBS; i++ )
+	{
+		graph.addDependency( ground, terrain[i] );
+	}
+	graph.addDependency( decorations, ground );
+	graph.addDependency( decorations, textures );
+	graph.addDependency( installations, ground );
+	graph.addDependency( installations, bodies );
+	graph.addDependency( buildings, ground );
+	graph.addDependency( buildings, bodies );
+	graph.addDependency( buildings, placement );
+	
+	graph.run();
+	
+	qDebug("World built in %.1f ms", graph.totalTime() );
+	graph.printTimeline();
+	
+	QByteArray timelinePath = qgetenv( "FLYER_STARTUP_TIMELINE" );
+	if ( ! timelinePath.isEmpty() )
+	{
+		graph.exportTimeline( QString::fromLocal8Bit( timelinePath ) );
+	}
+}
+
+// ============================================================================
+/// Assembles ground textures.
+void WorldBuilder::assembleTextures()
+{
+	_pGround->assembleTextures( _texturesSeed );
+}
+
+// ============================================================================
+/// Parses bodies used by world objects into BodyProvider's prototype cache.
+void WorldBuilder::preloadBodies()
+{
+	QStringList names;
+	names
+		<< "planes/bumblebee_fuselage.body"
+		<< "planes/bumblebee_wheel.body"
+		<< "planes/bumblebee_leg.body"
+		<< "planes/bumblebee_engine.body"
+		<< "planes/bumblebee_tail.body"
+		<< "installations/flak1-body.body"
+		<< "installations/flak1-base.body"
+		<< "hangar20-1.body"
+		<< "weapons/gpb125.body";
+	
+	for( int i = 1; i <= Building::smallBuildingTypes(); i++ )
+	{
+		names.append( Building::smallBuildingBody( i ) );
+	}
+	
+	foreach( const QString& name, names )
+	{
+		BodyProvider::preload( name );
+	}
+}
+
+// ============================================================================
+/// Plans locations of buildings in both towns.
+void WorldBuilder::placeBuildings()
+{
+	qsrand( _townsSeed );
+	_buildings += Building::planTown( 400, 800 );
+	_buildings += Building::planTown( 2300, 2600 );
+}
+
+// ============================================================================
+/// Creates ground body and adds ground to the world
+void WorldBuilder::createGround()
+{
+	QPolygonF heightmap;
+	for( int i = 0; i < TERRAIN_JOBS; i++ )
+	{
+		heightmap += _terrainParts[i];
+	}
+	
+	_pGround->setHeightmap( heightmap );
+	_pGround->createBody();
+	_pWorld->setGround( _pGround );
+}
+
+// ============================================================================
+/// Creates textured ground segments
+void WorldBuilder::createDecorations()
+{
+	_pGround->createDecorations( _decorationsSeed );
+}
+
+// ============================================================================
+/// Creates planes, airfields and installations
+void WorldBuilder::createInstallations()
+{
+	World* pWorld = _pWorld;
+	const Ground* pGround = pWorld->ground();
+	
+	// other objects
+	// init plane
+	Plane* pPlane = new PlaneBumblebee( pWorld, QPointF( 0, pGround->height(0) + 2.5 ), 0.2 );
+	pWorld->addObject( pPlane,  World::ObjectSide1 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
+	pWorld->setPlayer( pPlane->pilot() );
+	
+	// enemy plane (!)
+	PlaneBumblebee* pEnemy = new PlaneBumblebee( pWorld, QPointF( -200, 400 ), 0.0 );
+	pEnemy->mainBody()->b2body()->SetLinearVelocity( b2Vec2( 30, 0 ) ); // some initial speed
+	pEnemy->setAutopilot( true ); // turn on autopilot
+	pWorld->addObject( pEnemy, World::ObjectSide2 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
+	
+	// airfields
+	pWorld->addObject( new Airfield( pWorld, -50, 250 ), World::ObjectAirfield | World::ObjectSide1 | World::ObjectRenderedMap  );
+	pWorld->addObject( new Airfield( pWorld, 5050, 5300 ), World::ObjectAirfield | World::ObjectSide1 | World::ObjectRenderedMap  );
+	
+	// landing lights
+	pWorld->addObject( new LandingLight( pWorld, -50, M_PI-0.25 ),  World::ObjectSimulated );
+	pWorld->addObject( new LandingLight( pWorld, 250, 0.25 ), World::ObjectSimulated  );
+	
+	pWorld->addObject( new LandingLight( pWorld, 5050, M_PI-0.25 ),  World::ObjectSimulated  );
+	pWorld->addObject( new LandingLight( pWorld, 5300, 0.25 ),  World::ObjectSimulated  );
+	
+	// AA batteries
+	pWorld->addObject( new AntiAirBattery( pWorld, 4750, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
+	pWorld->addObject( new AntiAirBattery( pWorld, 4800, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap  );
+	pWorld->addObject( new AntiAirBattery( pWorld, 5500, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap  );
+	pWorld->addObject( new AntiAirBattery( pWorld, -1500, 1.2 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
+	
+	// hangar on runway
+	pWorld->addObject( new Hangar( pWorld, 40 ), World::ObjectInstallation | World::ObjectSide1 );
+}
+
+// ============================================================================
+/// Creates buildings at planned locations
+void WorldBuilder::createBuildings()
+{
+	foreach( const Building::Placement& placement, _buildings )
+	{
+		Building::createSmallBuilding( _pWorld, placement.x, placement.background, placement.type );
+	}
+}
+
 // ============================================================================
 /// Creates predefined game.
 Game* Game::createGame()
@@ -79,6 +313,19 @@ Game* Game::createGame()
 			QRectF boundary( -15000, -500, 30000, 3000 ); // 30x3 km
 			World* pWorld = new World( boundary );
 			
+			// weather, if FLYER_WIND sets wind speed [m/s]: westerly wind and thermals drifting with it.
+			// Calm atmosphere by default
+			double wind = qgetenv( "FLYER_WIND" ).toDouble();
+			if ( wind != 0.0 )
+			{
+				Environment* pEnvironment = pWorld->environment();
+				pEnvironment->setWind( wind );
+				for( int i = 0; i < 6; i++ )
+				{
+					pEnvironment->addCell( QPointF( -12500 + 5000 * i, 2000 ), 800, 3.0, 3.0 );
+				}
+			}
+			
 			// init ground
 			{
 				// init seed
@@ -158,56 +405,51 @@ Game* Game::createGame()
 				section.y = 2500;
 				section.canBeDividedRight = false;
 				seed.append( section );
-				pWorld->initRandomGround( seed );
+				
+				WorldBuilder builder( pWorld, seed );
+				builder.build();
+				
+				// stream world in chunks around the player, if FLYER_STREAMING_CHUNK sets chunk width [m]
+				double chunkWidth = qgetenv( "FLYER_STREAMING_CHUNK" ).toDouble();
+				if ( chunkWidth > 0 )
+				{
+					pWorld->setStreamer( new WorldStreamer( pWorld, chunkWidth ) );
+				}
 			}
-			const Ground* pGround = pWorld->ground();
-			
-			// other objects
-			// init plane
-			Plane* pPlane = new PlaneBumblebee( pWorld, QPointF( 0, pGround->height(0) + 2.5 ), 0.2 );
-			pWorld->addObject( pPlane,  World::ObjectSide1 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
-			pWorld->setPlayer( pPlane->pilot() );
-			
-			// enemy plane (!)
-			PlaneBumblebee* pEnemy = new PlaneBumblebee( pWorld, QPointF( -200, 400 ), 0.0 );
-			pEnemy->mainBody()->b2body()->SetLinearVelocity( b2Vec2( 30, 0 ) ); // some initial speed
-			pEnemy->setAutopilot( true ); // turn on autopilot
-			pWorld->addObject( pEnemy, World::ObjectSide2 | World::ObjectSimulated | World::ObjectPlane | World::ObjectRenderedMap );
-			
-			// airfields
-			pWorld->addObject( new Airfield( pWorld, -50, 250 ), World::ObjectAirfield | World::ObjectSide1 | World::ObjectRenderedMap  );
-			pWorld->addObject( new Airfield( pWorld, 5050, 5300 ), World::ObjectAirfield | World::ObjectSide1 | World::ObjectRenderedMap  );
-			
-			// landing lights
-			pWorld->addObject( new LandingLight( pWorld, -50, M_PI-0.25 ),  World::ObjectSimulated );
-			pWorld->addObject( new LandingLight( pWorld, 250, 0.25 ), World::ObjectSimulated  );
-			
-			pWorld->addObject( new LandingLight( pWorld, 5050, M_PI-0.25 ),  World::ObjectSimulated  );
-			pWorld->addObject( new LandingLight( pWorld, 5300, 0.25 ),  World::ObjectSimulated  );
-			
-			// AA batteries
-			pWorld->addObject( new AntiAirBattery( pWorld, 4750, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
-			pWorld->addObject( new AntiAirBattery( pWorld, 4800, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap  );
-			pWorld->addObject( new AntiAirBattery( pWorld, 5500, 2.4 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap  );
-			pWorld->addObject( new AntiAirBattery( pWorld, -1500, 1.2 ), World::ObjectInstallation | World::ObjectSimulated |  World::ObjectSide2 | World::ObjectRenderedMap   );
 			
-			// create towns
-			createTown( pWorld, 400, 800, true );
-			createTown( pWorld, 2300, 2600, true );
+			// keep initial state for restart
+			_initialSnapshot = WorldSnapshot::save( pWorld );
 			
-			// hangar on runway
-			pWorld->addObject( new Hangar( pWorld, 40 ), World::ObjectInstallation | World::ObjectSide1 );
+			startGame( pWorld );
+		}
+		
+		// starts game in world
+		void startGame( World* pWorld )
+		{
 			setWorld( pWorld );
 			addMessage( tr("Taxi to hangar to get a bomb."), 2.0 ); // show it after 2 seconds
 		}
 		
-		// re-creates world
+		// re-creates world from initial snapshot
 		virtual void restart()
 		{
 			Game::restart();
 			delete _pWorld;
-			initWorld();
+			
+			double start = getms();
+			World* pWorld = WorldSnapshot::restore( _initialSnapshot );
+			if ( pWorld )
+			{
+				qDebug("World restored from %d bytes in %.1f ms", _initialSnapshot.size(), getms() - start );
+				startGame( pWorld );
+			}
+			else
+			{
+				initWorld();
+			}
 		}
+		
+		QByteArray	_initialSnapshot;	///< World state at game start
 	};
 
 	
@@ -218,31 +460,6 @@ Game* Game::createGame()
 	return pGame;
 }
 
-// ============================================================================
-/// Creates town at specified locations
-void Game::createTown( World* pWorld, double start, double end, bool /*small*/ )
-{
-	// foreground
-	double x = start;
-	while( x < end )
-	{
-		Building* pBuilding = Building::createSmallBuilding( pWorld, x, false );
-		double spacing = 2.0 + ((qrand()%400)/100.0);
-		
-		x += spacing * pBuilding->width();
-	}
-	
-	// background
-	x = start + 20.0 * ((qrand()%100)/100.0);
-	while( x < end )
-	{
-		Building* pBuilding = Building::createSmallBuilding( pWorld, x, true );
-		double spacing = 2.0 + ((qrand()%400)/100.0);
-		
-		x += spacing * pBuilding->width();
-	}
-}
-
 // ============================================================================
 /// Adds message. The message won't be displayed until minTime.
 void Game::addMessage( const QString& text, double minTime )
@@ -59,11 +59,7 @@ private:
 	void setWorld( World* pWorld );
 	void addMessage( const QString& text, double minTime = 0.0 );
 	
-	// helpers
-	
-	static void createTown(  World* pWorld, double start, double end, bool smallHouses ); // NOTE was 'small' here, but smetimes on Windows 'small' is defined as 'char' :(
-	
-	
+
 	World* _pWorld;
 	QList<Message> _messages;	///< Game messages
 };
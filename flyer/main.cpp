@@ -19,6 +19,7 @@
 #include <QStyleFactory>
 
 #include "mainwindow.h"
+#include "textureprovider.h"
 
 int main( int argc, char** argv )
 {
@@ -31,6 +32,9 @@ int main( int argc, char** argv )
 		app.setStyle( QStyleFactory::create( "Plastique" ) );
 	}
 	
+	// start decoding textures while the rest of the game initializes
+	Flyer::TextureProvider::preloadLibrary();
+	
 	Flyer::MainWindow mw;
 	
 	
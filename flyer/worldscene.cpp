@@ -37,6 +37,20 @@ namespace Flyer
 
 static const double FPS = 10; //const FPS
 
+/// Returns number of threads used to render the world. Set by FLYER_RENDER_THREADS
+/// environment variable, 0 (default) renders on GUI thread.
+static int renderThreads()
+{
+	return qgetenv( "FLYER_RENDER_THREADS" ).toInt();
+}
+
+/// Returns path of input log. Set by FLYER_RECORD_INPUT environment variable,
+/// empty (default) disables recording.
+static QString inputLogPath()
+{
+	return QString::fromLocal8Bit( qgetenv( "FLYER_RECORD_INPUT" ) );
+}
+
 
 // ============================================================================
 ///Constructor
@@ -46,7 +60,14 @@ WorldScene::WorldScene( QWidget* pView ) : QGraphicsScene(), _pView( pView )
 	_timer.setInterval( 1000/FPS );
 	
 	_pGame = Game::createGame();
+	if ( ! inputLogPath().isEmpty() )
+	{
+		// play in world restored from snapshot, created the same way as during replay
+		_pGame->restart();
+	}
 	_pWorld = _pGame->world();
+	_pWorld->setRenderThreads( renderThreads() );
+	startRecording();
 	
 	_pUI = new GameUI( this );
 	
@@ -63,6 +84,7 @@ WorldScene::WorldScene( QWidget* pView ) : QGraphicsScene(), _pView( pView )
 /// Destructor
 WorldScene::~WorldScene()
 {
+	saveRecording();
 }
 
 // ============================================================================
@@ -291,6 +313,7 @@ void WorldScene::renderMessages( QPainter& painter )
 void WorldScene::onTimer()
 {
 	_pWorld->simulate( 1.0/FPS );
+	_inputLog.stepFinished();
 
 	adjustTransform();
 	updateFrame();
@@ -440,7 +463,7 @@ void WorldScene::mouseMoveEvent( QGraphicsSceneMouseEvent* pEvent )
 		double y = 2* ( - pEvent->scenePos().y() / double(height()) + 0.5 );
 		//double e = y > 0 ? y*y : -y*y; // TODO expoeriment - use 2nd power as input function (3rd is too big, I've checked)
 		double e = y; // neeeeeeeeeey, linear is teh best!
-		pPlane->setElevator( e );
+		command( InputLog::Elevator, e );
 	}
 	setFocus(); // steal focus
 }
@@ -453,18 +476,17 @@ void WorldScene::mousePressEvent( QGraphicsSceneMouseEvent* pEvent )
 	if ( pEvent->isAccepted() ) return;
 	
 	
-	Plane* pPlane = plane();
 	switch ( pEvent->button() )
 	{
 	
 	// Left
 	case Qt::LeftButton:
-		if ( pPlane ) pPlane->setFiring( true );
+		command( InputLog::Firing, 1 );
 		break;
 		
 	// right
 	case Qt::RightButton:
-		if ( pPlane ) pPlane->releaseWeapon();
+		command( InputLog::ReleaseWeapon );
 		break;
 		
 	
@@ -480,13 +502,12 @@ void WorldScene::mouseReleaseEvent( QGraphicsSceneMouseEvent* pEvent )
 	QGraphicsScene::mouseReleaseEvent( pEvent );
 	if ( pEvent->isAccepted() ) return;
 	
-	Plane* pPlane = plane();
 	switch ( pEvent->button() )
 	{
 	
 	// Left
 	case Qt::LeftButton:
-		if ( pPlane ) pPlane->setFiring( false );
+		command( InputLog::Firing, 0 );
 		break;
 		
 	
@@ -504,7 +525,7 @@ void WorldScene::wheelEvent( QGraphicsSceneWheelEvent* pEvent )
 	if ( pPlane && ! pEvent->isAccepted() )
 	{
 		double step = pEvent->delta() / 1200.0; // single click - 120, stepping in 0.1 units
-		pPlane->setThrottle( pPlane->throttle() + step );
+		command( InputLog::Throttle, pPlane->throttle() + step );
 	}
 }
 
@@ -522,27 +543,27 @@ void WorldScene::keyPressEvent( QKeyEvent* pEvent )
 	{
 	// SPACE
 	case Qt::Key_Space:
-		if ( pPlane ) pPlane->flipPlane();
+		command( InputLog::Flip );
 		break;
 		
 	// V
 	case Qt::Key_V:
-		if ( pPlane ) pPlane->setFlaps( pPlane->flaps() + 0.33 );
+		if ( pPlane ) command( InputLog::Flaps, pPlane->flaps() + 0.33 );
 		break;
 	
 	// F
 	case Qt::Key_F:
-		if ( pPlane ) pPlane->setFlaps( pPlane->flaps() - 0.33 );
+		if ( pPlane ) command( InputLog::Flaps, pPlane->flaps() - 0.33 );
 		break;
 		
 	// B
 	case  Qt::Key_B:
-		if ( pPlane ) pPlane->applyWheelBrake( true );
+		command( InputLog::WheelBrake, 1 );
 		break;
 		
 	// A
 	case Qt::Key_A:
-		if ( pPlane ) pPlane->setAutopilot( ! pPlane->autopilot() );
+		if ( pPlane ) command( InputLog::Autopilot, ! pPlane->autopilot() );
 		break;
 		
 	// pg up - zoom out
@@ -573,12 +594,11 @@ void WorldScene::keyReleaseEvent( QKeyEvent* pEvent )
 {
 	if ( pEvent->isAutoRepeat() ) return;
 	
-	Plane* pPlane = plane();
 	switch( pEvent->key() )
 	{
 	// B
 	case Qt::Key_B:
-		if ( pPlane ) pPlane->applyWheelBrake( false );
+		command( InputLog::WheelBrake, 0 );
 		break;
 	
 	default:
@@ -637,11 +657,14 @@ void WorldScene::addWindow( QWidget* pWidget, double z )
 /// Restarts game
 void WorldScene::restart()
 {
+	saveRecording();
 	_pGame->restart();
 	_pWorld = _pGame->world();
+	_pWorld->setRenderThreads( renderThreads() );
 	_frames = 0;
 	_zoom = ZOOM1;
 	_lastRenderTime = 0;
+	startRecording();
 }
 
 // ============================================================================
@@ -651,6 +674,42 @@ void WorldScene::respawn()
 	// TODO
 }
 
+// ============================================================================
+/// Sends command to player's plane, and records it in input log.
+void WorldScene::command( InputLog::Command c, double value )
+{
+	Plane* pPlane = plane();
+	if ( pPlane )
+	{
+		_inputLog.record( c, value );
+		InputLog::apply( pPlane, c, value );
+	}
+}
+
+// ============================================================================
+/// Starts recording input, if enabled by FLYER_RECORD_INPUT.
+void WorldScene::startRecording()
+{
+	if ( ! inputLogPath().isEmpty() )
+	{
+		_inputLog.startRecording( _pWorld, 1.0/FPS );
+		qDebug("Recording input to %s", qPrintable( inputLogPath() ) );
+	}
+}
+
+// ============================================================================
+/// Stores recorded input, if recording.
+void WorldScene::saveRecording()
+{
+	if ( _inputLog.isRecording() )
+	{
+		if ( _inputLog.save( inputLogPath() ) )
+		{
+			qDebug("Input log: %d steps, %d events", _inputLog.steps(), _inputLog.events().size() );
+		}
+	}
+}
+
 
 } // ns
 
@@ -20,6 +20,8 @@
 #include <QGraphicsScene>
 #include <QTimer>
 
+#include "inputlog.h"
+
 namespace Flyer
 {
 
@@ -96,6 +98,10 @@ private:
 	void prepareStillImage();	///< Prepares still imae of the world
 	void updateFrame();			///< Repaintrs world
 	
+	void command( InputLog::Command c, double value = 0.0 );	///< Sends command to plane
+	void startRecording();		///< Starts input recording
+	void saveRecording();		///< Saves recorded input
+	
 	World* _pWorld;
 	Game*	_pGame;
 	QTimer _timer;
@@ -112,6 +118,8 @@ private:
 	
 	QImage	_still;				///< Still image displayed during pause
 	QPointF	_lastKnownPos;		///< last known player position
+	
+	InputLog _inputLog;			///< Recorded player's input
 };
 
 }
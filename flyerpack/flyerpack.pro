@@ -0,0 +1,21 @@
+TEMPLATE = app
+TARGET = flyer-pack
+
+CONFIG += release
+CONFIG -= debug
+
+QT += opengl
+
+INCLUDEPATH += ../common \
+  ../include/
+
+DESTDIR = ../bin/
+
+SOURCES += main.cpp
+
+LIBS += ../lib/libflyercommon.a \
+  -L../lib/ \
+  -lbox2d \
+  -lgpc
+
+TARGETDEPS += ../lib/libflyercommon.a
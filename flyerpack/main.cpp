@@ -0,0 +1,159 @@
+// Copyright (C) 2008 Maciej Gajewski <maciej.gajewski0@gmail.com>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// flyer-pack - builds asset pack with all bodies and pre-decoded textures.
+// Usage: flyer-pack [output file]. Default output is the pack path used by the game.
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QImage>
+#include <QList>
+
+#include "assetpack.h"
+#include "bodyprovider.h"
+#include "textureprovider.h"
+
+using namespace Flyer;
+
+// Lists files matching pattern in library, as paths relative to library
+static QStringList listLibrary( const QString& libraryPath, const QString& pattern )
+{
+	QDir library( libraryPath );
+	QStringList result;
+	
+	QDirIterator it( library.absolutePath(), QStringList() << pattern, QDir::Files, QDirIterator::Subdirectories );
+	while( it.hasNext() )
+	{
+		result.append( library.relativeFilePath( it.next() ) );
+	}
+	
+	result.sort();
+	return result;
+}
+
+// Pads file with zeros, to asset data alignment
+static void align( QFile& file )
+{
+	qint64 padding = ( AssetPack::DATA_ALIGNMENT - file.pos() % AssetPack::DATA_ALIGNMENT ) % AssetPack::DATA_ALIGNMENT;
+	if ( padding > 0 )
+	{
+		file.write( QByteArray( int( padding ), '\0' ) );
+	}
+}
+
+int main( int argc, char** argv )
+{
+	QApplication app( argc, argv, false );
+	
+	QString output = argc > 1 ? QString::fromLocal8Bit( argv[1] ) : AssetPack::defaultPath();
+	
+	QFile file( output );
+	if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+	{
+		fprintf( stderr, "Can't open %s for writing: %s\n", qPrintable( output ), qPrintable( file.errorString() ) );
+		return 1;
+	}
+	
+	QStringList bodies = listLibrary( BodyProvider::libraryPath(), "*.body" );
+	QStringList textures = listLibrary( TextureProvider::libraryPath(), "*.png" );
+	
+	// header, index offset is written when known
+	QDataStream stream( & file );
+	stream.writeRawData( AssetPack::MAGIC, 8 );
+	stream << AssetPack::VERSION << quint32( bodies.size() + textures.size() ) << quint64( 0 );
+	
+	QList<AssetPack::Entry> index;
+	
+	// bodies - file content as is
+	foreach( const QString& name, bodies )
+	{
+		QFile source( BodyProvider::libraryPath() + "/" + name );
+		if ( ! source.open( QIODevice::ReadOnly ) )
+		{
+			fprintf( stderr, "Can't read body %s: %s\n", qPrintable( name ), qPrintable( source.errorString() ) );
+			return 1;
+		}
+		QByteArray data = source.readAll();
+		
+		align( file );
+		
+		AssetPack::Entry entry;
+		entry.name		= name;
+		entry.type		= AssetPack::AssetBody;
+		entry.offset	= file.pos();
+		entry.size		= data.size();
+		file.write( data );
+		
+		index.append( entry );
+	}
+	
+	// textures - decoded, in format used for painting
+	qint64 textureBytes = 0;
+	foreach( const QString& name, textures )
+	{
+		QImage image( TextureProvider::libraryPath() + "/" + name );
+		if ( image.isNull() )
+		{
+			fprintf( stderr, "Can't decode texture %s\n", qPrintable( name ) );
+			return 1;
+		}
+		image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+		
+		align( file );
+		
+		AssetPack::Entry entry;
+		entry.name			= name;
+		entry.type			= AssetPack::AssetTexture;
+		entry.offset		= file.pos();
+		entry.size			= image.numBytes();
+		entry.width			= image.width();
+		entry.height		= image.height();
+		entry.bytesPerLine	= image.bytesPerLine();
+		entry.format		= image.format();
+		file.write( reinterpret_cast<const char*>( image.bits() ), image.numBytes() );
+		textureBytes += image.numBytes();
+		
+		index.append( entry );
+	}
+	
+	// index
+	quint64 indexOffset = file.pos();
+	foreach( const AssetPack::Entry& entry, index )
+	{
+		stream << entry;
+	}
+	
+	file.seek( 16 ); // magic, version, entries
+	stream << indexOffset;
+	
+	if ( file.error() != QFile::NoError )
+	{
+		fprintf( stderr, "Error writing %s: %s\n", qPrintable( output ), qPrintable( file.errorString() ) );
+		return 1;
+	}
+	
+	printf( "%s: %d bodies, %d textures (%.1f MB decoded), %.1f MB total\n"
+		, qPrintable( output ), bodies.size(), textures.size()
+		, textureBytes / 1048576.0, file.size() / 1048576.0 );
+	
+	return 0;
+}
+
+// EOF